@@ -0,0 +1,471 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "generator.h"
+#include "storage.h"
+#include "adjacency.h"
+#include "sampling.h"
+#include "typedgraph.h"
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+
+using namespace tinygraphdb;
+
+/*******************************************************************************
+ * Benchmark results
+ *
+ * Each benchmark records the number of operations and the elapsed time. All
+ * results are written as one JSON document so that runs can be compared.
+ *******************************************************************************/
+struct BenchResult
+{
+	std::string name;
+	long ops;
+	double seconds;
+};
+
+class BenchTimer
+{
+private:
+	std::chrono::steady_clock::time_point _start;
+public:
+	BenchTimer (): _start(std::chrono::steady_clock::now()) {};
+	double seconds () const {return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();};
+};
+
+static std::vector<BenchResult> results;
+
+static void record (const std::string & name, long ops, double seconds)
+{
+	BenchResult result = {name, ops, seconds};
+	results.push_back(result);
+	std::cerr << name << ": " << ops << " ops in " << seconds << " s\n";
+}
+
+static void writeJson (std::ostream & out, const GeneratorConfig & config, int nb_queries)
+{
+	out << "{\n  \"config\": {\"nb_nodes\": " << config.nb_nodes << ", \"avg_degree\": " << config.avg_degree << ", \"skew\": " << config.skew << ", \"seed\": " << config.seed << ", \"nb_queries\": " << nb_queries << "},\n";
+	out << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		out << "    {\"name\": \"" << results[i].name << "\", \"ops\": " << results[i].ops << ", \"seconds\": " << results[i].seconds;
+		out << ", \"ops_per_sec\": " << (results[i].seconds > 0 ? results[i].ops / results[i].seconds : 0) << "}";
+		out << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n}\n";
+}
+
+/*******************************************************************************
+ * Benchmarks
+ *******************************************************************************/
+
+// Time every getNodes* query on random arguments
+static void benchQueries (GraphDb & db, std::mt19937_64 & rng, int nb_queries)
+{
+	std::vector<std::string> types(db.policy().getNodeType().begin(), db.policy().getNodeType().end());
+	std::uniform_int_distribution<int> pick_type(0, (int) types.size() - 1);
+	std::uniform_int_distribution<int> pick_source(0, NB_GENERATED_SOURCES - 1);
+	std::uniform_int_distribution<int> pick_organism(0, 49);
+	std::uniform_int_distribution<int> pick_weight(0, 999);
+	long found = 0;
+	
+	BenchTimer t1;
+	for (int i = 0; i < nb_queries; i++) found += db.getNodesOfType(types[pick_type(rng)]).size();
+	record("getNodesOfType", nb_queries, t1.seconds());
+	
+	BenchTimer t2;
+	for (int i = 0; i < nb_queries; i++) found += db.getNodesWithProperty("organism").size();
+	record("getNodesWithProperty(name)", nb_queries, t2.seconds());
+	
+	BenchTimer t3;
+	for (int i = 0; i < nb_queries; i++) found += db.getNodesWithProperty("source", GENERATED_SOURCES[pick_source(rng)]).size();
+	record("getNodesWithProperty(name,value)", nb_queries, t3.seconds());
+	
+	BenchTimer t4;
+	for (int i = 0; i < nb_queries; i++) found += db.getNodesWithProperty("weight", PropValue(pick_weight(rng) / 10.0)).size();
+	record("getNodesWithProperty(name,typed)", nb_queries, t4.seconds());
+	
+	BenchTimer t5;
+	for (int i = 0; i < nb_queries; i++) found += db.getNodesWithPropertyValue("org_" + std::to_string(pick_organism(rng))).size();
+	record("getNodesWithPropertyValue", nb_queries, t5.seconds());
+	
+	BenchTimer t6;
+	for (int i = 0; i < nb_queries; i++) found += db.getNodesOfTypeWithProperty(types[pick_type(rng)], "organism").size();
+	record("getNodesOfTypeWithProperty(type,name)", nb_queries, t6.seconds());
+	
+	BenchTimer t7;
+	for (int i = 0; i < nb_queries; i++) found += db.getNodesOfTypeWithProperty(types[pick_type(rng)], "source", GENERATED_SOURCES[pick_source(rng)]).size();
+	record("getNodesOfTypeWithProperty(type,name,value)", nb_queries, t7.seconds());
+	
+	std::cerr << "(" << found << " nodes found)\n";
+}
+
+// Time random point lookups and 2-hop expansions
+static void benchTraversal (GraphDb & db, std::mt19937_64 & rng, int nb_nodes, int nb_queries)
+{
+	std::uniform_int_distribution<int> pick_node(0, nb_nodes - 1);
+	long found = 0;
+	
+	int nb_lookups = nb_queries * 100;
+	BenchTimer t1;
+	for (int i = 0; i < nb_lookups; i++) found += db.getNode(pick_node(rng)) != NULL;
+	record("getNode", nb_lookups, t1.seconds());
+	
+	// Same lookups by batches of 512 ids, then the "name" property of each node, one by one and by batches
+	const int batch = 512;
+	std::vector<int> ids(nb_lookups);
+	for (int i = 0; i < nb_lookups; i++) ids[i] = pick_node(rng);
+	std::vector<Node *> nodes(batch);
+	std::vector<PropertyValues> values(batch);
+	BenchTimer t_batch;
+	for (int i = 0; i + batch <= nb_lookups; i += batch) {
+		db.getNodes(&ids[i], batch, nodes.data());
+		for (int n = 0; n < batch; n++) found += nodes[n] != NULL && nodes[n]->typeId() >= 0;
+	}
+	record("getNodes_batch", nb_lookups / batch * batch, t_batch.seconds());
+	BenchTimer t_props;
+	for (int i = 0; i < nb_lookups; i++) {
+		Node * node = db.getNode(ids[i]);
+		if (node != NULL) found += node->properties().find("name").size();
+	}
+	record("getNode_property", nb_lookups, t_props.seconds());
+	BenchTimer t_batch_props;
+	for (int i = 0; i + batch <= nb_lookups; i += batch) {
+		db.getProperties(&ids[i], batch, "name", values.data());
+		for (int n = 0; n < batch; n++) found += values[n].size();
+	}
+	record("getProperties_batch", nb_lookups / batch * batch, t_batch_props.seconds());
+	
+	BenchTimer t2;
+	for (int i = 0; i < nb_queries; i++) {
+		Node * start = db.getNode(pick_node(rng));
+		if (start == NULL) continue;
+		std::set<Node *> visited;
+		visited.insert(start);
+		std::vector<Node *> frontier(1, start);
+		for (int hop = 0; hop < 2; hop++) {
+			std::vector<Node *> next;
+			for (size_t n = 0; n < frontier.size(); n++) {
+				for (std::set<Arc *>::const_iterator it = frontier[n]->arcs().begin(); it != frontier[n]->arcs().end(); it++) {
+					Node * other = (*it)->fromNode() == frontier[n] ? (*it)->toNode() : (*it)->fromNode();
+					if (visited.insert(other).second) next.push_back(other);
+				}
+			}
+			frontier.swap(next);
+		}
+		found += visited.size();
+	}
+	record("traversal_2hop", nb_queries, t2.seconds());
+	
+	BenchTimer t3;
+	for (int i = 0; i < nb_queries; i++) {
+		Node * start = db.getNode(pick_node(rng));
+		if (start != NULL) found += start->getNodeFromArcOfType("is a").size();
+	}
+	record("getNodeFromArcOfType", nb_queries, t3.seconds());
+	
+	std::cerr << "(" << found << " nodes visited)\n";
+}
+
+// Time insertions in an empty GraphDb with the policy of the given one
+static void benchInserts (GraphDb & db, int nb_nodes)
+{
+	std::vector<std::string> types(db.policy().getNodeType().begin(), db.policy().getNodeType().end());
+	GraphDb fresh(db.policy());
+	
+	// Copy the arcs of the loaded database
+	std::vector<Arc *> arcs;
+	std::set<Node *> all = db.allNodes();
+	for (std::set<Node *>::iterator it = all.begin(); it != all.end(); it++) {
+		for (std::set<Arc *>::const_iterator it_arc = (*it)->arcs().begin(); it_arc != (*it)->arcs().end(); it_arc++) {
+			if ((*it_arc)->fromNode() == *it) arcs.push_back(*it_arc);
+		}
+	}
+	
+	BenchTimer t1;
+	for (int id = 0; id < nb_nodes; id++) {
+		Node * node = db.getNode(id);
+		std::string name = node->type() + "_" + std::to_string(id);
+		PropertyPairs properties;
+		properties.push_back(std::make_pair(std::string_view("name"), std::string_view(name)));
+		properties.push_back(std::make_pair(std::string_view("source"), std::string_view(GENERATED_SOURCES[id % NB_GENERATED_SOURCES])));
+		fresh.newNodeWithId(id, node->type(), properties);
+	}
+	record("newNodeWithId", nb_nodes, t1.seconds());
+	
+	PropertyPairs none;
+	BenchTimer t2;
+	for (size_t i = 0; i < arcs.size(); i++) {
+		fresh.addArc(arcs[i]->fromNode()->unique_id(), arcs[i]->type(), arcs[i]->toNode()->unique_id(), none);
+	}
+	record("addArc", (long) arcs.size(), t2.seconds());
+	
+	BenchTimer t3;
+	for (int i = 0; i < nb_nodes; i++) {
+		fresh.newNode(types[i % types.size()], none);
+	}
+	record("newNode", nb_nodes, t3.seconds());
+}
+
+// Schema of the typed inserts: proteins interact, genes code for proteins
+struct BenchSchema
+{
+	enum NodeType {GENE, PROTEIN, NB_NODE_TYPES};
+	enum ArcType {CODES_FOR, INTERACTS_WITH, NB_ARC_TYPES};
+	static constexpr const char * node_types[NB_NODE_TYPES] = {"gene", "protein"};
+	static constexpr const char * arc_types[NB_ARC_TYPES] = {"codes for", "interacts with"};
+	static constexpr SchemaTriple<NodeType, ArcType> triples[] = {
+		{GENE, CODES_FOR, PROTEIN}, {PROTEIN, INTERACTS_WITH, PROTEIN}};
+};
+
+// Time the same inserts with the runtime Policy (by name) and with the enum adders of a static schema
+static void benchTypedInserts (int nb_nodes)
+{
+	typedef StaticPolicy<BenchSchema> P;
+	PropertyPairs properties;
+	properties.push_back(std::make_pair(std::string_view("source"), std::string_view(GENERATED_SOURCES[0])));
+	PropertyPairs none;
+	
+	GraphDb runtime(P::policy());
+	BenchTimer t1;
+	for (int id = 0; id < nb_nodes; id++) {
+		runtime.newNodeWithId(id, std::string_view(P::nodeTypeName(id % 2 == 0 ? BenchSchema::GENE : BenchSchema::PROTEIN)), properties);
+	}
+	record("newNodeWithId(runtime policy)", nb_nodes, t1.seconds());
+	
+	TypedGraphDb<P> typed;
+	BenchTimer t2;
+	for (int id = 0; id < nb_nodes; id++) {
+		typed.newNodeWithId(id, id % 2 == 0 ? BenchSchema::GENE : BenchSchema::PROTEIN, properties);
+	}
+	record("newNodeWithId(static policy)", nb_nodes, t2.seconds());
+	
+	// Each gene codes for the next protein, each protein interacts with the next one
+	BenchTimer t3;
+	for (int id = 0; id + 2 < nb_nodes; id++) {
+		runtime.addArc(id, std::string_view(P::arcTypeName(id % 2 == 0 ? BenchSchema::CODES_FOR : BenchSchema::INTERACTS_WITH)), id % 2 == 0 ? id + 1 : id + 2, none);
+	}
+	record("addArc(runtime policy)", nb_nodes - 2, t3.seconds());
+	
+	BenchTimer t4;
+	for (int id = 0; id + 2 < nb_nodes; id++) {
+		typed.addArc(id, id % 2 == 0 ? BenchSchema::CODES_FOR : BenchSchema::INTERACTS_WITH, id % 2 == 0 ? id + 1 : id + 2, none);
+	}
+	record("addArc(static policy)", nb_nodes - 2, t4.seconds());
+}
+
+// Time lookups and expansions on paged files, with every page resident then with a small buffer pool
+static void benchPaged (GraphDb & db, std::mt19937_64 & rng, const std::string & work_file, int nb_nodes, int nb_queries)
+{
+	std::string paged_file = work_file + ".paged";
+	BenchTimer t_write;
+	PagedGraphDb::write(db, paged_file);
+	record("paged_write", db.nbNode() + db.nbArc(), t_write.seconds());
+	
+	std::uniform_int_distribution<int> pick_node(0, nb_nodes - 1);
+	const size_t pool_sizes[2] = {1 << 30, 1 << 20};
+	const char * names[2] = {"paged_hot", "paged_1MB"};
+	long found = 0;
+	for (int p = 0; p < 2; p++) {
+		PagedGraphDb paged(paged_file, pool_sizes[p]);
+		int nb_lookups = nb_queries * 100;
+		BenchTimer t1;
+		for (int i = 0; i < nb_lookups; i++) found += paged.hasNode(pick_node(rng));
+		record(std::string(names[p]) + "_getNode", nb_lookups, t1.seconds());
+		
+		BenchTimer t2;
+		for (int i = 0; i < nb_queries; i++) found += paged.getNodeFromArcOfType(pick_node(rng), "is a").size();
+		record(std::string(names[p]) + "_getNodeFromArcOfType", nb_queries, t2.seconds());
+	}
+	std::cerr << "(" << found << " nodes found)\n";
+	const char * extensions[5] = {".meta", ".nodes", ".arcs", ".adj", ".heap"};
+	for (int i = 0; i < 5; i++) remove((paged_file + extensions[i]).c_str());
+}
+
+// Time 3-hop expansions and rank propagation on compressed adjacencies in every node order
+static void benchReorder (GraphDb & db, std::mt19937_64 & rng, int nb_nodes, int nb_queries)
+{
+	const NodeOrder orders[4] = {ORDER_ID, ORDER_BFS, ORDER_RCM, ORDER_DEGREE};
+	const char * names[4] = {"id", "bfs", "rcm", "degree"};
+	std::uniform_int_distribution<int> pick_node(0, nb_nodes - 1);
+	std::vector<int> starts(nb_queries);
+	for (int i = 0; i < nb_queries; i++) starts[i] = pick_node(rng);
+	const int nb_iterations = 10;
+	double found = 0;
+	for (int o = 0; o < 4; o++) {
+		BenchTimer t_build;
+		CompressedAdjacency adjacency(db, orders[o]);
+		record(std::string("adjacency_build_") + names[o], db.nbNode() + db.nbArc(), t_build.seconds());
+		std::cerr << "(" << adjacency.memoryUsage().bytes << " bytes)\n";
+		
+		// Visited marks by internal index, reset by epoch
+		std::vector<int> marks(adjacency.nbIndex(), -1);
+		BenchTimer t1;
+		for (int i = 0; i < nb_queries; i++) {
+			int start = adjacency.internalId(starts[i]);
+			if (start < 0) continue;
+			marks[start] = i;
+			std::vector<int> frontier(1, start), next;
+			for (int hop = 0; hop < 3; hop++) {
+				next.clear();
+				for (size_t n = 0; n < frontier.size(); n++) {
+					adjacency.forEachInternalArc(frontier[n], [&](int neighbor, int, bool) {
+						if (marks[neighbor] != i) {
+							marks[neighbor] = i;
+							next.push_back(neighbor);
+						}
+					});
+				}
+				frontier.swap(next);
+				found += frontier.size();
+			}
+		}
+		record(std::string("adjacency_3hop_") + names[o], nb_queries, t1.seconds());
+		
+		// Pull-based rank propagation over every arc
+		std::vector<double> rank(adjacency.nbIndex(), 1.0), next_rank(adjacency.nbIndex());
+		BenchTimer t2;
+		for (int iteration = 0; iteration < nb_iterations; iteration++) {
+			for (size_t n = 0; n < rank.size(); n++) {
+				double sum = 0;
+				adjacency.forEachInternalArc((int) n, [&](int neighbor, int, bool) {sum += rank[neighbor];});
+				next_rank[n] = 0.15 + 0.85 * sum / (1 + adjacency.nbIndex());
+			}
+			rank.swap(next_rank);
+		}
+		found += rank[0];
+		record(std::string("adjacency_rank_") + names[o], (long) (nb_iterations * 2 * adjacency.nbArc()), t2.seconds());
+	}
+	std::cerr << "(" << found << " nodes visited)\n";
+}
+
+// Time random walks of 20 nodes through "is a" arcs: with getNodeFromArcOfType, then with a GraphSampler
+static void benchSampling (GraphDb & db, std::mt19937_64 & rng, int nb_nodes, int nb_queries)
+{
+	const size_t length = 20;
+	std::uniform_int_distribution<int> pick_node(0, nb_nodes - 1);
+	long found = 0;
+	
+	BenchTimer t1;
+	for (int i = 0; i < nb_queries; i++) {
+		Node * current = db.getNode(pick_node(rng));
+		for (size_t step = 1; step < length && current != NULL; step++) {
+			std::set<Node *> neighbors = current->getNodeFromArcOfType("is a");
+			if (neighbors.empty()) break;
+			std::set<Node *>::iterator it = neighbors.begin();
+			std::advance(it, rng() % neighbors.size());
+			current = *it;
+			found++;
+		}
+	}
+	record("walk_getNodeFromArcOfType", nb_queries, t1.seconds());
+	
+	BenchTimer t_build;
+	GraphSampler sampler(db, std::vector<std::string>(1, "is a"));
+	record("sampler_build", db.nbNode() + db.nbArc(), t_build.seconds());
+	std::vector<int> starts(nb_queries * 100);
+	for (size_t i = 0; i < starts.size(); i++) starts[i] = pick_node(rng);
+	std::vector<int> walks;
+	BenchTimer t2;
+	sampler.walks(starts, 1, length, rng(), 1, walks);
+	record("walk_sampler", (long) starts.size(), t2.seconds());
+	std::vector<int> samples;
+	BenchTimer t3;
+	sampler.sampleNeighbors(starts, std::vector<size_t>({10, 5}), rng(), 1, samples);
+	record("sample_10x5", (long) starts.size(), t3.seconds());
+	found += std::count(walks.begin(), walks.end(), -1) + std::count(samples.begin(), samples.end(), -1);
+	std::cerr << "(" << found << ")\n";
+}
+
+// Time the erasure of a tenth of the nodes
+static void benchErase (GraphDb & db, std::mt19937_64 & rng, int nb_nodes)
+{
+	std::vector<int> ids(nb_nodes);
+	for (int i = 0; i < nb_nodes; i++) ids[i] = i;
+	std::shuffle(ids.begin(), ids.end(), rng);
+	ids.resize(nb_nodes / 10);
+	BenchTimer t;
+	for (size_t i = 0; i < ids.size(); i++) db.eraseNode(ids[i]);
+	record("eraseNode", (long) ids.size(), t.seconds());
+}
+
+int main(int argc, const char * argv[])
+{
+	std::string policy_file = "dbBase.tgdb";
+	std::string work_file = "bench_graph.tgdb";
+	std::string out_file;
+	int nb_queries = 1000;
+	GeneratorConfig config;
+	
+	for (int i = 1; i + 1 < argc; i += 2) {
+		std::string arg = argv[i];
+		if (arg.compare("-p") == 0) policy_file = argv[i + 1];
+		else if (arg.compare("-f") == 0) work_file = argv[i + 1];
+		else if (arg.compare("-o") == 0) out_file = argv[i + 1];
+		else if (arg.compare("-n") == 0) config.nb_nodes = atoi(argv[i + 1]);
+		else if (arg.compare("-d") == 0) config.avg_degree = atof(argv[i + 1]);
+		else if (arg.compare("-z") == 0) config.skew = atof(argv[i + 1]);
+		else if (arg.compare("-s") == 0) config.seed = (unsigned) atoi(argv[i + 1]);
+		else if (arg.compare("-q") == 0) nb_queries = atoi(argv[i + 1]);
+		else {
+			std::cerr << "Usage: " << argv[0] << " [-p policy.tgdb] [-f work.tgdb] [-o results.json] [-n nb_nodes] [-d avg_degree] [-z skew] [-s seed] [-q nb_queries]\n";
+			return 1;
+		}
+	}
+	
+	Policy policy;
+	policy.read(policy_file);
+	Generator generator(policy, config);
+	BenchTimer t_gen;
+	generator.write(work_file);
+	record("generate", config.nb_nodes, t_gen.seconds());
+	
+	BenchTimer t_load;
+	GraphDb db(work_file);
+	record("load", db.nbNode() + db.nbArc(), t_load.seconds());
+	
+	std::string save_file = work_file + ".saved";
+	BenchTimer t_save;
+	db.save(save_file);
+	record("save", db.nbNode() + db.nbArc(), t_save.seconds());
+	remove(save_file.c_str());
+	
+	std::mt19937_64 rng(config.seed);
+	benchInserts(db, config.nb_nodes);
+	benchTypedInserts(config.nb_nodes);
+	benchQueries(db, rng, nb_queries);
+	benchTraversal(db, rng, config.nb_nodes, nb_queries);
+	benchPaged(db, rng, work_file, config.nb_nodes, nb_queries);
+	benchReorder(db, rng, config.nb_nodes, nb_queries);
+	benchSampling(db, rng, config.nb_nodes, nb_queries);
+	benchErase(db, rng, config.nb_nodes);
+	
+	if (out_file.empty()) {
+		writeJson(std::cout, config, nb_queries);
+	} else {
+		std::ofstream outfile(out_file.c_str());
+		writeJson(outfile, config, nb_queries);
+	}
+	return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "generator.h"
+
+// Write a synthetic graph following the policy of the given .tgdb file
+int main(int argc, const char * argv[])
+{
+	std::string policy_file = "dbBase.tgdb";
+	std::string out_file;
+	tinygraphdb::GeneratorConfig config;
+	
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 < argc && arg.compare("-p") == 0) {
+			policy_file = argv[++i];
+		} else if (i + 1 < argc && arg.compare("-n") == 0) {
+			config.nb_nodes = atoi(argv[++i]);
+		} else if (i + 1 < argc && arg.compare("-d") == 0) {
+			config.avg_degree = atof(argv[++i]);
+		} else if (i + 1 < argc && arg.compare("-z") == 0) {
+			config.skew = atof(argv[++i]);
+		} else if (i + 1 < argc && arg.compare("-s") == 0) {
+			config.seed = (unsigned) atoi(argv[++i]);
+		} else if (out_file.empty() && arg[0] != '-') {
+			out_file = arg;
+		} else {
+			out_file.clear();
+			break;
+		}
+	}
+	if (out_file.empty()) {
+		std::cerr << "Usage: " << argv[0] << " [-p policy.tgdb] [-n nb_nodes] [-d avg_degree] [-z skew] [-s seed] out.tgdb\n";
+		return 1;
+	}
+	
+	tinygraphdb::Policy policy;
+	policy.read(policy_file);
+	try {
+		tinygraphdb::Generator generator(policy, config);
+		generator.write(out_file);
+	} catch (std::exception & e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
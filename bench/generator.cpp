@@ -0,0 +1,152 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "generator.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace tinygraphdb;
+
+const char * const tinygraphdb::GENERATED_SOURCES[] = {"kegg", "metacyc", "chebi", "uniprot", "reactome", "pubchem", "ensembl", "go"};
+const int tinygraphdb::NB_GENERATED_SOURCES = 8;
+
+// Prepare the generator (nodes are assigned to types here)
+Generator :: Generator (const Policy & policy, const GeneratorConfig & config): _policy(policy), _config(config), _rng(config.seed)
+{
+	std::vector<std::string> types(_policy.getNodeType().begin(), _policy.getNodeType().end());
+	if (types.empty()) {
+		throw std::runtime_error("Cannot generate a graph with an empty policy");
+	}
+	std::uniform_int_distribution<int> pick_type(0, (int) types.size() - 1);
+	for (int id = 0; id < _config.nb_nodes; id++) {
+		_nodes_of_type[types[pick_type(_rng)]].push_back(id);
+	}
+	// Cumulative Zipf distribution over the nodes of each type (rank 0 is the biggest hub)
+	for (std::map<std::string, std::vector<int> >::iterator it = _nodes_of_type.begin(); it != _nodes_of_type.end(); it++) {
+		std::vector<double> & cdf = _zipf_cdf[it->first];
+		cdf.resize(it->second.size());
+		double sum = 0;
+		for (size_t rank = 0; rank < cdf.size(); rank++) {
+			sum += 1.0 / std::pow((double) rank + 1, _config.skew);
+			cdf[rank] = sum;
+		}
+		for (size_t rank = 0; rank < cdf.size(); rank++) {
+			cdf[rank] /= sum;
+		}
+		std::shuffle(it->second.begin(), it->second.end(), _rng);
+	}
+}
+
+// Pick a node of the given type following the Zipf law (-1 if there is no such node)
+int Generator :: zipf (const std::string & type)
+{
+	std::map<std::string, std::vector<double> >::iterator it = _zipf_cdf.find(type);
+	if (it == _zipf_cdf.end() || it->second.empty()) {
+		return -1;
+	}
+	double u = std::uniform_real_distribution<double>(0, 1)(_rng);
+	size_t rank = std::lower_bound(it->second.begin(), it->second.end(), u) - it->second.begin();
+	if (rank >= it->second.size()) {
+		rank = it->second.size() - 1;
+	}
+	return _nodes_of_type[type][rank];
+}
+
+// Write the policy, the nodes and the relations in the given stream
+void Generator :: write (std::ofstream & outfile)
+{
+	Policy policy = _policy;
+	for (StringSet::const_iterator it = policy.getNodeType().begin(); it != policy.getNodeType().end(); it++) {
+		policy.addPropertyType(*it, "weight", PROP_DOUBLE);
+	}
+	policy.print(outfile);
+	
+	// Nodes
+	outfile << "\nNodes\n\n";
+	std::vector<const std::string *> node_type(_config.nb_nodes);
+	for (std::map<std::string, std::vector<int> >::iterator it = _nodes_of_type.begin(); it != _nodes_of_type.end(); it++) {
+		for (size_t i = 0; i < it->second.size(); i++) {
+			node_type[it->second[i]] = &it->first;
+		}
+	}
+	std::uniform_int_distribution<int> pick_source(0, NB_GENERATED_SOURCES - 1);
+	std::uniform_int_distribution<int> pick_weight(0, 999);
+	std::uniform_real_distribution<double> coin(0, 1);
+	std::vector<double> organism_cdf(50);
+	double sum = 0;
+	for (int i = 0; i < 50; i++) {
+		sum += 1.0 / (i + 1);
+		organism_cdf[i] = sum;
+	}
+	for (int id = 0; id < _config.nb_nodes; id++) {
+		outfile << *node_type[id] << "\t" << id;
+		outfile << "\tname\t" << *node_type[id] << "_" << id;
+		outfile << "\tsource\t" << GENERATED_SOURCES[pick_source(_rng)];
+		if (coin(_rng) < 0.5) {
+			double u = coin(_rng) * sum;
+			outfile << "\torganism\torg_" << (std::lower_bound(organism_cdf.begin(), organism_cdf.end(), u) - organism_cdf.begin());
+		}
+		if (coin(_rng) < 0.5) {
+			outfile << "\tweight\t" << pick_weight(_rng) / 10.0;
+		}
+		outfile << "\n";
+	}
+	
+	// Relations
+	outfile << "\nRelations\n\n";
+	const std::vector<std::string> & from_type = _policy.getFromType();
+	const std::vector<std::string> & link_type = _policy.getLinkType();
+	const std::vector<std::string> & to_type = _policy.getToType();
+	std::vector<int> constraints;
+	for (size_t i = 0; i < from_type.size(); i++) {
+		if (_nodes_of_type.count(from_type[i]) && _nodes_of_type.count(to_type[i])) {
+			constraints.push_back((int) i);
+		}
+	}
+	if (constraints.empty()) {
+		return;
+	}
+	std::uniform_int_distribution<int> pick_constraint(0, (int) constraints.size() - 1);
+	long nb_arcs = (long) (_config.nb_nodes * _config.avg_degree);
+	for (long a = 0; a < nb_arcs; a++) {
+		int c = constraints[pick_constraint(_rng)];
+		std::vector<int> & sources = _nodes_of_type[from_type[c]];
+		int from = sources[std::uniform_int_distribution<size_t>(0, sources.size() - 1)(_rng)];
+		int to = zipf(to_type[c]);
+		outfile << from << "\t" << link_type[c] << "\t" << to << "\n";
+	}
+}
+
+// Write the generated graph in the given file
+void Generator :: write (const std::string & fname)
+{
+	std::ofstream outfile;
+	outfile.open (fname.c_str());
+	if (!outfile.good()) {
+		std::stringstream error_message;
+		error_message << "Cannot open file " << fname;
+		throw std::runtime_error(error_message.str());
+	}
+	write(outfile);
+}
@@ -0,0 +1,88 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__generator__
+#define __tinyGraphDb__generator__
+
+#include "tinygraphdb.h"
+#include <random>
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * GeneratorConfig struct
+	 *
+	 * nb_nodes   : Number of nodes to generate
+	 * avg_degree : Average number of arcs per node
+	 * skew       : Exponent of the Zipf law used to pick arc targets (0 is uniform)
+	 * seed       : Seed of the random generator (same seed, same graph)
+	 *******************************************************************************/
+	struct GeneratorConfig
+	{
+		int nb_nodes;
+		double avg_degree;
+		double skew;
+		unsigned seed;
+		
+		GeneratorConfig (): nb_nodes(10000), avg_degree(4), skew(1.0), seed(42) {};
+	};
+	
+	/*******************************************************************************
+	 * Generator Class
+	 *
+	 * Write a synthetic .tgdb file following a policy. Nodes are spread over the
+	 * node types of the policy and get 2 to 4 properties of various cardinalities:
+	 *   name     : unique per node
+	 *   source   : 8 values
+	 *   organism : 50 values, Zipf distributed
+	 *   weight   : numeric (declared as double), about 1000 values
+	 * Arcs follow the policy triplets. Sources are uniform, targets follow a Zipf
+	 * law so that a few hub nodes get most of the arcs.
+	 *******************************************************************************/
+	class Generator
+	{
+	private:
+		const Policy & _policy;
+		GeneratorConfig _config;
+		std::mt19937_64 _rng;
+		
+		std::map<std::string, std::vector<int> > _nodes_of_type;
+		std::map<std::string, std::vector<double> > _zipf_cdf;
+		
+		int zipf (const std::string & type);
+		
+	public:
+		explicit Generator (const Policy & policy, const GeneratorConfig & config);
+		
+		void write (std::ofstream & outfile);
+		void write (const std::string & fname);
+	};
+	
+	// Names used by the generated properties (for queries in benchmarks)
+	extern const char * const GENERATED_SOURCES[];
+	extern const int NB_GENERATED_SOURCES;
+	
+} // namespace tinygraphdb
+
+#endif
@@ -0,0 +1,349 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "client.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <sstream>
+#include <stdexcept>
+
+using namespace tinygraphdb;
+
+std::string ServerResponse :: error () const
+{
+	if (ok()) {
+		return std::string();
+	}
+	WireReader in(payload);
+	std::string_view message = in.str();
+	return std::string(message.data(), message.size());
+}
+
+GraphClient :: GraphClient (const std::string & address): _fd(-1), _next_id(1)
+{
+	ServerAddress server_address = ServerAddress::parse(address);
+	if (server_address.is_unix) {
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (server_address.path.size() >= sizeof(addr.sun_path)) {
+			throw std::runtime_error("Unix socket path too long");
+		}
+		strcpy(addr.sun_path, server_address.path.c_str());
+		_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (_fd >= 0 && connect(_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+			::close(_fd);
+			_fd = -1;
+		}
+	} else {
+		std::stringstream port;
+		port << server_address.port;
+		struct addrinfo hints;
+		struct addrinfo * result = NULL;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		if (getaddrinfo(server_address.host.c_str(), port.str().c_str(), &hints, &result) == 0) {
+			for (struct addrinfo * it = result; it != NULL && _fd < 0; it = it->ai_next) {
+				_fd = socket(it->ai_family, it->ai_socktype | SOCK_CLOEXEC, it->ai_protocol);
+				if (_fd >= 0 && connect(_fd, it->ai_addr, it->ai_addrlen) < 0) {
+					::close(_fd);
+					_fd = -1;
+				}
+			}
+			freeaddrinfo(result);
+		}
+		if (_fd >= 0) {
+			int one = 1;
+			setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		}
+	}
+	if (_fd < 0) {
+		std::stringstream error_message;
+		error_message << "Cannot connect to " << address << ": " << strerror(errno);
+		throw std::runtime_error(error_message.str());
+	}
+}
+
+GraphClient :: ~GraphClient ()
+{
+	if (_fd >= 0) {
+		::close(_fd);
+	}
+}
+
+// Buffer a request and return its id
+uint32_t GraphClient :: send (int op, const WireWriter & payload)
+{
+	uint32_t request_id = _next_id++;
+	WireWriter frame;
+	size_t start = frame.beginFrame();
+	frame.u32(request_id);
+	frame.u8((uint8_t) op);
+	frame.raw(payload.buffer());
+	frame.endFrame(start);
+	_out.append(frame.buffer());
+	return request_id;
+}
+
+// Write the buffered requests
+void GraphClient :: flush ()
+{
+	size_t sent = 0;
+	while (sent < _out.size()) {
+		ssize_t size = ::send(_fd, _out.data() + sent, _out.size() - sent, MSG_NOSIGNAL);
+		if (size < 0) {
+			if (errno == EINTR) continue;
+			std::stringstream error_message;
+			error_message << "Cannot send request: " << strerror(errno);
+			throw std::runtime_error(error_message.str());
+		}
+		sent += size;
+	}
+	_out.clear();
+}
+
+// Read the available responses (block until at least one byte is received)
+void GraphClient :: receive ()
+{
+	char buffer[65536];
+	ssize_t size;
+	do {
+		size = recv(_fd, buffer, sizeof(buffer), 0);
+	} while (size < 0 && errno == EINTR);
+	if (size <= 0) {
+		throw std::runtime_error(size == 0 ? "Connection closed by the server" : strerror(errno));
+	}
+	_in.append(buffer, size);
+	
+	size_t offset = 0;
+	std::string_view body;
+	while (nextFrame(_in, offset, body)) {
+		WireReader in(body);
+		uint32_t request_id = in.u32();
+		ServerResponse & response = _responses[request_id];
+		response.status = in.u8();
+		response.payload.assign(body.data() + (body.size() - in.remaining()), in.remaining());
+	}
+	_in.erase(0, offset);
+}
+
+// Wait for the response of a request (sent responses are flushed first)
+ServerResponse GraphClient :: wait (uint32_t request_id)
+{
+	if (!_out.empty()) {
+		flush();
+	}
+	std::unordered_map<uint32_t, ServerResponse>::iterator it;
+	while ((it = _responses.find(request_id)) == _responses.end()) {
+		receive();
+	}
+	ServerResponse response = std::move(it->second);
+	_responses.erase(it);
+	return response;
+}
+
+std::vector<ServerResponse> GraphClient :: batch (const std::vector<std::pair<int, WireWriter> > & requests)
+{
+	WireWriter payload;
+	payload.u32((uint32_t) requests.size());
+	for (size_t i = 0; i < requests.size(); i++) {
+		size_t start = payload.beginFrame();
+		payload.u8((uint8_t) requests[i].first);
+		payload.raw(requests[i].second.buffer());
+		payload.endFrame(start);
+	}
+	ServerResponse response = call(OP_BATCH, payload);
+	WireReader in = response.reader();
+	std::vector<ServerResponse> responses(in.u32());
+	for (size_t i = 0; i < responses.size(); i++) {
+		WireReader frame(in.bytes(in.u32()));
+		responses[i].status = frame.u8();
+		std::string_view rest = frame.bytes(frame.remaining());
+		responses[i].payload.assign(rest.data(), rest.size());
+	}
+	return responses;
+}
+
+// Send a request and wait for its response (throw an exception on error)
+ServerResponse GraphClient :: call (int op, const WireWriter & payload)
+{
+	ServerResponse response = wait(send(op, payload));
+	if (!response.ok()) {
+		throw std::runtime_error(response.error());
+	}
+	return response;
+}
+
+std::vector<int> GraphClient :: callIds (int op, const WireWriter & payload)
+{
+	ServerResponse response = call(op, payload);
+	WireReader in = response.reader();
+	return in.ids();
+}
+
+RemoteNode GraphClient :: decodeNode (WireReader & in)
+{
+	RemoteNode node;
+	node.id = in.i32();
+	std::string_view type = in.str();
+	node.type.assign(type.data(), type.size());
+	WireProperties properties = in.properties();
+	for (WireProperties::iterator it = properties.begin(); it != properties.end(); it++) {
+		node.properties[std::string(it->first)] = std::string(it->second);
+	}
+	return node;
+}
+
+void GraphClient :: ping ()
+{
+	call(OP_PING);
+}
+
+int GraphClient :: newNode (const std::string & type, const WireProperties & properties)
+{
+	WireWriter payload;
+	payload.str(type);
+	payload.properties(properties);
+	ServerResponse response = call(OP_NEW_NODE, payload);
+	WireReader in = response.reader();
+	return in.i32();
+}
+
+void GraphClient :: newNodeWithId (int id, const std::string & type, const WireProperties & properties)
+{
+	WireWriter payload;
+	payload.i32(id);
+	payload.str(type);
+	payload.properties(properties);
+	call(OP_NEW_NODE_WITH_ID, payload);
+}
+
+void GraphClient :: addArc (int from, const std::string & type, int to, const WireProperties & properties)
+{
+	WireWriter payload;
+	payload.i32(from);
+	payload.str(type);
+	payload.i32(to);
+	payload.properties(properties);
+	call(OP_ADD_ARC, payload);
+}
+
+void GraphClient :: eraseNode (int id)
+{
+	WireWriter payload;
+	payload.i32(id);
+	call(OP_ERASE_NODE, payload);
+}
+
+RemoteNode GraphClient :: getNode (int id)
+{
+	WireWriter payload;
+	payload.i32(id);
+	ServerResponse response = call(OP_GET_NODE, payload);
+	WireReader in = response.reader();
+	return decodeNode(in);
+}
+
+std::vector<int> GraphClient :: getNodesOfType (const std::string & type)
+{
+	WireWriter payload;
+	payload.str(type);
+	return callIds(OP_GET_NODES_OF_TYPE, payload);
+}
+
+std::vector<int> GraphClient :: getNodesWithProperty (const std::string & name)
+{
+	WireWriter payload;
+	payload.str(name);
+	return callIds(OP_GET_NODES_WITH_PROPERTY, payload);
+}
+
+std::vector<int> GraphClient :: getNodesWithProperty (const std::string & name, const std::string & value)
+{
+	WireWriter payload;
+	payload.str(name);
+	payload.str(value);
+	return callIds(OP_GET_NODES_WITH_PROPERTY_VALUE, payload);
+}
+
+std::vector<int> GraphClient :: getNodesWithPropertyValue (const std::string & value)
+{
+	WireWriter payload;
+	payload.str(value);
+	return callIds(OP_GET_NODES_WITH_VALUE, payload);
+}
+
+std::vector<int> GraphClient :: getNodesOfTypeWithProperty (const std::string & type, const std::string & name)
+{
+	WireWriter payload;
+	payload.str(type);
+	payload.str(name);
+	return callIds(OP_GET_NODES_OF_TYPE_WITH_PROPERTY, payload);
+}
+
+std::vector<int> GraphClient :: getNodesOfTypeWithProperty (const std::string & type, const std::string & name, const std::string & value)
+{
+	WireWriter payload;
+	payload.str(type);
+	payload.str(name);
+	payload.str(value);
+	return callIds(OP_GET_NODES_OF_TYPE_WITH_PROPERTY_VALUE, payload);
+}
+
+std::vector<int> GraphClient :: neighbors (int id, const std::string & arc_type)
+{
+	WireWriter payload;
+	payload.i32(id);
+	payload.str(arc_type);
+	return callIds(OP_NEIGHBORS, payload);
+}
+
+int64_t GraphClient :: nbNode ()
+{
+	ServerResponse response = call(OP_NB_NODE);
+	WireReader in = response.reader();
+	return in.i64();
+}
+
+int64_t GraphClient :: nbArc ()
+{
+	ServerResponse response = call(OP_NB_ARC);
+	WireReader in = response.reader();
+	return in.i64();
+}
+
+void GraphClient :: save (const std::string & file_name)
+{
+	WireWriter payload;
+	payload.str(file_name);
+	call(OP_SAVE, payload);
+}
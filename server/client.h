@@ -0,0 +1,131 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__client__
+#define __tinyGraphDb__client__
+
+#include <map>
+#include <unordered_map>
+
+#include "protocol.h"
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * ServerResponse struct
+	 *
+	 * status  : STATUS_OK or STATUS_ERROR
+	 * payload : Encoded result (or the encoded error message)
+	 *******************************************************************************/
+	struct ServerResponse
+	{
+		int status;
+		std::string payload;
+		
+		bool ok () const {return status == STATUS_OK;};
+		std::string error () const;
+		WireReader reader () const {return WireReader(payload);};
+	};
+	
+	
+	/*******************************************************************************
+	 * RemoteNode struct
+	 *******************************************************************************/
+	struct RemoteNode
+	{
+		int id;
+		std::string type;
+		std::map<std::string, std::string> properties;
+	};
+	
+	
+	/*******************************************************************************
+	 * GraphClient Class
+	 *
+	 * _fd        : Socket connected to the server
+	 * _next_id   : Id of the next request
+	 * _out       : Requests not yet written
+	 * _in        : Received bytes not yet decoded
+	 * _responses : Responses received but not yet waited for
+	 *
+	 * Connection to a graph server (not thread safe, use one client per thread).
+	 * send() only buffers a request: several requests can be sent before waiting
+	 * for their responses, which pipelines them on the connection. The other
+	 * methods send one request, wait for its response and throw an exception if
+	 * the server reports an error.
+	 *******************************************************************************/
+	class GraphClient
+	{
+	private:
+		int _fd;
+		uint32_t _next_id;
+		std::string _out;
+		std::string _in;
+		std::unordered_map<uint32_t, ServerResponse> _responses;
+		
+		void receive ();
+		ServerResponse call (int op, const WireWriter & payload);
+		ServerResponse call (int op) {return call(op, WireWriter());};
+		std::vector<int> callIds (int op, const WireWriter & payload);
+		
+	public:
+		explicit GraphClient (const std::string & address);
+		~GraphClient ();
+		GraphClient (const GraphClient &) = delete;
+		GraphClient & operator= (const GraphClient &) = delete;
+		
+		// Pipelining
+		uint32_t send (int op, const WireWriter & payload);
+		uint32_t send (int op) {return send(op, WireWriter());};
+		void flush ();
+		ServerResponse wait (uint32_t request_id);
+		
+		// Batch: execute the requests (op, payload) in order in one round trip
+		std::vector<ServerResponse> batch (const std::vector<std::pair<int, WireWriter> > & requests);
+		
+		void ping ();
+		int newNode (const std::string & type, const WireProperties & properties = WireProperties());
+		void newNodeWithId (int id, const std::string & type, const WireProperties & properties = WireProperties());
+		void addArc (int from, const std::string & type, int to, const WireProperties & properties = WireProperties());
+		void eraseNode (int id);
+		RemoteNode getNode (int id);
+		std::vector<int> getNodesOfType (const std::string & type);
+		std::vector<int> getNodesWithProperty (const std::string & name);
+		std::vector<int> getNodesWithProperty (const std::string & name, const std::string & value);
+		std::vector<int> getNodesWithPropertyValue (const std::string & value);
+		std::vector<int> getNodesOfTypeWithProperty (const std::string & type, const std::string & name);
+		std::vector<int> getNodesOfTypeWithProperty (const std::string & type, const std::string & name, const std::string & value);
+		std::vector<int> neighbors (int id, const std::string & arc_type = "");
+		int64_t nbNode ();
+		int64_t nbArc ();
+		// Save the graph in a file of the save directory of the server
+		void save (const std::string & file_name);
+		
+		// Decode the payload of a OP_GET_NODE response
+		static RemoteNode decodeNode (WireReader & in);
+	};
+	
+} // namespace tinygraphdb
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "handler.h"
+
+#include <algorithm>
+#include <mutex>
+
+using namespace tinygraphdb;
+
+// Write the ids of a set of nodes (sorted)
+static void writeNodes (WireWriter & out, const std::set<Node *> & nodes)
+{
+	std::vector<int> ids;
+	ids.reserve(nodes.size());
+	for (std::set<Node *>::const_iterator it = nodes.begin(); it != nodes.end(); it++) {
+		ids.push_back((*it)->unique_id());
+	}
+	std::sort(ids.begin(), ids.end());
+	out.ids(ids);
+}
+
+// Return the node with the given id (throw an exception if it does not exist)
+static Node * existingNode (GraphDb & db, int node_id)
+{
+	Node * node = db.getNode(node_id);
+	if (node == NULL) {
+		std::stringstream error_message;
+		error_message << "Node \'" << node_id << "\' does not exist";
+		throw std::runtime_error(error_message.str());
+	}
+	return node;
+}
+
+// Return the path of a file written by OP_SAVE: a plain file name in the save directory
+// (throw an exception if saving is disabled or the name is not a plain file name)
+static std::string savePath (const std::string & directory, std::string_view name)
+{
+	if (directory.empty()) {
+		throw std::runtime_error("Saving is disabled (start the server with -s save_directory)");
+	}
+	if (name.empty() || name == "." || name == ".." || name.find('/') != std::string_view::npos || name.find('\0') != std::string_view::npos) {
+		std::stringstream error_message;
+		error_message << "Invalid file name \'" << name << "\' (a file name without directory is expected)";
+		throw std::runtime_error(error_message.str());
+	}
+	return directory + "/" + std::string(name);
+}
+
+// Execute a request and append the response frame
+void RequestHandler :: handle (std::string_view body, WireWriter & out)
+{
+	WireReader in(body);
+	uint32_t request_id = in.u32();
+	int op = in.u8();
+	size_t frame = out.beginFrame();
+	out.u32(request_id);
+	execute(op, in, out, false);
+	out.endFrame(frame);
+}
+
+// Append the status and the payload of an operation (an error message if it fails)
+void RequestHandler :: execute (int op, WireReader & in, WireWriter & out, bool in_batch)
+{
+	size_t start = out.size();
+	out.u8(STATUS_OK);
+	try {
+		if (op == OP_BATCH) {
+			if (in_batch) {
+				throw std::runtime_error("Nested batches are not supported");
+			}
+			executeBatch(in, out);
+		} else if (isWriteOp(op)) {
+			std::unique_lock<std::shared_mutex> lock(_lock);
+			executeOne(op, in, out);
+		} else {
+			std::shared_lock<std::shared_mutex> lock(_lock);
+			executeOne(op, in, out);
+		}
+	} catch (std::exception & e) {
+		out.buffer().resize(start);
+		out.u8(STATUS_ERROR);
+		out.str(e.what());
+	}
+}
+
+// Execute the requests of a batch in order (each one has its own status)
+void RequestHandler :: executeBatch (WireReader & in, WireWriter & out)
+{
+	uint32_t count = in.u32();
+	std::vector<std::string_view> requests;
+	for (uint32_t i = 0; i < count; i++) {
+		requests.push_back(in.str());
+	}
+	out.u32(count);
+	for (uint32_t i = 0; i < count; i++) {
+		size_t frame = out.beginFrame();
+		WireReader request(requests[i]);
+		int op = request.u8();
+		execute(op, request, out, true);
+		out.endFrame(frame);
+	}
+}
+
+// Execute one operation on the graph and write its payload
+void RequestHandler :: executeOne (int op, WireReader & in, WireWriter & out)
+{
+	switch (op) {
+		case OP_PING:
+			break;
+		case OP_NEW_NODE: {
+			std::string_view type = in.str();
+			out.i32(_db.newNode(type, in.properties()));
+			break;
+		}
+		case OP_NEW_NODE_WITH_ID: {
+			int node_id = in.i32();
+			std::string_view type = in.str();
+			_db.newNodeWithId(node_id, type, in.properties());
+			break;
+		}
+		case OP_ADD_ARC: {
+			int from_id = in.i32();
+			std::string_view type = in.str();
+			int to_id = in.i32();
+			_db.addArc(from_id, type, to_id, in.properties());
+			break;
+		}
+		case OP_ERASE_NODE:
+			_db.eraseNode(in.i32());
+			break;
+		case OP_GET_NODE: {
+			Node * node = existingNode(_db, in.i32());
+			out.i32(node->unique_id());
+			out.str(node->type());
+			PropertyView properties = node->properties();
+			out.u32((uint32_t) properties.size());
+			for (PropertyView::const_iterator it = properties.begin(); it != properties.end(); it++) {
+				out.str(it.name());
+				out.str(it.value());
+			}
+			break;
+		}
+		case OP_GET_NODES_OF_TYPE:
+			writeNodes(out, *_db.cachedNodesOfType(in.str()));
+			break;
+		case OP_GET_NODES_WITH_PROPERTY:
+			writeNodes(out, *_db.cachedNodesWithProperty(in.str()));
+			break;
+		case OP_GET_NODES_WITH_PROPERTY_VALUE: {
+			std::string_view name = in.str();
+			writeNodes(out, *_db.cachedNodesWithProperty(name, in.str()));
+			break;
+		}
+		case OP_GET_NODES_WITH_VALUE:
+			writeNodes(out, *_db.cachedNodesWithPropertyValue(in.str()));
+			break;
+		case OP_GET_NODES_OF_TYPE_WITH_PROPERTY: {
+			std::string_view type = in.str();
+			writeNodes(out, *_db.cachedNodesOfTypeWithProperty(type, in.str()));
+			break;
+		}
+		case OP_GET_NODES_OF_TYPE_WITH_PROPERTY_VALUE: {
+			std::string_view type = in.str();
+			std::string_view name = in.str();
+			writeNodes(out, *_db.cachedNodesOfTypeWithProperty(type, name, in.str()));
+			break;
+		}
+		case OP_NEIGHBORS: {
+			Node * node = existingNode(_db, in.i32());
+			std::string_view type = in.str();
+			if (!type.empty()) {
+				writeNodes(out, node->getNodeFromArcOfType(type));
+			} else {
+				std::set<Node *> nodes;
+				for (std::set<Arc *>::const_iterator it = node->arcs().begin(); it != node->arcs().end(); it++) {
+					nodes.insert((*it)->fromNode() == node ? (*it)->toNode() : (*it)->fromNode());
+				}
+				writeNodes(out, nodes);
+			}
+			break;
+		}
+		case OP_NB_NODE:
+			out.i64(_db.nbNode());
+			break;
+		case OP_NB_ARC:
+			out.i64(_db.nbArc());
+			break;
+		case OP_SAVE:
+			_db.save(savePath(_save_directory, in.str()));
+			break;
+		default: {
+			std::stringstream error_message;
+			error_message << "Unknown operation " << op;
+			throw std::runtime_error(error_message.str());
+		}
+	}
+}
@@ -0,0 +1,68 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__handler__
+#define __tinyGraphDb__handler__
+
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+
+#include "tinygraphdb.h"
+#include "protocol.h"
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * RequestHandler Class
+	 *
+	 * _db             : The served graph
+	 * _lock           : Queries share the graph, changes are exclusive
+	 * _save_directory : Directory of the files written by OP_SAVE (disabled if empty)
+	 *
+	 * Execute requests of the binary protocol on a GraphDb. handle() can be
+	 * called from several threads at once.
+	 *******************************************************************************/
+	class RequestHandler
+	{
+	private:
+		GraphDb & _db;
+		std::shared_mutex _lock;
+		std::string _save_directory;
+		
+		void execute (int op, WireReader & in, WireWriter & out, bool in_batch);
+		void executeOne (int op, WireReader & in, WireWriter & out);
+		void executeBatch (WireReader & in, WireWriter & out);
+		
+	public:
+		explicit RequestHandler (GraphDb & db, const std::string & save_directory = ""): _db(db), _save_directory(save_directory) {};
+		
+		// Execute a request (frame body) and append the response frame
+		// (throw an exception if the request cannot be decoded)
+		void handle (std::string_view body, WireWriter & out);
+	};
+	
+} // namespace tinygraphdb
+
+#endif
@@ -0,0 +1,242 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "client.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+
+using namespace tinygraphdb;
+
+typedef std::chrono::steady_clock Clock;
+
+/*******************************************************************************
+ * LoadConfig struct
+ *******************************************************************************/
+struct LoadConfig
+{
+	std::string address;
+	int nb_connections;
+	int depth;
+	double seconds;
+	int write_percent;
+	int nb_samples;
+};
+
+/*******************************************************************************
+ * LoadResult struct
+ *
+ * latencies : Latency of every completed request in microseconds
+ *******************************************************************************/
+struct LoadResult
+{
+	long ops;
+	long errors;
+	std::vector<double> latencies;
+	
+	LoadResult (): ops(0), errors(0) {};
+};
+
+// Sample existing nodes (ids and types) with pipelined getNode requests
+static void sampleNodes (GraphClient & client, int nb_samples, std::vector<int> & ids, std::vector<std::string> & types)
+{
+	int64_t nb_nodes = client.nbNode();
+	int limit = (int) std::min<int64_t>(nb_nodes, nb_samples);
+	std::vector<uint32_t> requests;
+	for (int id = 0; id < limit; id++) {
+		WireWriter payload;
+		payload.i32(id);
+		requests.push_back(client.send(OP_GET_NODE, payload));
+	}
+	for (size_t i = 0; i < requests.size(); i++) {
+		ServerResponse response = client.wait(requests[i]);
+		if (!response.ok()) {
+			continue;
+		}
+		WireReader in = response.reader();
+		RemoteNode node = GraphClient::decodeNode(in);
+		ids.push_back(node.id);
+		if (std::find(types.begin(), types.end(), node.type) == types.end()) {
+			types.push_back(node.type);
+		}
+	}
+}
+
+// One connection: keep config.depth requests in flight until the deadline
+static void runConnection (const LoadConfig & config, const std::vector<int> & ids, const std::vector<std::string> & types, unsigned seed, LoadResult & result)
+{
+	GraphClient client(config.address);
+	std::mt19937_64 rng(seed);
+	std::uniform_int_distribution<int> pick_percent(0, 99);
+	std::uniform_int_distribution<size_t> pick_id(0, ids.size() - 1);
+	std::uniform_int_distribution<size_t> pick_type(0, types.size() - 1);
+	std::deque<std::pair<uint32_t, Clock::time_point> > in_flight;
+	Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.seconds));
+	
+	while (true) {
+		bool running = Clock::now() < deadline;
+		while (running && (int) in_flight.size() < config.depth) {
+			WireWriter payload;
+			int op;
+			int percent = pick_percent(rng);
+			if (percent < config.write_percent) {
+				op = OP_NEW_NODE;
+				payload.str(types[pick_type(rng)]);
+				payload.properties(WireProperties());
+			} else {
+				// Read mix: 50% getNode, 30% neighbors, 20% getNodesOfType
+				percent = pick_percent(rng);
+				if (percent < 50) {
+					op = OP_GET_NODE;
+					payload.i32(ids[pick_id(rng)]);
+				} else if (percent < 80) {
+					op = OP_NEIGHBORS;
+					payload.i32(ids[pick_id(rng)]);
+					payload.str("");
+				} else {
+					op = OP_GET_NODES_OF_TYPE;
+					payload.str(types[pick_type(rng)]);
+				}
+			}
+			in_flight.push_back(std::make_pair(client.send(op, payload), Clock::now()));
+		}
+		if (in_flight.empty()) {
+			break;
+		}
+		ServerResponse response = client.wait(in_flight.front().first);
+		result.latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - in_flight.front().second).count());
+		in_flight.pop_front();
+		result.ops++;
+		if (!response.ok()) {
+			result.errors++;
+		}
+	}
+}
+
+static double percentile (const std::vector<double> & sorted, double p)
+{
+	if (sorted.empty()) {
+		return 0;
+	}
+	size_t index = (size_t) (p * (sorted.size() - 1));
+	return sorted[index];
+}
+
+static void writeJson (std::ostream & out, const LoadConfig & config, long ops, long errors, double seconds, const std::vector<double> & latencies)
+{
+	out << "{\n  \"config\": {\"address\": \"" << config.address << "\", \"connections\": " << config.nb_connections << ", \"depth\": " << config.depth;
+	out << ", \"seconds\": " << config.seconds << ", \"write_percent\": " << config.write_percent << "},\n";
+	out << "  \"ops\": " << ops << ", \"errors\": " << errors << ", \"seconds\": " << seconds << ", \"ops_per_sec\": " << (seconds > 0 ? ops / seconds : 0) << ",\n";
+	out << "  \"latency_us\": {\"p50\": " << percentile(latencies, 0.5) << ", \"p90\": " << percentile(latencies, 0.9) << ", \"p99\": " << percentile(latencies, 0.99);
+	out << ", \"p999\": " << percentile(latencies, 0.999) << ", \"max\": " << (latencies.empty() ? 0 : latencies.back()) << "}\n}\n";
+}
+
+int main (int argc, const char * argv[])
+{
+	LoadConfig config;
+	config.address = "unix:/tmp/tinygraphdb.sock";
+	config.nb_connections = 4;
+	config.depth = 16;
+	config.seconds = 5;
+	config.write_percent = 0;
+	config.nb_samples = 10000;
+	std::string out_file;
+	
+	for (int i = 1; i + 1 < argc; i += 2) {
+		std::string arg = argv[i];
+		if (arg.compare("-a") == 0) config.address = argv[i + 1];
+		else if (arg.compare("-c") == 0) config.nb_connections = atoi(argv[i + 1]);
+		else if (arg.compare("-d") == 0) config.depth = atoi(argv[i + 1]);
+		else if (arg.compare("-t") == 0) config.seconds = atof(argv[i + 1]);
+		else if (arg.compare("-w") == 0) config.write_percent = atoi(argv[i + 1]);
+		else if (arg.compare("-o") == 0) out_file = argv[i + 1];
+		else {
+			config.nb_connections = 0;
+			break;
+		}
+	}
+	if (config.nb_connections <= 0 || config.depth <= 0 || config.write_percent < 0 || config.write_percent > 100) {
+		std::cerr << "Usage: " << argv[0] << " [-a unix:/path | [host:]port] [-c connections] [-d depth] [-t seconds] [-w write_percent] [-o results.json]\n";
+		return 1;
+	}
+	
+	std::vector<int> ids;
+	std::vector<std::string> types;
+	try {
+		GraphClient client(config.address);
+		sampleNodes(client, config.nb_samples, ids, types);
+	} catch (std::exception & e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	if (ids.empty()) {
+		std::cerr << "No node found on the server\n";
+		return 1;
+	}
+	
+	std::vector<LoadResult> results(config.nb_connections);
+	std::vector<std::thread> threads;
+	std::atomic<int> failures(0);
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < config.nb_connections; i++) {
+		threads.push_back(std::thread([&, i]() {
+			try {
+				runConnection(config, ids, types, 12345u + i, results[i]);
+			} catch (std::exception & e) {
+				std::cerr << "Connection " << i << ": " << e.what() << "\n";
+				failures++;
+			}
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	
+	long ops = 0;
+	long errors = 0;
+	std::vector<double> latencies;
+	for (size_t i = 0; i < results.size(); i++) {
+		ops += results[i].ops;
+		errors += results[i].errors;
+		latencies.insert(latencies.end(), results[i].latencies.begin(), results[i].latencies.end());
+	}
+	std::sort(latencies.begin(), latencies.end());
+	std::cerr << ops << " requests in " << seconds << " s (" << (seconds > 0 ? ops / seconds : 0) << " ops/s), " << errors << " errors\n";
+	
+	if (out_file.empty()) {
+		writeJson(std::cout, config, ops, errors, seconds, latencies);
+	} else {
+		std::ofstream outfile(out_file.c_str());
+		writeJson(outfile, config, ops, errors, seconds, latencies);
+	}
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "protocol.h"
+
+#include <stdlib.h>
+#include <sstream>
+#include <stdexcept>
+
+using namespace tinygraphdb;
+
+// Return true if the operation changes the graph
+bool tinygraphdb::isWriteOp (int op)
+{
+	return op == OP_NEW_NODE || op == OP_NEW_NODE_WITH_ID || op == OP_ADD_ARC || op == OP_ERASE_NODE;
+}
+
+// Parse "unix:/path", "/path", "port" or "host:port"
+ServerAddress ServerAddress :: parse (const std::string & address)
+{
+	ServerAddress result;
+	result.is_unix = false;
+	result.host = "127.0.0.1";
+	result.port = 0;
+	if (address.compare(0, 5, "unix:") == 0) {
+		result.is_unix = true;
+		result.path = address.substr(5);
+	} else if (!address.empty() && address[0] == '/') {
+		result.is_unix = true;
+		result.path = address;
+	} else {
+		size_t colon = address.rfind(':');
+		std::string port = address;
+		if (colon != std::string::npos) {
+			result.host = address.substr(0, colon);
+			port = address.substr(colon + 1);
+		}
+		result.port = atoi(port.c_str());
+	}
+	if ((result.is_unix && result.path.empty()) || (!result.is_unix && (result.port <= 0 || result.port > 65535))) {
+		std::stringstream error_message;
+		error_message << "Invalid server address '" << address << "'";
+		throw std::runtime_error(error_message.str());
+	}
+	return result;
+}
+
+/*******************************************************************************
+ * WireWriter methods
+ *******************************************************************************/
+
+void WireWriter :: u32 (uint32_t value)
+{
+	char bytes[4] = {(char) value, (char) (value >> 8), (char) (value >> 16), (char) (value >> 24)};
+	_buffer.append(bytes, 4);
+}
+
+void WireWriter :: i64 (int64_t value)
+{
+	u32((uint32_t) ((uint64_t) value));
+	u32((uint32_t) ((uint64_t) value >> 32));
+}
+
+void WireWriter :: str (std::string_view value)
+{
+	u32((uint32_t) value.size());
+	_buffer.append(value.data(), value.size());
+}
+
+void WireWriter :: ids (const std::vector<int> & ids)
+{
+	u32((uint32_t) ids.size());
+	for (size_t i = 0; i < ids.size(); i++) {
+		i32(ids[i]);
+	}
+}
+
+void WireWriter :: properties (const WireProperties & properties)
+{
+	u32((uint32_t) properties.size());
+	for (size_t i = 0; i < properties.size(); i++) {
+		str(properties[i].first);
+		str(properties[i].second);
+	}
+}
+
+// Reserve the length of a frame and return its position
+size_t WireWriter :: beginFrame ()
+{
+	size_t start = _buffer.size();
+	u32(0);
+	return start;
+}
+
+// Write the length of the frame started at the given position
+void WireWriter :: endFrame (size_t start)
+{
+	uint32_t length = (uint32_t) (_buffer.size() - start - 4);
+	_buffer[start] = (char) length;
+	_buffer[start + 1] = (char) (length >> 8);
+	_buffer[start + 2] = (char) (length >> 16);
+	_buffer[start + 3] = (char) (length >> 24);
+}
+
+/*******************************************************************************
+ * WireReader methods
+ *******************************************************************************/
+
+void WireReader :: need (size_t bytes)
+{
+	if ((size_t) (_end - _pos) < bytes) {
+		std::stringstream error_message;
+		error_message << "Truncated message (" << bytes << " bytes needed, " << (_end - _pos) << " left)";
+		throw std::runtime_error(error_message.str());
+	}
+}
+
+uint8_t WireReader :: u8 ()
+{
+	need(1);
+	return (uint8_t) *_pos++;
+}
+
+uint32_t WireReader :: u32 ()
+{
+	need(4);
+	const unsigned char * bytes = (const unsigned char *) _pos;
+	_pos += 4;
+	return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+int64_t WireReader :: i64 ()
+{
+	uint64_t low = u32();
+	uint64_t high = u32();
+	return (int64_t) (low | (high << 32));
+}
+
+std::string_view WireReader :: bytes (size_t size)
+{
+	need(size);
+	std::string_view bytes(_pos, size);
+	_pos += size;
+	return bytes;
+}
+
+std::string_view WireReader :: str ()
+{
+	return bytes(u32());
+}
+
+std::vector<int> WireReader :: ids ()
+{
+	uint32_t count = u32();
+	need((size_t) count * 4);
+	std::vector<int> ids(count);
+	for (uint32_t i = 0; i < count; i++) {
+		ids[i] = i32();
+	}
+	return ids;
+}
+
+WireProperties WireReader :: properties ()
+{
+	uint32_t count = u32();
+	need((size_t) count * 8);
+	WireProperties properties;
+	properties.reserve(count);
+	for (uint32_t i = 0; i < count; i++) {
+		std::string_view name = str();
+		std::string_view value = str();
+		properties.push_back(std::make_pair(name, value));
+	}
+	return properties;
+}
+
+// Return the body of the next complete frame in the buffer from the given offset (false if incomplete)
+bool tinygraphdb::nextFrame (const std::string & buffer, size_t & offset, std::string_view & body)
+{
+	if (buffer.size() - offset < 4) {
+		return false;
+	}
+	const unsigned char * bytes = (const unsigned char *) buffer.data() + offset;
+	uint32_t length = (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+	if (length > MAX_FRAME_SIZE) {
+		std::stringstream error_message;
+		error_message << "Frame too large (" << length << " bytes)";
+		throw std::runtime_error(error_message.str());
+	}
+	if (buffer.size() - offset - 4 < length) {
+		return false;
+	}
+	body = std::string_view(buffer.data() + offset + 4, length);
+	offset += 4 + length;
+	return true;
+}
@@ -0,0 +1,177 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__protocol__
+#define __tinyGraphDb__protocol__
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * Binary protocol of the graph server
+	 *
+	 * Every message is a frame: u32 length of the body, then the body.
+	 * Request body  : u32 request id, u8 operation, payload
+	 * Response body : u32 request id, u8 status, payload (an error message if the
+	 *                 status is STATUS_ERROR)
+	 *
+	 * Integers are little endian, strings are a u32 length and the bytes, sets of
+	 * node ids are a u32 count and i32 ids. Properties are a u32 count and
+	 * (name, value) string pairs.
+	 *
+	 * Requests can be pipelined: a client may send many requests before reading
+	 * the responses. The requests of a connection are executed one after the
+	 * other in the order they were sent, and answered in that order with the id
+	 * of their request; requests of different connections run concurrently.
+	 * OP_BATCH carries several requests executed in order (u32 count, then one
+	 * frame of u8 operation and payload per request) and is answered by one
+	 * response (u32 count, then one frame of u8 status and payload per request).
+	 *******************************************************************************/
+	enum ServerOp
+	{
+		OP_PING                                 = 0,  // -> ()
+		OP_NEW_NODE                             = 1,  // type, properties -> i32 id
+		OP_NEW_NODE_WITH_ID                     = 2,  // i32 id, type, properties -> ()
+		OP_ADD_ARC                              = 3,  // i32 from, type, i32 to, properties -> ()
+		OP_ERASE_NODE                           = 4,  // i32 id -> ()
+		OP_GET_NODE                             = 5,  // i32 id -> i32 id, type, properties
+		OP_GET_NODES_OF_TYPE                    = 6,  // type -> ids
+		OP_GET_NODES_WITH_PROPERTY              = 7,  // name -> ids
+		OP_GET_NODES_WITH_PROPERTY_VALUE        = 8,  // name, value -> ids
+		OP_GET_NODES_WITH_VALUE                 = 9,  // value -> ids
+		OP_GET_NODES_OF_TYPE_WITH_PROPERTY      = 10, // type, name -> ids
+		OP_GET_NODES_OF_TYPE_WITH_PROPERTY_VALUE = 11, // type, name, value -> ids
+		OP_NEIGHBORS                            = 12, // i32 id, arc type (empty for any) -> ids
+		OP_NB_NODE                              = 13, // -> i64
+		OP_NB_ARC                               = 14, // -> i64
+		OP_SAVE                                 = 15, // file name (in the save directory of the server) -> ()
+		OP_BATCH                                = 16, // requests -> responses
+		NB_SERVER_OPS
+	};
+	
+	enum ServerStatus
+	{
+		STATUS_OK    = 0,
+		STATUS_ERROR = 1
+	};
+	
+	// Frames larger than this are rejected (the connection is closed)
+	const uint32_t MAX_FRAME_SIZE = 64 << 20;
+	
+	// Return true if the operation changes the graph
+	bool isWriteOp (int op);
+	
+	// Properties as (name, value) pairs (same layout as tinygraphdb::PropertyPairs)
+	typedef std::vector<std::pair<std::string_view, std::string_view> > WireProperties;
+	
+	
+	/*******************************************************************************
+	 * ServerAddress struct
+	 *
+	 * "unix:/path" or "/path" for a Unix domain socket, "port" or "host:port" for
+	 * TCP (the server only listens on 127.0.0.1)
+	 *******************************************************************************/
+	struct ServerAddress
+	{
+		bool is_unix;
+		std::string path;
+		std::string host;
+		int port;
+		
+		static ServerAddress parse (const std::string & address);
+	};
+	
+	
+	/*******************************************************************************
+	 * WireWriter Class
+	 *
+	 * Append encoded values to a buffer
+	 *******************************************************************************/
+	class WireWriter
+	{
+	private:
+		std::string _buffer;
+		
+	public:
+		void u8 (uint8_t value) {_buffer.push_back((char) value);};
+		void u32 (uint32_t value);
+		void i32 (int32_t value) {u32((uint32_t) value);};
+		void i64 (int64_t value);
+		void str (std::string_view value);
+		void ids (const std::vector<int> & ids);
+		void properties (const WireProperties & properties);
+		void raw (std::string_view bytes) {_buffer.append(bytes.data(), bytes.size());};
+		
+		// Frames: beginFrame() reserves the length, endFrame() writes it
+		size_t beginFrame ();
+		void endFrame (size_t start);
+		
+		std::string & buffer () {return _buffer;};
+		const std::string & buffer () const {return _buffer;};
+		size_t size () const {return _buffer.size();};
+		void clear () {_buffer.clear();};
+	};
+	
+	
+	/*******************************************************************************
+	 * WireReader Class
+	 *
+	 * Decode values from a buffer (throw an exception if it is too short)
+	 *******************************************************************************/
+	class WireReader
+	{
+	private:
+		const char * _pos;
+		const char * _end;
+		
+		void need (size_t bytes);
+		
+	public:
+		WireReader (const char * data, size_t size): _pos(data), _end(data + size) {};
+		explicit WireReader (std::string_view data): _pos(data.data()), _end(data.data() + data.size()) {};
+		
+		uint8_t u8 ();
+		uint32_t u32 ();
+		int32_t i32 () {return (int32_t) u32();};
+		int64_t i64 ();
+		std::string_view str ();
+		std::string_view bytes (size_t size);
+		std::vector<int> ids ();
+		WireProperties properties ();
+		
+		bool done () const {return _pos == _end;};
+		size_t remaining () const {return _end - _pos;};
+	};
+	
+	// Return the body of the next complete frame in the buffer from the given offset (false if incomplete)
+	bool nextFrame (const std::string & buffer, size_t & offset, std::string_view & body);
+	
+} // namespace tinygraphdb
+
+#endif
@@ -0,0 +1,500 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "handler.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+using namespace tinygraphdb;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void requestStop (int)
+{
+	stop_requested = 1;
+}
+
+/*******************************************************************************
+ * Connection struct
+ *
+ * fd        : Socket (only used by the event loop thread)
+ * in        : Received bytes not yet decoded (event loop thread)
+ * requests  : Decoded requests not yet executed, in the order they came
+ * scheduled : true while the connection is in the job queue or a worker runs one of its requests
+ * out       : Response frames appended by the workers
+ * sending   : Bytes being written by the event loop thread, from offset sent
+ *
+ * The requests of a connection are executed one at a time and in order, so
+ * that a pipelined request sees the changes of the ones sent before it.
+ * Different connections are executed concurrently.
+ *******************************************************************************/
+struct Connection
+{
+	int fd;
+	std::string in;
+	std::mutex requests_mutex;
+	std::deque<std::string> requests;
+	bool scheduled;
+	std::mutex out_mutex;
+	std::string out;
+	std::string sending;
+	size_t sent;
+	std::atomic<bool> closed;
+	
+	explicit Connection (int fd): fd(fd), scheduled(false), sent(0), closed(false) {};
+};
+
+typedef std::shared_ptr<Connection> ConnectionPtr;
+
+
+/*******************************************************************************
+ * JobQueue Class
+ *
+ * Connections with requests to execute, taken by the worker pool (a worker
+ * executes one request, then queues the connection again if it has more)
+ *******************************************************************************/
+class JobQueue
+{
+private:
+	std::mutex _mutex;
+	std::condition_variable _ready;
+	std::deque<ConnectionPtr> _jobs;
+	bool _stopped;
+	
+public:
+	JobQueue (): _stopped(false) {};
+	
+	void push (const ConnectionPtr & connection)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_jobs.push_back(connection);
+		}
+		_ready.notify_one();
+	};
+	
+	// Wait for a connection (false once the queue is stopped)
+	bool pop (ConnectionPtr & connection)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (_jobs.empty() && !_stopped) {
+			_ready.wait(lock);
+		}
+		if (_jobs.empty()) {
+			return false;
+		}
+		connection = std::move(_jobs.front());
+		_jobs.pop_front();
+		return true;
+	};
+	
+	void stop ()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopped = true;
+		}
+		_ready.notify_all();
+	};
+};
+
+
+/*******************************************************************************
+ * Server Class
+ *
+ * _handler : Executes the requests on the graph
+ * _epoll   : Event loop (listening socket, connections, wake up event)
+ * _wake_fd : Written by the workers when responses are ready to be sent
+ * _ready   : Connections with responses to send
+ * _jobs    : Connections with requests to execute
+ * _workers : Worker pool executing the requests
+ *
+ * One thread runs the event loop: it accepts connections, reads and decodes
+ * request frames and writes the responses. Workers only execute requests,
+ * one at a time per connection.
+ *******************************************************************************/
+class Server
+{
+private:
+	RequestHandler & _handler;
+	int _listen_fd;
+	int _epoll;
+	int _wake_fd;
+	std::unordered_map<int, ConnectionPtr> _connections;
+	std::mutex _ready_mutex;
+	std::vector<ConnectionPtr> _ready;
+	JobQueue _jobs;
+	std::vector<std::thread> _workers;
+	
+	void accept ();
+	void receive (const ConnectionPtr & connection);
+	void send (const ConnectionPtr & connection);
+	void close (const ConnectionPtr & connection);
+	void work ();
+	void execute (const ConnectionPtr & connection, const std::string & body, WireWriter & out);
+	
+public:
+	Server (RequestHandler & handler, const ServerAddress & address, int nb_workers);
+	~Server ();
+	
+	void run ();
+};
+
+// Throw an exception with the message of errno
+static void systemError (const std::string & what)
+{
+	std::stringstream error_message;
+	error_message << what << ": " << strerror(errno);
+	throw std::runtime_error(error_message.str());
+}
+
+Server :: Server (RequestHandler & handler, const ServerAddress & address, int nb_workers): _handler(handler)
+{
+	if (address.is_unix) {
+		_listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (_listen_fd < 0) systemError("socket");
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (address.path.size() >= sizeof(addr.sun_path)) {
+			throw std::runtime_error("Unix socket path too long");
+		}
+		strcpy(addr.sun_path, address.path.c_str());
+		unlink(address.path.c_str());
+		if (bind(_listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) systemError("bind " + address.path);
+	} else {
+		_listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (_listen_fd < 0) systemError("socket");
+		int one = 1;
+		setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons((uint16_t) address.port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (bind(_listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) systemError("bind");
+	}
+	if (listen(_listen_fd, 128) < 0) systemError("listen");
+	
+	_epoll = epoll_create1(EPOLL_CLOEXEC);
+	_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (_epoll < 0 || _wake_fd < 0) systemError("epoll");
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.fd = _listen_fd;
+	epoll_ctl(_epoll, EPOLL_CTL_ADD, _listen_fd, &event);
+	event.data.fd = _wake_fd;
+	epoll_ctl(_epoll, EPOLL_CTL_ADD, _wake_fd, &event);
+	
+	for (int i = 0; i < nb_workers; i++) {
+		_workers.push_back(std::thread(&Server::work, this));
+	}
+}
+
+Server :: ~Server ()
+{
+	_jobs.stop();
+	for (size_t i = 0; i < _workers.size(); i++) {
+		_workers[i].join();
+	}
+	for (std::unordered_map<int, ConnectionPtr>::iterator it = _connections.begin(); it != _connections.end(); it++) {
+		::close(it->first);
+	}
+	::close(_listen_fd);
+	::close(_wake_fd);
+	::close(_epoll);
+}
+
+// Event loop (until SIGINT or SIGTERM)
+void Server :: run ()
+{
+	struct epoll_event events[64];
+	while (!stop_requested) {
+		int nb_events = epoll_wait(_epoll, events, 64, 200);
+		if (nb_events < 0) {
+			if (errno == EINTR) continue;
+			systemError("epoll_wait");
+		}
+		for (int i = 0; i < nb_events; i++) {
+			int fd = events[i].data.fd;
+			if (fd == _listen_fd) {
+				accept();
+			} else if (fd == _wake_fd) {
+				uint64_t count;
+				while (read(_wake_fd, &count, sizeof(count)) > 0) {}
+				std::vector<ConnectionPtr> ready;
+				{
+					std::lock_guard<std::mutex> lock(_ready_mutex);
+					ready.swap(_ready);
+				}
+				for (size_t c = 0; c < ready.size(); c++) {
+					if (!ready[c]->closed) {
+						send(ready[c]);
+					}
+				}
+			} else {
+				std::unordered_map<int, ConnectionPtr>::iterator it = _connections.find(fd);
+				if (it == _connections.end()) {
+					continue;
+				}
+				ConnectionPtr connection = it->second;
+				if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+					receive(connection);
+				}
+				if (!connection->closed && (events[i].events & EPOLLOUT)) {
+					send(connection);
+				}
+			}
+		}
+	}
+}
+
+// Accept the pending connections
+void Server :: accept ()
+{
+	while (true) {
+		int fd = accept4(_listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				std::cerr << "accept: " << strerror(errno) << "\n";
+			}
+			return;
+		}
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		struct epoll_event event;
+		event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		event.data.fd = fd;
+		epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event);
+		_connections[fd] = std::make_shared<Connection>(fd);
+	}
+}
+
+// Read everything available and queue the complete requests
+void Server :: receive (const ConnectionPtr & connection)
+{
+	char buffer[65536];
+	bool eof = false;
+	while (true) {
+		ssize_t size = read(connection->fd, buffer, sizeof(buffer));
+		if (size > 0) {
+			connection->in.append(buffer, size);
+		} else if (size == 0) {
+			eof = true;
+			break;
+		} else if (errno == EINTR) {
+			continue;
+		} else {
+			eof = (errno != EAGAIN && errno != EWOULDBLOCK);
+			break;
+		}
+	}
+	size_t offset = 0;
+	std::string_view body;
+	bool schedule = false;
+	try {
+		std::lock_guard<std::mutex> lock(connection->requests_mutex);
+		while (nextFrame(connection->in, offset, body)) {
+			connection->requests.push_back(std::string(body));
+		}
+		if (!connection->requests.empty() && !connection->scheduled) {
+			connection->scheduled = true;
+			schedule = true;
+		}
+	} catch (std::exception & e) {
+		std::cerr << "Connection " << connection->fd << ": " << e.what() << "\n";
+		eof = true;
+	}
+	if (schedule) {
+		_jobs.push(connection);
+	}
+	connection->in.erase(0, offset);
+	if (eof) {
+		close(connection);
+	}
+}
+
+// Write the pending responses (until the socket is full)
+void Server :: send (const ConnectionPtr & connection)
+{
+	while (true) {
+		if (connection->sent == connection->sending.size()) {
+			connection->sending.clear();
+			connection->sent = 0;
+			std::lock_guard<std::mutex> lock(connection->out_mutex);
+			connection->sending.swap(connection->out);
+		}
+		if (connection->sending.empty()) {
+			return;
+		}
+		ssize_t size = write(connection->fd, connection->sending.data() + connection->sent, connection->sending.size() - connection->sent);
+		if (size > 0) {
+			connection->sent += size;
+		} else if (size < 0 && errno == EINTR) {
+			continue;
+		} else if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return; // EPOLLOUT will tell when the socket can be written again
+		} else {
+			close(connection);
+			return;
+		}
+	}
+}
+
+void Server :: close (const ConnectionPtr & connection)
+{
+	if (connection->closed.exchange(true)) {
+		return;
+	}
+	epoll_ctl(_epoll, EPOLL_CTL_DEL, connection->fd, NULL);
+	::close(connection->fd);
+	_connections.erase(connection->fd);
+}
+
+// Worker: execute the next request of a connection and hand the response to the event loop
+void Server :: work ()
+{
+	ConnectionPtr connection;
+	WireWriter out;
+	std::string body;
+	while (_jobs.pop(connection)) {
+		{
+			std::lock_guard<std::mutex> lock(connection->requests_mutex);
+			body.swap(connection->requests.front());
+			connection->requests.pop_front();
+		}
+		if (!connection->closed) {
+			execute(connection, body, out);
+		}
+		// Queue the connection again for its next request (behind the other connections)
+		bool again;
+		{
+			std::lock_guard<std::mutex> lock(connection->requests_mutex);
+			if (connection->closed) {
+				connection->requests.clear();
+			}
+			again = !connection->requests.empty();
+			connection->scheduled = again;
+		}
+		if (again) {
+			_jobs.push(connection);
+		}
+		connection.reset();
+	}
+}
+
+void Server :: execute (const ConnectionPtr & connection, const std::string & body, WireWriter & out)
+{
+	out.clear();
+	try {
+		_handler.handle(body, out);
+	} catch (std::exception & e) {
+		// The request could not even be decoded: no id to answer to
+		std::cerr << "Bad request: " << e.what() << "\n";
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(connection->out_mutex);
+		connection->out.append(out.buffer());
+	}
+	{
+		std::lock_guard<std::mutex> lock(_ready_mutex);
+		_ready.push_back(connection);
+	}
+	uint64_t one = 1;
+	if (write(_wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+		std::cerr << "eventfd: " << strerror(errno) << "\n";
+	}
+}
+
+int main (int argc, const char * argv[])
+{
+	std::string graph_file;
+	std::string address = "unix:/tmp/tinygraphdb.sock";
+	std::string save_directory;
+	int cache_capacity = 1024;
+	int nb_workers = (int) std::thread::hardware_concurrency();
+	if (nb_workers <= 0) {
+		nb_workers = 4;
+	}
+	
+	for (int i = 1; i + 1 < argc; i += 2) {
+		std::string arg = argv[i];
+		if (arg.compare("-f") == 0) graph_file = argv[i + 1];
+		else if (arg.compare("-a") == 0) address = argv[i + 1];
+		else if (arg.compare("-w") == 0) nb_workers = atoi(argv[i + 1]);
+		else if (arg.compare("-c") == 0) cache_capacity = atoi(argv[i + 1]);
+		else if (arg.compare("-s") == 0) save_directory = argv[i + 1];
+		else {
+			graph_file.clear();
+			break;
+		}
+	}
+	if (graph_file.empty() || nb_workers <= 0 || cache_capacity < 0) {
+		std::cerr << "Usage: " << argv[0] << " -f graph.tgdb [-a unix:/path | [host:]port] [-w nb_workers] [-c query_cache_capacity] [-s save_directory]\n";
+		return 1;
+	}
+	
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, requestStop);
+	signal(SIGTERM, requestStop);
+	
+	GraphDb db(graph_file);
+	std::cerr << "Loaded " << graph_file << ": " << db.nbNode() << " nodes, " << db.nbArc() << " arcs\n";
+	db.enableQueryCache(cache_capacity);
+	RequestHandler handler(db, save_directory);
+	try {
+		ServerAddress server_address = ServerAddress::parse(address);
+		Server server(handler, server_address, nb_workers);
+		std::cerr << "Listening on " << address << " with " << nb_workers << " workers\n";
+		server.run();
+		if (server_address.is_unix) {
+			unlink(server_address.path.c_str());
+		}
+	} catch (std::exception & e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	StatsSnapshot stats = db.stats();
+	if (stats.enabled) {
+		std::cerr << stats.toText();
+	}
+	return 0;
+}
@@ -0,0 +1,384 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "adjacency.h"
+
+#include <algorithm>
+
+using namespace tinygraphdb;
+
+const uint32_t CompressedAdjacency :: SKIP_INTERVAL;
+
+void CompressedAdjacency :: writeVarint (std::vector<uint8_t> & out, uint32_t value)
+{
+	while (value >= 0x80) {
+		out.push_back((uint8_t) (value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((uint8_t) value);
+}
+
+// Encode the arcs of every node of the GraphDb, then reorder them
+void CompressedAdjacency :: build (GraphDb & db, NodeOrder order)
+{
+	std::vector<Node *> nodes = _map.build(db);
+	
+	_data.clear();
+	_internal.clear();
+	_external.clear();
+	_skips.clear();
+	_nb_arcs = 0;
+	_order = ORDER_ID;
+	
+	std::vector<std::pair<uint32_t, int> > entries; // (key, neighbor index)
+	_map.buildRows(nodes, _offsets, [&](Node * node) {
+		entries.clear();
+		for (std::set<Arc *>::const_iterator it = node->arcs().begin(); it != node->arcs().end(); it++) {
+			bool outgoing = (*it)->fromNode() == node;
+			Node * other = outgoing ? (*it)->toNode() : (*it)->fromNode();
+			entries.push_back(std::make_pair(((uint32_t) (*it)->typeId() << 1) | (outgoing ? 1 : 0), _map.index(other->unique_id())));
+			if (outgoing) {
+				_nb_arcs++;
+			}
+		}
+		std::sort(entries.begin(), entries.end());
+		encodeBlock(entries);
+		return (uint64_t) _data.size();
+	});
+	_data.shrink_to_fit();
+	_offsets.shrink_to_fit();
+	_skips.shrink_to_fit();
+	
+	if (order != ORDER_ID) {
+		reorder(order);
+	}
+}
+
+void CompressedAdjacency :: encodeBlock (const std::vector<std::pair<uint32_t, int> > & entries)
+{
+	std::vector<uint8_t> list;
+	std::vector<SkipEntry> skips;
+	uint32_t nb_lists = 0;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (i == 0 || entries[i].first != entries[i - 1].first) nb_lists++;
+	}
+	writeVarint(_data, nb_lists);
+	for (size_t begin = 0; begin < entries.size(); ) {
+		size_t end = begin;
+		while (end < entries.size() && entries[end].first == entries[begin].first) end++;
+		uint32_t count = (uint32_t) (end - begin);
+		list.clear();
+		skips.clear();
+		for (size_t i = begin; i < end; i++) {
+			int id = entries[i].second;
+			if (i == begin) {
+				writeVarint(list, ((uint32_t) id << 1) ^ (uint32_t) (id >> 31));
+			} else {
+				if ((i - begin) % SKIP_INTERVAL == 0) {
+					SkipEntry skip = {entries[i - 1].second, (uint32_t) list.size()};
+					skips.push_back(skip);
+				}
+				writeVarint(list, (uint32_t) id - (uint32_t) entries[i - 1].second);
+			}
+		}
+		writeVarint(_data, entries[begin].first);
+		writeVarint(_data, count);
+		writeVarint(_data, (uint32_t) list.size());
+		if (count > SKIP_INTERVAL) {
+			writeVarint(_data, (uint32_t) _skips.size());
+			_skips.insert(_skips.end(), skips.begin(), skips.end());
+		}
+		_data.insert(_data.end(), list.begin(), list.end());
+		begin = end;
+	}
+}
+
+// Relabel the internal indexes and encode the blocks again in the new order
+void CompressedAdjacency :: reorder (NodeOrder order)
+{
+	size_t nb_index = nbIndex();
+	
+	// Undirected neighbors of every index
+	std::vector<uint32_t> starts(nb_index + 1, 0);
+	std::vector<int> neighbors;
+	neighbors.reserve(2 * _nb_arcs);
+	for (size_t i = 0; i < nb_index; i++) {
+		forEachInternalArc((int) i, [&](int neighbor, int, bool) {neighbors.push_back(neighbor);});
+		starts[i + 1] = (uint32_t) neighbors.size();
+	}
+	
+	// by_id: indexes in id order, permutation: old index of each new index
+	std::vector<int> by_id(nb_index);
+	for (size_t s = 0; s < nb_index; s++) {
+		by_id[s] = _internal.empty() ? (int) s : _internal[s];
+	}
+	std::vector<int> permutation;
+	permutation.reserve(nb_index);
+	if (order == ORDER_ID) {
+		permutation = by_id;
+	} else if (order == ORDER_DEGREE) {
+		permutation = by_id;
+		std::stable_sort(permutation.begin(), permutation.end(), [&](int a, int b) {return starts[a + 1] - starts[a] > starts[b + 1] - starts[b];});
+	} else {
+		// Breadth first from every node not reached yet (by id, or by increasing degree for RCM)
+		std::vector<int> roots = by_id;
+		if (order == ORDER_RCM) {
+			std::stable_sort(roots.begin(), roots.end(), [&](int a, int b) {return starts[a + 1] - starts[a] < starts[b + 1] - starts[b];});
+		}
+		std::vector<char> reached(nb_index, 0);
+		for (size_t r = 0; r < roots.size(); r++) {
+			if (reached[roots[r]]) {
+				continue;
+			}
+			reached[roots[r]] = 1;
+			size_t head = permutation.size();
+			permutation.push_back(roots[r]);
+			for (; head < permutation.size(); head++) {
+				int index = permutation[head];
+				size_t first_new = permutation.size();
+				for (uint32_t n = starts[index]; n < starts[index + 1]; n++) {
+					if (!reached[neighbors[n]]) {
+						reached[neighbors[n]] = 1;
+						permutation.push_back(neighbors[n]);
+					}
+				}
+				if (order == ORDER_RCM) {
+					std::stable_sort(permutation.begin() + first_new, permutation.end(), [&](int a, int b) {return starts[a + 1] - starts[a] < starts[b + 1] - starts[b];});
+				}
+			}
+		}
+		if (order == ORDER_RCM) {
+			std::reverse(permutation.begin(), permutation.end());
+		}
+	}
+	neighbors.clear();
+	neighbors.shrink_to_fit();
+	
+	std::vector<int> new_index(nb_index);
+	for (size_t i = 0; i < nb_index; i++) {
+		new_index[permutation[i]] = (int) i;
+	}
+	
+	// Blocks in the new order, with the new indexes of the neighbors
+	std::vector<uint8_t> data;
+	std::vector<uint64_t> offsets;
+	std::vector<SkipEntry> skips;
+	data.swap(_data);
+	offsets.swap(_offsets);
+	skips.swap(_skips);
+	CompressedAdjacency old;
+	old._data.swap(data);
+	old._offsets.swap(offsets);
+	old._skips.swap(skips);
+	
+	_data.reserve(old._data.size());
+	_offsets.reserve(nb_index + 1);
+	std::vector<std::pair<uint32_t, int> > entries;
+	for (size_t i = 0; i < nb_index; i++) {
+		_offsets.push_back(_data.size());
+		entries.clear();
+		old.forEachInternalArc(permutation[i], [&](int neighbor, int type, bool outgoing) {
+			entries.push_back(std::make_pair(((uint32_t) type << 1) | (outgoing ? 1 : 0), new_index[neighbor]));
+		});
+		std::sort(entries.begin(), entries.end());
+		encodeBlock(entries);
+	}
+	_offsets.push_back(_data.size());
+	_data.shrink_to_fit();
+	_skips.shrink_to_fit();
+	
+	// Slot and node id of every new index
+	std::vector<int> external(nb_index);
+	for (size_t i = 0; i < nb_index; i++) {
+		external[i] = externalId(permutation[i]);
+	}
+	_internal.resize(nb_index);
+	for (size_t s = 0; s < nb_index; s++) {
+		_internal[s] = new_index[by_id[s]];
+	}
+	_external.swap(external);
+	if (order == ORDER_ID) {
+		_internal.clear();
+		_external.clear();
+	}
+	_internal.shrink_to_fit();
+	_external.shrink_to_fit();
+	_order = order;
+}
+
+const uint8_t * CompressedAdjacency :: block (int index) const
+{
+	if (_offsets[index] == _offsets[index + 1]) {
+		return NULL;
+	}
+	return &_data[_offsets[index]];
+}
+
+// Return true if a list contains the index (decode at most one run)
+bool CompressedAdjacency :: listContains (const uint8_t * it, uint32_t count, uint32_t first_skip, int id) const
+{
+	int32_t previous = 0;
+	bool first_zigzag = true;
+	uint32_t remaining = count;
+	if (count > SKIP_INTERVAL) {
+		// Skip entry s starts the run s + 1: take the last one before the id
+		std::vector<SkipEntry>::const_iterator first = _skips.begin() + first_skip;
+		std::vector<SkipEntry>::const_iterator last = first + (count - 1) / SKIP_INTERVAL;
+		std::vector<SkipEntry>::const_iterator skip = std::lower_bound(first, last, id, [](const SkipEntry & entry, int value) {return entry.previous < value;});
+		if (skip != first) {
+			skip--;
+			uint32_t run = (uint32_t) (skip - first) + 1;
+			it += skip->offset;
+			previous = skip->previous;
+			first_zigzag = false;
+			remaining = count - run * SKIP_INTERVAL;
+		}
+		remaining = std::min(remaining, SKIP_INTERVAL);
+	}
+	for (uint32_t i = 0; i < remaining; i++) {
+		if (first_zigzag) {
+			uint32_t zigzag = readVarint(it);
+			previous = (int32_t) ((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+			first_zigzag = false;
+		} else {
+			previous = (int32_t) ((uint32_t) previous + readVarint(it));
+		}
+		if (previous >= id) {
+			return previous == id;
+		}
+	}
+	return false;
+}
+
+// Find the list of a key in the block of an internal index (false if there is none)
+bool CompressedAdjacency :: findList (int index, uint32_t key, ListHeader & header) const
+{
+	if (index < 0) {
+		return false;
+	}
+	const uint8_t * it = block(index);
+	if (it == NULL) {
+		return false;
+	}
+	uint32_t nb_lists = readVarint(it);
+	for (uint32_t l = 0; l < nb_lists; l++) {
+		header.key = readVarint(it);
+		header.count = readVarint(it);
+		uint32_t size = readVarint(it);
+		header.first_skip = header.count > SKIP_INTERVAL ? readVarint(it) : 0;
+		header.ids = it;
+		if (header.key == key) {
+			return true;
+		}
+		if (header.key > key) {
+			return false;
+		}
+		it += size;
+	}
+	return false;
+}
+
+// Return the neighbors of a node through arcs of a type (both directions, sorted)
+std::vector<int> CompressedAdjacency :: getNodeFromArcOfType (int node_id, std::string_view type) const
+{
+	std::vector<int> ids;
+	int type_id = StringPool::instance().lookup(type);
+	if (type_id < 0) {
+		return ids;
+	}
+	int index = internalId(node_id);
+	ListHeader header;
+	size_t middle = 0;
+	for (uint32_t outgoing = 0; outgoing < 2; outgoing++) {
+		if (findList(index, ((uint32_t) type_id << 1) | outgoing, header)) {
+			decodeIds(header.ids, header.count, 0, true, [&](int neighbor) {ids.push_back(externalId(neighbor));});
+		}
+		if (outgoing == 0) {
+			middle = ids.size();
+		}
+	}
+	if (!_external.empty()) {
+		// Internal indexes are not in id order
+		std::sort(ids.begin(), ids.end());
+		ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	} else if (middle > 0 && middle < ids.size()) {
+		std::inplace_merge(ids.begin(), ids.begin() + middle, ids.end());
+		ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	}
+	return ids;
+}
+
+bool CompressedAdjacency :: hasArcOfType (int node_id, std::string_view type) const
+{
+	int type_id = StringPool::instance().lookup(type);
+	int index = internalId(node_id);
+	ListHeader header;
+	return type_id >= 0 && (findList(index, (uint32_t) type_id << 1, header) || findList(index, ((uint32_t) type_id << 1) | 1, header));
+}
+
+// Check the existence of an arc of the given type between two nodes (in either direction)
+bool CompressedAdjacency :: hasArcOfTypeToNode (int node_id, std::string_view type, int other_id) const
+{
+	int type_id = StringPool::instance().lookup(type);
+	int index = internalId(node_id);
+	int other_index = internalId(other_id);
+	if (type_id < 0 || index < 0 || other_index < 0) {
+		return false;
+	}
+	ListHeader header;
+	for (uint32_t outgoing = 0; outgoing < 2; outgoing++) {
+		if (findList(index, ((uint32_t) type_id << 1) | outgoing, header) && listContains(header.ids, header.count, header.first_skip, other_index)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t CompressedAdjacency :: degree (int node_id) const
+{
+	int index = internalId(node_id);
+	const uint8_t * it = index < 0 ? NULL : block(index);
+	if (it == NULL) {
+		return 0;
+	}
+	size_t degree = 0;
+	uint32_t nb_lists = readVarint(it);
+	for (uint32_t l = 0; l < nb_lists; l++) {
+		readVarint(it);
+		uint32_t count = readVarint(it);
+		uint32_t size = readVarint(it);
+		if (count > SKIP_INTERVAL) {
+			readVarint(it);
+		}
+		degree += count;
+		it += size;
+	}
+	return degree;
+}
+
+MemoryUsage CompressedAdjacency :: memoryUsage () const
+{
+	size_t bytes = _data.capacity() + _offsets.capacity() * sizeof(uint64_t) + (_internal.capacity() + _external.capacity()) * sizeof(int) + _map.memoryUsage() + _skips.capacity() * sizeof(SkipEntry);
+	return MemoryUsage("compressed_adjacency", 2 * _nb_arcs, bytes);
+}
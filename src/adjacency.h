@@ -0,0 +1,274 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__adjacency__
+#define __tinyGraphDb__adjacency__
+
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+#include "tinygraphdb.h"
+#include "nodemap.h"
+
+// SSE2 is part of x86-64: the decoder uses it without a -march flag
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TGDB_ADJACENCY_SSE2
+#endif
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * NodeOrder enum
+	 *
+	 * Order of the nodes in a CompressedAdjacency:
+	 * ORDER_ID     : by id (the order of build)
+	 * ORDER_BFS    : breadth first, one connected component after the other
+	 * ORDER_RCM    : reverse Cuthill-McKee (breadth first from a node of low
+	 *                degree, neighbors by increasing degree, then reversed)
+	 * ORDER_DEGREE : by decreasing degree (the hubs together)
+	 *******************************************************************************/
+	enum NodeOrder
+	{
+		ORDER_ID,
+		ORDER_BFS,
+		ORDER_RCM,
+		ORDER_DEGREE
+	};
+	
+	
+	/*******************************************************************************
+	 * CompressedAdjacency Class
+	 *
+	 * _data     : Adjacency blocks of the nodes, one after the other
+	 * _offsets  : Offset of the block of each node in _data (one more at the end)
+	 * _map      : Node id to slot (the index in ORDER_ID)
+	 * _internal : Internal index of each slot (empty in ORDER_ID: the slot is the index)
+	 * _external : Node id of each internal index (empty in ORDER_ID)
+	 * _skips    : Skip entries of the long lists
+	 * _order    : Current order of the internal indexes
+	 *
+	 * Compact copy of the arcs of a GraphDb (about 1 to 2 bytes per arc end
+	 * instead of a set node with a pointer), for traversals of graphs too large
+	 * for Node::arcs(). The adjacency is read only: build() it again after the
+	 * graph changes.
+	 *
+	 * Nodes are stored by internal index, and the neighbors in the blocks are
+	 * internal indexes too. reorder() relabels them (and moves the blocks) so
+	 * that neighbors are close in memory and their deltas small; node ids stay
+	 * the same. The methods taking node ids translate them, traversals that
+	 * want the locality use internalId, forEachInternalArc and externalId.
+	 *
+	 * The block of a node is a list of neighbor indexes per (arc type,
+	 * direction): varint number of lists, then for each list varint key (arc
+	 * type << 1 | outgoing), varint count, varint size in bytes, varint first
+	 * skip entry (only if count > SKIP_INTERVAL) and the indexes. Indexes are
+	 * sorted and delta encoded: the first one zigzag, the others as the
+	 * difference with the previous one, every value as a LEB128 varint. A skip
+	 * entry every SKIP_INTERVAL indexes (the previous index and the byte offset)
+	 * lets hasArcOfTypeToNode decode a single run of a long list. With SSE2,
+	 * runs of 16 (or 8) one-byte deltas, the common case after reorder(), are
+	 * decoded at once (a byte mask test and a prefix sum) instead of one by one.
+	 *******************************************************************************/
+	class CompressedAdjacency
+	{
+	public:
+		static const uint32_t SKIP_INTERVAL = 64;
+		
+	private:
+		struct SkipEntry
+		{
+			int32_t previous; // id before the run (the last id of the previous run)
+			uint32_t offset;  // offset of the run in the list
+		};
+		
+		std::vector<uint8_t> _data;
+		std::vector<uint64_t> _offsets;
+		NodeIdMap _map;
+		std::vector<int> _internal;
+		std::vector<int> _external;
+		size_t _nb_arcs;
+		std::vector<SkipEntry> _skips;
+		NodeOrder _order;
+		
+		struct ListHeader
+		{
+			uint32_t key;
+			uint32_t count;
+			uint32_t first_skip;
+			const uint8_t * ids;
+		};
+		
+		// Return the block of an internal index (NULL if it has no arc)
+		const uint8_t * block (int index) const;
+		// Append the block of sorted (key, neighbor index) entries to _data
+		void encodeBlock (const std::vector<std::pair<uint32_t, int> > & entries);
+		bool findList (int index, uint32_t key, ListHeader & header) const;
+		bool listContains (const uint8_t * it, uint32_t count, uint32_t first_skip, int id) const;
+		
+		static uint32_t readVarint (const uint8_t * & it)
+		{
+			uint32_t value = *it & 0x7F;
+			if (*it++ < 0x80) return value;
+			value |= (uint32_t) (*it & 0x7F) << 7;
+			if (*it++ < 0x80) return value;
+			value |= (uint32_t) (*it & 0x7F) << 14;
+			if (*it++ < 0x80) return value;
+			value |= (uint32_t) (*it & 0x7F) << 21;
+			if (*it++ < 0x80) return value;
+			value |= (uint32_t) *it++ << 28;
+			return value;
+		};
+		static void writeVarint (std::vector<uint8_t> & out, uint32_t value);
+		
+		// Decode count ids of a list from previous (first_zigzag for the start of the list)
+		template <class F> static void decodeIds (const uint8_t * it, uint32_t count, int32_t previous, bool first_zigzag, F f);
+		
+	public:
+		CompressedAdjacency (): _nb_arcs(0), _order(ORDER_ID) {};
+		explicit CompressedAdjacency (GraphDb & db, NodeOrder order = ORDER_ID): _nb_arcs(0), _order(ORDER_ID) {build(db, order);};
+		
+		void build (GraphDb & db, NodeOrder order = ORDER_ID);
+		// Relabel the internal indexes in the given order
+		void reorder (NodeOrder order);
+		NodeOrder order () const {return _order;};
+		
+		// Number of internal indexes (nodes, and the missing ids of a dense id range)
+		size_t nbIndex () const {return _offsets.empty() ? 0 : _offsets.size() - 1;};
+		// Return the internal index of a node (-1 if it is not in the adjacency)
+		int internalId (int node_id) const
+		{
+			int s = _map.index(node_id);
+			return s < 0 || _internal.empty() ? s : _internal[s];
+		};
+		int externalId (int index) const
+		{
+			if (!_external.empty()) return _external[index];
+			return _map.nodeId(index);
+		};
+		
+		// Call f(int neighbor, int arc_type, bool outgoing) for every arc of a node (sorted by type, direction and neighbor index)
+		template <class F> void forEachArc (int node_id, F f) const;
+		// Same with internal indexes for the node and its neighbors
+		template <class F> void forEachInternalArc (int index, F f) const;
+		
+		// Same results as the methods of Node (neighbor ids are sorted), except that
+		// hasArcOfTypeToNode is only true for a node and itself if it has a loop
+		std::vector<int> getNodeFromArcOfType (int node_id, std::string_view type) const;
+		bool hasArcOfType (int node_id, std::string_view type) const;
+		bool hasArcOfTypeToNode (int node_id, std::string_view type, int other_id) const;
+		size_t degree (int node_id) const;
+		
+		size_t nbArc () const {return _nb_arcs;};
+		MemoryUsage memoryUsage () const;
+	};
+	
+	template <class F>
+	void CompressedAdjacency :: decodeIds (const uint8_t * it, uint32_t count, int32_t previous, bool first_zigzag, F f)
+	{
+		uint32_t i = 0;
+		if (first_zigzag && count > 0) {
+			uint32_t zigzag = readVarint(it);
+			previous = (int32_t) ((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+			f(previous);
+			i = 1;
+		}
+#ifdef TGDB_ADJACENCY_SSE2
+		// 16 values left means at least 16 bytes left: the loads stay in the list
+		uint16_t sums[16];
+		while (count - i >= 16) {
+			__m128i bytes = _mm_loadu_si128((const __m128i *) it);
+			int continued = _mm_movemask_epi8(bytes);
+			size_t group = continued == 0 ? 16 : (continued & 0xFF) == 0 ? 8 : 0;
+			if (group == 0) {
+				previous = (int32_t) ((uint32_t) previous + readVarint(it));
+				f(previous);
+				i++;
+				continue;
+			}
+			// Prefix sums of the one-byte deltas (at most 16 * 127, they fit in 16 bits)
+			__m128i zero = _mm_setzero_si128();
+			__m128i low = _mm_unpacklo_epi8(bytes, zero);
+			low = _mm_add_epi16(low, _mm_slli_si128(low, 2));
+			low = _mm_add_epi16(low, _mm_slli_si128(low, 4));
+			low = _mm_add_epi16(low, _mm_slli_si128(low, 8));
+			_mm_storeu_si128((__m128i *) sums, low);
+			if (group == 16) {
+				__m128i high = _mm_unpackhi_epi8(bytes, zero);
+				high = _mm_add_epi16(high, _mm_slli_si128(high, 2));
+				high = _mm_add_epi16(high, _mm_slli_si128(high, 4));
+				high = _mm_add_epi16(high, _mm_slli_si128(high, 8));
+				high = _mm_add_epi16(high, _mm_set1_epi16((short) sums[7]));
+				_mm_storeu_si128((__m128i *) (sums + 8), high);
+			}
+			for (size_t k = 0; k < group; k++) {
+				f((int32_t) ((uint32_t) previous + sums[k]));
+			}
+			previous = (int32_t) ((uint32_t) previous + sums[group - 1]);
+			it += group;
+			i += (uint32_t) group;
+		}
+#endif
+		for (; i < count; i++) {
+			previous = (int32_t) ((uint32_t) previous + readVarint(it));
+			f(previous);
+		}
+	}
+	
+	template <class F>
+	void CompressedAdjacency :: forEachArc (int node_id, F f) const
+	{
+		int index = internalId(node_id);
+		if (index < 0) {
+			return;
+		}
+		forEachInternalArc(index, [&](int neighbor, int type, bool outgoing) {f(externalId(neighbor), type, outgoing);});
+	}
+	
+	template <class F>
+	void CompressedAdjacency :: forEachInternalArc (int index, F f) const
+	{
+		const uint8_t * it = block(index);
+		if (it == NULL) {
+			return;
+		}
+		uint32_t nb_lists = readVarint(it);
+		for (uint32_t l = 0; l < nb_lists; l++) {
+			uint32_t key = readVarint(it);
+			uint32_t count = readVarint(it);
+			uint32_t size = readVarint(it);
+			if (count > SKIP_INTERVAL) {
+				readVarint(it);
+			}
+			int type = (int) (key >> 1);
+			bool outgoing = (key & 1) != 0;
+			decodeIds(it, count, 0, true, [&](int neighbor) {f(neighbor, type, outgoing);});
+			it += size;
+		}
+	}
+	
+} // namespace tinygraphdb
+
+#endif
@@ -0,0 +1,221 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "changefeed.h"
+
+#include <cstring>
+
+using namespace tinygraphdb;
+
+const char * tinygraphdb :: changeTypeName (ChangeType change)
+{
+	switch (change) {
+		case CHANGE_NODE_ADDED: return "node_added";
+		case CHANGE_NODE_ERASED: return "node_erased";
+		case CHANGE_PROPERTY_ADDED: return "property_added";
+		case CHANGE_PROPERTY_ERASED: return "property_erased";
+		case CHANGE_ARC_ADDED: return "arc_added";
+		case CHANGE_ARC_ERASED: return "arc_erased";
+	}
+	return "unknown";
+}
+
+
+/*******************************************************************************
+ * ChangeFeed methods
+ *******************************************************************************/
+
+// Create a feed keeping at least capacity records (rounded up to a power of 2)
+ChangeFeed :: ChangeFeed (size_t capacity, bool replay): _mask(0), _head(0), _replay(replay), _next_subscriber(0), _has_subscribers(false)
+{
+	size_t size = 1;
+	while (size < capacity) {
+		size <<= 1;
+	}
+	_slots.reset(new Slot[size]);
+	for (size_t i = 0; i < size; i++) {
+		_slots[i].seq.store(0, std::memory_order_relaxed);
+		for (size_t w = 0; w < WORDS; w++) {
+			_slots[i].words[w].store(0, std::memory_order_relaxed);
+		}
+	}
+	_mask = size - 1;
+}
+
+// Release the string values still held by the slots
+ChangeFeed :: ~ChangeFeed ()
+{
+	for (size_t i = 0; i <= _mask; i++) {
+		if (_slots[i].seq.load(std::memory_order_relaxed) != 0) {
+			releaseValue(_slots[i]);
+		}
+	}
+}
+
+// Drop the reference of a written slot on its string value
+void ChangeFeed :: releaseValue (const Slot & slot)
+{
+	uint64_t words[WORDS];
+	for (size_t w = 0; w < WORDS; w++) {
+		words[w] = slot.words[w].load(std::memory_order_relaxed);
+	}
+	ChangeRecord record;
+	memcpy(&record, words, sizeof(record));
+	if (record.property.name >= 0 && record.property.type == PROP_STRING) {
+		StringPool::instance().release(record.property.value.str);
+	}
+}
+
+// Record the current graph as additions if asked to, otherwise start with the next change
+void ChangeFeed :: build (GraphDb & db)
+{
+	if (_replay) {
+		AggregateView::build(db);
+	}
+}
+
+// Write a record in the ring buffer, then give it to the subscribers
+void ChangeFeed :: publish (ChangeType change, int node_id, int type, int to_id, const PropEntry * property)
+{
+	ChangeRecord record;
+	memset(&record, 0, sizeof(record));
+	record.seq = _head.load(std::memory_order_relaxed) + 1;
+	record.change = change;
+	record.node_id = node_id;
+	record.type = type;
+	record.to_id = to_id;
+	if (property != NULL) {
+		record.property = *property;
+		if (property->type == PROP_STRING) {
+			StringPool::instance().retain(property->value.str);
+		}
+	} else {
+		record.property.name = -1;
+	}
+	uint64_t words[WORDS] = {0};
+	memcpy(words, &record, sizeof(record));
+	
+	Slot & slot = _slots[record.seq & _mask];
+	if (record.seq > _mask + 1) {
+		releaseValue(slot);
+	}
+	slot.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for (size_t w = 0; w < WORDS; w++) {
+		slot.words[w].store(words[w], std::memory_order_relaxed);
+	}
+	slot.seq.store(record.seq, std::memory_order_release);
+	_head.store(record.seq, std::memory_order_release);
+	
+	if (_has_subscribers.load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> lock(_subscribers_mutex);
+		for (std::map<int, std::function<void (const ChangeRecord &)> >::iterator it = _subscribers.begin(); it != _subscribers.end(); it++) {
+			it->second(record);
+		}
+	}
+}
+
+void ChangeFeed :: nodeAdded (const Node & node)
+{
+	publish(CHANGE_NODE_ADDED, node.unique_id(), node.typeId(), -1, NULL);
+}
+
+void ChangeFeed :: nodeErased (const Node & node)
+{
+	publish(CHANGE_NODE_ERASED, node.unique_id(), node.typeId(), -1, NULL);
+}
+
+void ChangeFeed :: arcAdded (const Arc & arc)
+{
+	publish(CHANGE_ARC_ADDED, arc.fromNode()->unique_id(), arc.typeId(), arc.toNode()->unique_id(), NULL);
+}
+
+void ChangeFeed :: arcErased (const Arc & arc)
+{
+	publish(CHANGE_ARC_ERASED, arc.fromNode()->unique_id(), arc.typeId(), arc.toNode()->unique_id(), NULL);
+}
+
+void ChangeFeed :: propertyAdded (const Node & node, const PropEntry & entry)
+{
+	publish(CHANGE_PROPERTY_ADDED, node.unique_id(), node.typeId(), -1, &entry);
+}
+
+void ChangeFeed :: propertyErased (const Node & node, const PropEntry & entry)
+{
+	publish(CHANGE_PROPERTY_ERASED, node.unique_id(), node.typeId(), -1, &entry);
+}
+
+// Copy the records from the cursor (records overwritten before they are copied are counted as lost)
+size_t ChangeFeed :: poll (ChangeCursor & cursor, std::vector<ChangeRecord> & records, size_t max_records) const
+{
+	size_t appended = 0;
+	unsigned long long head = _head.load(std::memory_order_acquire);
+	while (appended < max_records && cursor._next <= head) {
+		unsigned long long seq = cursor._next;
+		unsigned long long oldest = head > _mask ? head - _mask : 1;
+		if (seq < oldest) {
+			cursor._lost += oldest - seq;
+			cursor._next = oldest;
+			continue;
+		}
+		const Slot & slot = _slots[seq & _mask];
+		uint64_t words[WORDS];
+		bool copied = false;
+		if (slot.seq.load(std::memory_order_acquire) == seq) {
+			for (size_t w = 0; w < WORDS; w++) {
+				words[w] = slot.words[w].load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			copied = slot.seq.load(std::memory_order_relaxed) == seq;
+		}
+		if (copied) {
+			records.push_back(ChangeRecord());
+			memcpy(&records.back(), words, sizeof(ChangeRecord));
+			appended++;
+		} else {
+			// Overwritten by a newer record since head was read
+			cursor._lost++;
+			head = _head.load(std::memory_order_acquire);
+		}
+		cursor._next++;
+	}
+	return appended;
+}
+
+// Register a callback for the next records (it must not subscribe or unsubscribe), return its id
+int ChangeFeed :: subscribe (const std::function<void (const ChangeRecord &)> & callback)
+{
+	std::lock_guard<std::mutex> lock(_subscribers_mutex);
+	int subscriber = _next_subscriber++;
+	_subscribers[subscriber] = callback;
+	_has_subscribers.store(true, std::memory_order_release);
+	return subscriber;
+}
+
+void ChangeFeed :: unsubscribe (int subscriber)
+{
+	std::lock_guard<std::mutex> lock(_subscribers_mutex);
+	_subscribers.erase(subscriber);
+	_has_subscribers.store(!_subscribers.empty(), std::memory_order_release);
+}
@@ -0,0 +1,182 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__changefeed__
+#define __tinyGraphDb__changefeed__
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "tinygraphdb.h"
+
+namespace tinygraphdb
+{
+	enum ChangeType
+	{
+		CHANGE_NODE_ADDED,
+		CHANGE_NODE_ERASED,
+		CHANGE_PROPERTY_ADDED,
+		CHANGE_PROPERTY_ERASED,
+		CHANGE_ARC_ADDED,
+		CHANGE_ARC_ERASED
+	};
+	
+	// Return the name of a change type ("node_added", ...)
+	const char * changeTypeName (ChangeType change);
+	
+	
+	/*******************************************************************************
+	 * ChangeRecord struct
+	 *
+	 * seq      : Sequence number of the change (from 1, without gaps)
+	 * change   : Type of the change
+	 * node_id  : Node, or from node of an arc
+	 * type     : Interned type of the node or of the arc
+	 * to_id    : To node of an arc (-1 for the other changes)
+	 * property : Property added or erased (name -1 for the other changes)
+	 *
+	 * Arc properties are not recorded: read them with GraphDb::getArc.
+	 *******************************************************************************/
+	struct ChangeRecord
+	{
+		unsigned long long seq;
+		ChangeType change;
+		int node_id;
+		int type;
+		int to_id;
+		PropEntry property;
+	};
+	
+	
+	/*******************************************************************************
+	 * ChangeCursor Class
+	 *
+	 * _next : Sequence number of the next record to read
+	 * _lost : Number of records overwritten before the cursor read them
+	 *******************************************************************************/
+	class ChangeCursor
+	{
+		friend class ChangeFeed;
+		
+	private:
+		unsigned long long _next;
+		unsigned long long _lost;
+		
+	public:
+		explicit ChangeCursor (unsigned long long next = 1): _next(next), _lost(0) {};
+		
+		unsigned long long next () const {return _next;};
+		unsigned long long lost () const {return _lost;};
+		bool overflowed () const {return _lost > 0;};
+	};
+	
+	
+	/*******************************************************************************
+	 * ChangeFeed Class
+	 *
+	 * _slots       : Ring buffer of the last capacity() records
+	 * _mask        : capacity() - 1 (the capacity is a power of 2)
+	 * _head        : Sequence number of the last published record
+	 * _replay      : true to record the current graph as additions when registered
+	 * _subscribers : Callbacks called for every record
+	 *
+	 * Change-data-capture view: registered with GraphDb::addView, it records
+	 * every change of the graph with a sequence number. Consumers either
+	 * subscribe a callback, called synchronously by the thread changing the
+	 * graph (a slow callback slows the writer down), or poll the ring buffer
+	 * with a cursor from any thread without locking.
+	 *
+	 * The ring buffer never blocks the writer: a consumer more than capacity()
+	 * records behind loses the oldest ones. poll() then moves its cursor to the
+	 * oldest record still available and counts the lost records (the consumer
+	 * has to read the graph again, or use a larger capacity).
+	 *
+	 * Changes of a GraphDb are made by one thread at a time, so the feed has a
+	 * single producer. A slot is written like a seqlock: its sequence number is
+	 * reset, the record written, then the sequence number published; a reader
+	 * copies the record and checks that the sequence number did not change.
+	 *
+	 * A slot holds a reference on the string value of its property (see
+	 * StringPool) until it is overwritten: read the text of a polled value before
+	 * capacity() more changes are recorded.
+	 *******************************************************************************/
+	class ChangeFeed : public AggregateView
+	{
+	private:
+		static const size_t WORDS = (sizeof(ChangeRecord) + 7) / 8;
+		
+		struct Slot
+		{
+			std::atomic<unsigned long long> seq;
+			std::atomic<uint64_t> words[WORDS];
+		};
+		
+		std::unique_ptr<Slot[]> _slots;
+		size_t _mask;
+		std::atomic<unsigned long long> _head;
+		bool _replay;
+		
+		std::mutex _subscribers_mutex;
+		std::map<int, std::function<void (const ChangeRecord &)> > _subscribers;
+		int _next_subscriber;
+		std::atomic<bool> _has_subscribers;
+		
+		void publish (ChangeType change, int node_id, int type, int to_id, const PropEntry * property);
+		void releaseValue (const Slot & slot);
+		
+	public:
+		explicit ChangeFeed (size_t capacity = 65536, bool replay = false);
+		~ChangeFeed ();
+		
+		// AggregateView //
+		void clear () {};
+		void build (GraphDb & db);
+		void nodeAdded (const Node & node);
+		void nodeErased (const Node & node);
+		void arcAdded (const Arc & arc);
+		void arcErased (const Arc & arc);
+		void propertyAdded (const Node & node, const PropEntry & entry);
+		void propertyErased (const Node & node, const PropEntry & entry);
+		
+		// Polling //
+		size_t capacity () const {return _mask + 1;};
+		unsigned long long lastSeq () const {return _head.load(std::memory_order_acquire);};
+		// Return a cursor on the changes to come
+		ChangeCursor cursor () const {return ChangeCursor(lastSeq() + 1);};
+		// Append at most max_records records from the cursor, return the number of records appended
+		size_t poll (ChangeCursor & cursor, std::vector<ChangeRecord> & records, size_t max_records = 4096) const;
+		
+		// Subscribers //
+		int subscribe (const std::function<void (const ChangeRecord &)> & callback);
+		void unsubscribe (int subscriber);
+	};
+	
+} // namespace tinygraphdb
+
+#endif
@@ -0,0 +1,190 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "executor.h"
+
+using namespace tinygraphdb;
+
+// Index of the worker running on the current thread (-1 outside of the pool)
+static thread_local QueryExecutor * current_executor = NULL;
+static thread_local size_t current_worker = 0;
+
+QueryExecutor :: QueryExecutor (GraphDb & db, int nb_threads): _db(db), _pending(0), _next_queue(0), _stopping(false)
+{
+	if (nb_threads <= 0) {
+		nb_threads = (int) std::thread::hardware_concurrency();
+		if (nb_threads <= 0) {
+			nb_threads = 4;
+		}
+	}
+	for (int i = 0; i < nb_threads; i++) {
+		_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+	}
+	for (int i = 0; i < nb_threads; i++) {
+		_workers.push_back(std::thread(&QueryExecutor::work, this, (size_t) i));
+	}
+}
+
+// Stop the workers once every queued task has run
+QueryExecutor :: ~QueryExecutor ()
+{
+	{
+		std::lock_guard<std::mutex> lock(_sleep_mutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	for (size_t i = 0; i < _workers.size(); i++) {
+		_workers[i].join();
+	}
+}
+
+void QueryExecutor :: push (std::function<void ()> && task)
+{
+	size_t queue;
+	if (current_executor == this) {
+		queue = current_worker;
+	} else {
+		queue = _next_queue.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+	}
+	{
+		std::lock_guard<std::mutex> lock(_queues[queue]->mutex);
+		_queues[queue]->tasks.push_back(std::move(task));
+	}
+	{
+		// Taken so that a worker cannot miss the notification between its check and its wait
+		std::lock_guard<std::mutex> lock(_sleep_mutex);
+		_pending++;
+	}
+	_wake.notify_one();
+}
+
+// Take a task: the newest of the own queue, else the oldest of another one
+bool QueryExecutor :: pop (size_t worker, std::function<void ()> & task)
+{
+	{
+		WorkQueue & own = *_queues[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+	for (size_t i = 1; i < _queues.size(); i++) {
+		WorkQueue & other = *_queues[(worker + i) % _queues.size()];
+		std::lock_guard<std::mutex> lock(other.mutex);
+		if (!other.tasks.empty()) {
+			task = std::move(other.tasks.front());
+			other.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void QueryExecutor :: work (size_t worker)
+{
+	current_executor = this;
+	current_worker = worker;
+	std::function<void ()> task;
+	while (true) {
+		if (pop(worker, task)) {
+			_pending--;
+			task();
+			task = nullptr;
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(_sleep_mutex);
+		while (_pending.load() == 0 && !_stopping) {
+			_wake.wait(lock);
+		}
+		if (_pending.load() == 0 && _stopping) {
+			return;
+		}
+	}
+}
+
+QueryHandle<std::set<Node *> > QueryExecutor :: getNodesOfType (const std::string & type)
+{
+	return submit([type](GraphDb & db, QueryContext &) {return db.getNodesOfType(type);});
+}
+
+QueryHandle<std::set<Node *> > QueryExecutor :: getNodesWithProperty (const std::string & prop_name, const std::string & prop_value)
+{
+	return submit([prop_name, prop_value](GraphDb & db, QueryContext &) {return db.getNodesWithProperty(prop_name, prop_value);});
+}
+
+QueryHandle<std::set<Node *> > QueryExecutor :: getNodesOfTypeWithProperty (const std::string & type, const std::string & prop_name, const std::string & prop_value)
+{
+	return submit([type, prop_name, prop_value](GraphDb & db, QueryContext &) {return db.getNodesOfTypeWithProperty(type, prop_name, prop_value);});
+}
+
+QueryHandle<std::set<Node *> > QueryExecutor :: expand (int node_id, int hops, const std::string & arc_type, std::chrono::milliseconds timeout)
+{
+	return submit([node_id, hops, arc_type](GraphDb & db, QueryContext & context) {return expandNeighborhood(db, node_id, hops, arc_type, context);}, timeout);
+}
+
+QueryHandle<Subgraph> QueryExecutor :: expand (int node_id, const ExpansionQuery & query, std::chrono::milliseconds timeout)
+{
+	return submit([node_id, query](GraphDb & db, QueryContext & context) {
+		static thread_local NeighborhoodExpander expander;
+		Subgraph result;
+		expander.expand(db, node_id, query, result, &context);
+		return result;
+	}, timeout);
+}
+
+QueryHandle<ReloadSummary> QueryExecutor :: reload (const std::string & fname)
+{
+	std::shared_ptr<QueryContext> context = std::make_shared<QueryContext>();
+	std::shared_ptr<std::promise<ReloadSummary> > promise = std::make_shared<std::promise<ReloadSummary> >();
+	QueryHandle<ReloadSummary> handle(promise->get_future(), context);
+	push([this, fname, context, promise]() {
+		try {
+			GraphDiff diff;
+			{
+				std::shared_lock<std::shared_mutex> lock(_lock);
+				diff = _db.diff(fname);
+			}
+			context->check();
+			// Changes submitted between the two locks may be overwritten by the file
+			std::unique_lock<std::shared_mutex> lock(_lock);
+			promise->set_value(_db.apply(diff));
+		} catch (...) {
+			promise->set_exception(std::current_exception());
+		}
+	});
+	return handle;
+}
+
+std::set<Node *> tinygraphdb :: expandNeighborhood (GraphDb & db, int node_id, int hops, const std::string & arc_type, const QueryContext & context)
+{
+	static thread_local NeighborhoodExpander expander;
+	static thread_local Subgraph result;
+	ExpansionQuery query;
+	query.hops.assign(hops > 0 ? hops : 0, arc_type.empty() ? HopFilter() : HopFilter(std::vector<std::string>(1, arc_type)));
+	query.arcs = ARCS_NONE;
+	expander.expand(db, node_id, query, result, &context);
+	return std::set<Node *>(result.nodes.begin(), result.nodes.end());
+}
@@ -0,0 +1,235 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__executor__
+#define __tinyGraphDb__executor__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "tinygraphdb.h"
+#include "expand.h"
+
+namespace tinygraphdb
+{
+	// Thrown by a query that was cancelled or that passed its deadline
+	class QueryCancelled : public std::runtime_error
+	{
+	public:
+		explicit QueryCancelled (const std::string & what): std::runtime_error(what) {};
+	};
+	
+	
+	/*******************************************************************************
+	 * QueryContext Class
+	 *
+	 * _cancelled : Set by cancel()
+	 * _deadline  : Time after which the query stops (time_point::max() if none)
+	 *
+	 * Shared by a query and its handle. Long queries call check() regularly
+	 * (traversals check it for every expanded node).
+	 *******************************************************************************/
+	class QueryContext
+	{
+	private:
+		std::atomic<bool> _cancelled;
+		std::chrono::steady_clock::time_point _deadline;
+		
+	public:
+		explicit QueryContext (std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()): _cancelled(false), _deadline(deadline) {};
+		
+		void cancel () {_cancelled.store(true, std::memory_order_relaxed);};
+		bool cancelled () const {return _cancelled.load(std::memory_order_relaxed);};
+		bool expired () const {return _deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() > _deadline;};
+		
+		// Throw QueryCancelled if the query has to stop
+		void check () const
+		{
+			if (cancelled()) throw QueryCancelled("Query cancelled");
+			if (expired()) throw QueryCancelled("Query deadline exceeded");
+		};
+	};
+	
+	
+	/*******************************************************************************
+	 * QueryHandle Class
+	 *
+	 * Result of a submitted query: a future and the context to cancel it
+	 *******************************************************************************/
+	template <class R>
+	class QueryHandle
+	{
+	private:
+		std::future<R> _future;
+		std::shared_ptr<QueryContext> _context;
+		
+	public:
+		QueryHandle () {};
+		QueryHandle (std::future<R> && future, const std::shared_ptr<QueryContext> & context): _future(std::move(future)), _context(context) {};
+		
+		// Return the result (rethrow the exception of the query, QueryCancelled if it was stopped)
+		R get () {return _future.get();};
+		void wait () const {_future.wait();};
+		template <class Rep, class Period> bool waitFor (const std::chrono::duration<Rep, Period> & timeout) const {return _future.wait_for(timeout) == std::future_status::ready;};
+		bool ready () const {return waitFor(std::chrono::seconds(0));};
+		bool valid () const {return _future.valid();};
+		void cancel () {if (_context) _context->cancel();};
+	};
+	
+	
+	/*******************************************************************************
+	 * QueryExecutor Class
+	 *
+	 * _db      : Queried graph
+	 * _lock    : Queries share the graph, changes (submitWrite) are exclusive
+	 * _queues  : One task deque per worker
+	 * _pending : Number of queued tasks (workers sleep when it is 0)
+	 *
+	 * Runs queries on a pool of threads and returns QueryHandles. Every worker
+	 * takes its tasks from the back of its own deque and, when it is empty,
+	 * steals from the front of the others (work stealing). Tasks submitted from
+	 * a worker go to its own deque, the others are spread over the workers.
+	 * Queries must not change the graph: use submitWrite for that.
+	 *******************************************************************************/
+	class QueryExecutor
+	{
+	private:
+		struct WorkQueue
+		{
+			std::mutex mutex;
+			std::deque<std::function<void ()> > tasks;
+		};
+		
+		GraphDb & _db;
+		std::shared_mutex _lock;
+		std::vector<std::unique_ptr<WorkQueue> > _queues;
+		std::vector<std::thread> _workers;
+		std::mutex _sleep_mutex;
+		std::condition_variable _wake;
+		std::atomic<long> _pending;
+		std::atomic<unsigned> _next_queue;
+		bool _stopping;
+		
+		void push (std::function<void ()> && task);
+		bool pop (size_t worker, std::function<void ()> & task);
+		void work (size_t worker);
+		
+		template <class R, class F> QueryHandle<R> schedule (F && f, std::chrono::steady_clock::time_point deadline, bool write);
+		
+	public:
+		explicit QueryExecutor (GraphDb & db, int nb_threads = 0);
+		~QueryExecutor ();
+		QueryExecutor (const QueryExecutor &) = delete;
+		QueryExecutor & operator= (const QueryExecutor &) = delete;
+		
+		// Run f(GraphDb &, QueryContext &) on the pool (timeout 0: no deadline)
+		template <class F> auto submit (F f, std::chrono::milliseconds timeout = std::chrono::milliseconds(0))
+			-> QueryHandle<decltype(f(std::declval<GraphDb &>(), std::declval<QueryContext &>()))>;
+		template <class F> auto submitWrite (F f)
+			-> QueryHandle<decltype(f(std::declval<GraphDb &>(), std::declval<QueryContext &>()))>;
+		
+		// Asynchronous versions of the GraphDb queries //
+		QueryHandle<std::set<Node *> > getNodesOfType (const std::string & type);
+		QueryHandle<std::set<Node *> > getNodesWithProperty (const std::string & prop_name, const std::string & prop_value);
+		QueryHandle<std::set<Node *> > getNodesOfTypeWithProperty (const std::string & type, const std::string & prop_name, const std::string & prop_value);
+		
+		// Nodes at most hops arcs away from a node (arcs of any type if arc_type is empty)
+		QueryHandle<std::set<Node *> > expand (int node_id, int hops, const std::string & arc_type = "", std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+		// Subgraph of an ExpansionQuery (per hop filters and limits, see NeighborhoodExpander)
+		QueryHandle<Subgraph> expand (int node_id, const ExpansionQuery & query, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+		// Reload a .tgdb file: diff it with a shared lock (queries go on), then apply the changes with an exclusive lock
+		QueryHandle<ReloadSummary> reload (const std::string & fname);
+		
+		size_t nbThreads () const {return _workers.size();};
+	};
+	
+	// Breadth first expansion checked against a context, with a NeighborhoodExpander per thread (used by QueryExecutor::expand)
+	std::set<Node *> expandNeighborhood (GraphDb & db, int node_id, int hops, const std::string & arc_type, const QueryContext & context);
+	
+	template <class R, class F>
+	QueryHandle<R> QueryExecutor :: schedule (F && f, std::chrono::steady_clock::time_point deadline, bool write)
+	{
+		std::shared_ptr<QueryContext> context = std::make_shared<QueryContext>(deadline);
+		std::shared_ptr<std::promise<R> > promise = std::make_shared<std::promise<R> >();
+		QueryHandle<R> handle(promise->get_future(), context);
+		push([this, f, context, promise, write]() mutable {
+			try {
+				context->check();
+				if (write) {
+					std::unique_lock<std::shared_mutex> lock(_lock);
+					if constexpr (std::is_void<R>::value) {
+						f(_db, *context);
+						promise->set_value();
+					} else {
+						promise->set_value(f(_db, *context));
+					}
+				} else {
+					std::shared_lock<std::shared_mutex> lock(_lock);
+					if constexpr (std::is_void<R>::value) {
+						f(_db, *context);
+						promise->set_value();
+					} else {
+						promise->set_value(f(_db, *context));
+					}
+				}
+			} catch (...) {
+				promise->set_exception(std::current_exception());
+			}
+		});
+		return handle;
+	}
+	
+	template <class F>
+	auto QueryExecutor :: submit (F f, std::chrono::milliseconds timeout)
+		-> QueryHandle<decltype(f(std::declval<GraphDb &>(), std::declval<QueryContext &>()))>
+	{
+		typedef decltype(f(std::declval<GraphDb &>(), std::declval<QueryContext &>())) R;
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+		if (timeout.count() > 0) {
+			deadline = std::chrono::steady_clock::now() + timeout;
+		}
+		return schedule<R>(std::move(f), deadline, false);
+	}
+	
+	template <class F>
+	auto QueryExecutor :: submitWrite (F f)
+		-> QueryHandle<decltype(f(std::declval<GraphDb &>(), std::declval<QueryContext &>()))>
+	{
+		typedef decltype(f(std::declval<GraphDb &>(), std::declval<QueryContext &>())) R;
+		return schedule<R>(std::move(f), std::chrono::steady_clock::time_point::max(), true);
+	}
+	
+} // namespace tinygraphdb
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "expand.h"
+#include "executor.h"
+
+#include <algorithm>
+
+using namespace tinygraphdb;
+
+NeighborhoodExpander::Mark & NeighborhoodExpander :: mark (int node_id)
+{
+	if (node_id >= 0 && (size_t) node_id < _dense_limit) {
+		if ((size_t) node_id >= _marks.size()) {
+			Mark empty = {0, 0};
+			_marks.resize(std::min(std::max((size_t) node_id + 1, _marks.size() * 2), _dense_limit), empty);
+		}
+		return _marks[node_id];
+	}
+	Mark & sparse = _sparse_marks[node_id];
+	return sparse;
+}
+
+size_t NeighborhoodExpander :: expand (GraphDb & db, int node_id, const ExpansionQuery & query, Subgraph & result, const QueryContext * context)
+{
+	result.clear();
+	Node * start = db.getNode(node_id);
+	if (start == NULL) {
+		return 0;
+	}
+	
+	// New epoch: the marks of the previous expansions become stale (reset once every 2^32 expansions)
+	if (++_epoch == 0) {
+		Mark empty = {0, 0};
+		std::fill(_marks.begin(), _marks.end(), empty);
+		_epoch = 1;
+	}
+	_sparse_marks.clear();
+	// Same dense range as the slots of the GraphDb: one large id does not size the vector
+	_dense_limit = std::max(2 * ((size_t) db.nbNode() + 1) + 1024, _marks.size());
+	
+	// Type names to interned ids (-1: never matches)
+	StringPool & pool = StringPool::instance();
+	_hop_types.resize(query.hops.size());
+	for (size_t hop = 0; hop < query.hops.size(); hop++) {
+		_hop_types[hop].clear();
+		for (size_t t = 0; t < query.hops[hop].arc_types.size(); t++) {
+			_hop_types[hop].push_back(pool.lookup(query.hops[hop].arc_types[t]));
+		}
+	}
+	_node_types.clear();
+	for (size_t t = 0; t < query.node_types.size(); t++) {
+		_node_types.push_back(pool.lookup(query.node_types[t]));
+	}
+	
+	Mark & start_mark = mark(node_id);
+	start_mark.epoch = _epoch;
+	start_mark.index = 0;
+	result.nodes.push_back(start);
+	result.depths.push_back(0);
+	
+	// Breadth first: the nodes of the current hop are result.nodes[begin, end)
+	size_t begin = 0;
+	for (size_t hop = 0; hop < query.hops.size() && begin < result.nodes.size(); hop++) {
+		const HopFilter & filter = query.hops[hop];
+		const std::vector<int> & arc_types = _hop_types[hop];
+		size_t end = result.nodes.size();
+		for (size_t n = begin; n < end; n++) {
+			if (context != NULL) {
+				context->check();
+			}
+			Node * node = result.nodes[n];
+			size_t fanout = 0;
+			for (std::set<Arc *>::const_iterator it = node->arcs().begin(); it != node->arcs().end(); it++) {
+				Arc * arc = *it;
+				bool outgoing = arc->fromNode() == node;
+				if (!(filter.direction & (outgoing ? DIRECTION_OUT : DIRECTION_IN))) {
+					continue;
+				}
+				if (!arc_types.empty() && std::find(arc_types.begin(), arc_types.end(), arc->typeId()) == arc_types.end()) {
+					continue;
+				}
+				Node * other = outgoing ? arc->toNode() : arc->fromNode();
+				Mark & other_mark = mark(other->unique_id());
+				if (other_mark.epoch == _epoch) {
+					continue;
+				}
+				if (!_node_types.empty() && std::find(_node_types.begin(), _node_types.end(), other->typeId()) == _node_types.end()) {
+					continue;
+				}
+				if (filter.max_fanout > 0 && fanout == filter.max_fanout) {
+					result.truncated = true;
+					break;
+				}
+				if (query.max_nodes > 0 && result.nodes.size() == query.max_nodes) {
+					result.truncated = true;
+					break;
+				}
+				other_mark.epoch = _epoch;
+				other_mark.index = (uint32_t) result.nodes.size();
+				result.nodes.push_back(other);
+				result.depths.push_back((uint8_t) (hop + 1));
+				fanout++;
+				if (query.arcs == ARCS_TRAVERSED) {
+					SubgraphArc subgraph_arc = {outgoing ? (uint32_t) n : other_mark.index, outgoing ? other_mark.index : (uint32_t) n, arc};
+					result.arcs.push_back(subgraph_arc);
+				}
+			}
+		}
+		begin = end;
+	}
+	
+	if (query.arcs == ARCS_INDUCED) {
+		// Every arc is seen from both ends: keep it from its from node
+		for (size_t n = 0; n < result.nodes.size(); n++) {
+			Node * node = result.nodes[n];
+			for (std::set<Arc *>::const_iterator it = node->arcs().begin(); it != node->arcs().end(); it++) {
+				if ((*it)->fromNode() != node) {
+					continue;
+				}
+				Mark & to_mark = mark((*it)->toNode()->unique_id());
+				if (to_mark.epoch == _epoch) {
+					SubgraphArc subgraph_arc = {(uint32_t) n, to_mark.index, *it};
+					result.arcs.push_back(subgraph_arc);
+				}
+			}
+		}
+	}
+	return result.nodes.size();
+}
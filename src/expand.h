@@ -0,0 +1,161 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__expand__
+#define __tinyGraphDb__expand__
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tinygraphdb.h"
+
+namespace tinygraphdb
+{
+	class QueryContext;
+	
+	enum ArcDirection
+	{
+		DIRECTION_OUT  = 1, // from the expanded node
+		DIRECTION_IN   = 2, // to the expanded node
+		DIRECTION_BOTH = 3
+	};
+	
+	/*******************************************************************************
+	 * HopFilter struct
+	 *
+	 * arc_types  : Arc types followed at this hop (any type if empty)
+	 * direction  : Direction of the followed arcs
+	 * max_fanout : Arcs followed from each node at this hop (no limit if 0)
+	 *******************************************************************************/
+	struct HopFilter
+	{
+		std::vector<std::string> arc_types;
+		ArcDirection direction;
+		size_t max_fanout;
+		
+		HopFilter (ArcDirection direction = DIRECTION_BOTH, size_t max_fanout = 0): direction(direction), max_fanout(max_fanout) {};
+		HopFilter (const std::vector<std::string> & arc_types, ArcDirection direction = DIRECTION_BOTH, size_t max_fanout = 0): arc_types(arc_types), direction(direction), max_fanout(max_fanout) {};
+	};
+	
+	
+	/*******************************************************************************
+	 * ExpansionQuery struct
+	 *
+	 * hops       : One filter per hop (the number of hops is hops.size())
+	 * node_types : Types of the reached nodes kept and expanded (any type if empty)
+	 * max_nodes  : Size limit of the result, start node included (no limit if 0)
+	 * arcs       : ARCS_NONE, ARCS_TRAVERSED (arcs that reached a node) or
+	 *              ARCS_INDUCED (every arc between two nodes of the result)
+	 *******************************************************************************/
+	enum SubgraphArcs
+	{
+		ARCS_NONE      = 0,
+		ARCS_TRAVERSED = 1,
+		ARCS_INDUCED   = 2
+	};
+	
+	struct ExpansionQuery
+	{
+		std::vector<HopFilter> hops;
+		std::vector<std::string> node_types;
+		size_t max_nodes;
+		SubgraphArcs arcs;
+		
+		ExpansionQuery (): max_nodes(0), arcs(ARCS_INDUCED) {};
+	};
+	
+	
+	/*******************************************************************************
+	 * Subgraph struct
+	 *
+	 * nodes     : Reached nodes in breadth first order (the start node first)
+	 * depths    : Hop at which each node was reached
+	 * arcs      : Arcs of the result, as indexes in nodes
+	 * truncated : true if a limit (max_nodes or a fan-out) stopped the expansion
+	 *******************************************************************************/
+	struct SubgraphArc
+	{
+		uint32_t from;
+		uint32_t to;
+		Arc * arc;
+	};
+	
+	struct Subgraph
+	{
+		std::vector<Node *> nodes;
+		std::vector<uint8_t> depths;
+		std::vector<SubgraphArc> arcs;
+		bool truncated;
+		
+		Subgraph (): truncated(false) {};
+		void clear () {nodes.clear(); depths.clear(); arcs.clear(); truncated = false;};
+	};
+	
+	
+	/*******************************************************************************
+	 * NeighborhoodExpander Class
+	 *
+	 * _epoch        : Number of the current expansion
+	 * _marks        : Epoch of the last expansion that reached a node, and its
+	 *                 index in the result (indexed by node id)
+	 * _dense_limit  : Ids below it are marked in _marks (twice the number of
+	 *                 nodes, as the dense slots of GraphDb)
+	 * _sparse_marks : Same for the other ids
+	 *
+	 * k-hop expansion with per hop filters. A node is visited if its mark has
+	 * the current epoch, so nothing is cleared between two expansions. An
+	 * expander and its results are reused from call to call to avoid
+	 * allocations; use one expander per thread.
+	 *******************************************************************************/
+	class NeighborhoodExpander
+	{
+	private:
+		struct Mark
+		{
+			uint32_t epoch;
+			uint32_t index;
+		};
+		
+		uint32_t _epoch;
+		std::vector<Mark> _marks;
+		size_t _dense_limit;
+		std::unordered_map<int, Mark> _sparse_marks;
+		std::vector<std::vector<int> > _hop_types;
+		std::vector<int> _node_types;
+		
+		Mark & mark (int node_id);
+		
+	public:
+		NeighborhoodExpander (): _epoch(0), _dense_limit(0) {};
+		
+		// Expand from a node into result (cleared first), return the number of nodes
+		// (context, if any, is checked for every expanded node: QueryCancelled)
+		size_t expand (GraphDb & db, int node_id, const ExpansionQuery & query, Subgraph & result, const QueryContext * context = NULL);
+	};
+	
+} // namespace tinygraphdb
+
+#endif
@@ -0,0 +1,315 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "intersect.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define TGDB_X86_SIMD
+#endif
+
+using namespace tinygraphdb;
+
+// Size ratio from which galloping beats a merge
+static const size_t GALLOPING_RATIO = 32;
+
+/*******************************************************************************
+ * Kernels
+ *******************************************************************************/
+
+size_t tinygraphdb :: intersectScalar (const int * a, size_t size_a, const int * b, size_t size_b, int * out)
+{
+	size_t i = 0, j = 0, count = 0;
+	while (i < size_a && j < size_b) {
+		if (a[i] < b[j]) {
+			i++;
+		} else if (b[j] < a[i]) {
+			j++;
+		} else {
+			if (out != NULL) out[count] = a[i];
+			count++;
+			i++;
+			j++;
+		}
+	}
+	return count;
+}
+
+size_t tinygraphdb :: intersectGalloping (const int * small, size_t size_small, const int * large, size_t size_large, int * out)
+{
+	size_t count = 0, position = 0;
+	for (size_t i = 0; i < size_small && position < size_large; i++) {
+		int value = small[i];
+		// Exponential search of the first id >= value, then binary search in the last step
+		size_t bound = 1;
+		while (position + bound < size_large && large[position + bound] < value) {
+			bound *= 2;
+		}
+		const int * first = large + position + bound / 2;
+		const int * last = large + std::min(position + bound + 1, size_large);
+		position = std::lower_bound(first, last, value) - large;
+		if (position < size_large && large[position] == value) {
+			if (out != NULL) out[count] = value;
+			count++;
+			position++;
+		}
+	}
+	return count;
+}
+
+#ifdef TGDB_X86_SIMD
+
+// Compare blocks of 4 ids of both arrays: all the pairs with the rotations of the block of b
+static size_t intersectSse2 (const int * a, size_t size_a, const int * b, size_t size_b, int * out)
+{
+	size_t i = 0, j = 0, count = 0;
+	size_t blocks_a = size_a & ~(size_t) 3, blocks_b = size_b & ~(size_t) 3;
+	while (i < blocks_a && j < blocks_b) {
+		__m128i va = _mm_loadu_si128((const __m128i *) (a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i *) (b + j));
+		__m128i equal = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+			_mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(equal));
+		while (mask != 0) {
+			if (out != NULL) out[count] = a[i + __builtin_ctz(mask)];
+			count++;
+			mask &= mask - 1;
+		}
+		// The block with the smallest last id cannot match the next blocks of the other array
+		int last_a = a[i + 3], last_b = b[j + 3];
+		if (last_a <= last_b) i += 4;
+		if (last_b <= last_a) j += 4;
+	}
+	return count + intersectScalar(a + i, size_a - i, b + j, size_b - j, out == NULL ? NULL : out + count);
+}
+
+// Same with blocks of 8 ids
+__attribute__((target("avx2")))
+static size_t intersectAvx2 (const int * a, size_t size_a, const int * b, size_t size_b, int * out)
+{
+	size_t i = 0, j = 0, count = 0;
+	size_t blocks_a = size_a & ~(size_t) 7, blocks_b = size_b & ~(size_t) 7;
+	const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+	while (i < blocks_a && j < blocks_b) {
+		__m256i va = _mm256_loadu_si256((const __m256i *) (a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i *) (b + j));
+		__m256i equal = _mm256_cmpeq_epi32(va, vb);
+		for (int r = 1; r < 8; r++) {
+			vb = _mm256_permutevar8x32_epi32(vb, rotate);
+			equal = _mm256_or_si256(equal, _mm256_cmpeq_epi32(va, vb));
+		}
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+		while (mask != 0) {
+			if (out != NULL) out[count] = a[i + __builtin_ctz(mask)];
+			count++;
+			mask &= mask - 1;
+		}
+		int last_a = a[i + 7], last_b = b[j + 7];
+		if (last_a <= last_b) i += 8;
+		if (last_b <= last_a) j += 8;
+	}
+	return count + intersectSse2(a + i, size_a - i, b + j, size_b - j, out == NULL ? NULL : out + count);
+}
+
+static bool hasAvx2 ()
+{
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+}
+
+#endif
+
+size_t tinygraphdb :: intersectSimd (const int * a, size_t size_a, const int * b, size_t size_b, int * out)
+{
+#ifdef TGDB_X86_SIMD
+	if (hasAvx2()) {
+		return intersectAvx2(a, size_a, b, size_b, out);
+	}
+	return intersectSse2(a, size_a, b, size_b, out);
+#else
+	return intersectScalar(a, size_a, b, size_b, out);
+#endif
+}
+
+const char * tinygraphdb :: simdKernelName ()
+{
+#ifdef TGDB_X86_SIMD
+	return hasAvx2() ? "avx2" : "sse2";
+#else
+	return "scalar";
+#endif
+}
+
+size_t tinygraphdb :: intersectSorted (const int * a, size_t size_a, const int * b, size_t size_b, int * out)
+{
+	if (size_a > size_b) {
+		std::swap(a, b);
+		std::swap(size_a, size_b);
+	}
+	if (size_a == 0) {
+		return 0;
+	}
+	if (size_b / size_a >= GALLOPING_RATIO) {
+		return intersectGalloping(a, size_a, b, size_b, out);
+	}
+	return intersectSimd(a, size_a, b, size_b, out);
+}
+
+
+/*******************************************************************************
+ * NeighborIndex methods
+ *******************************************************************************/
+
+void NeighborIndex :: build (GraphDb & db, std::string_view arc_type)
+{
+	std::vector<Node *> nodes = _map.build(db);
+	int type_id = arc_type.empty() ? -1 : StringPool::instance().lookup(arc_type);
+	
+	_neighbors.clear();
+	_map.buildRows(nodes, _offsets, [&](Node * node) {
+		size_t begin = _neighbors.size();
+		if (!arc_type.empty() && type_id < 0) {
+			return (uint64_t) begin;
+		}
+		for (std::set<Arc *>::const_iterator it = node->arcs().begin(); it != node->arcs().end(); it++) {
+			Node * other = (*it)->fromNode() == node ? (*it)->toNode() : (*it)->fromNode();
+			if ((type_id < 0 || (*it)->typeId() == type_id) && other != node) {
+				_neighbors.push_back(other->unique_id());
+			}
+		}
+		std::sort(_neighbors.begin() + begin, _neighbors.end());
+		_neighbors.erase(std::unique(_neighbors.begin() + begin, _neighbors.end()), _neighbors.end());
+		return (uint64_t) _neighbors.size();
+	});
+	_offsets.shrink_to_fit();
+	_neighbors.shrink_to_fit();
+}
+
+bool NeighborIndex :: range (int node_id, size_t & begin, size_t & end) const
+{
+	int index = _map.index(node_id);
+	if (index < 0) {
+		return false;
+	}
+	begin = _offsets[index];
+	end = _offsets[index + 1];
+	return begin < end;
+}
+
+const int * NeighborIndex :: neighbors (int node_id, size_t & count) const
+{
+	size_t begin, end;
+	if (!range(node_id, begin, end)) {
+		count = 0;
+		return NULL;
+	}
+	count = end - begin;
+	return _neighbors.data() + begin;
+}
+
+size_t NeighborIndex :: degree (int node_id) const
+{
+	size_t count;
+	neighbors(node_id, count);
+	return count;
+}
+
+std::vector<int> NeighborIndex :: commonNeighbors (int node_a, int node_b) const
+{
+	size_t size_a, size_b;
+	const int * a = neighbors(node_a, size_a);
+	const int * b = neighbors(node_b, size_b);
+	std::vector<int> common(std::min(size_a, size_b));
+	common.resize(intersectSorted(a, size_a, b, size_b, common.data()));
+	return common;
+}
+
+size_t NeighborIndex :: commonNeighborCount (int node_a, int node_b) const
+{
+	size_t size_a, size_b;
+	const int * a = neighbors(node_a, size_a);
+	const int * b = neighbors(node_b, size_b);
+	return intersectSorted(a, size_a, b, size_b, NULL);
+}
+
+double NeighborIndex :: jaccard (int node_a, int node_b) const
+{
+	size_t size_a, size_b;
+	const int * a = neighbors(node_a, size_a);
+	const int * b = neighbors(node_b, size_b);
+	size_t common = intersectSorted(a, size_a, b, size_b, NULL);
+	size_t all = size_a + size_b - common;
+	return all == 0 ? 0.0 : (double) common / all;
+}
+
+double NeighborIndex :: overlap (int node_a, int node_b) const
+{
+	size_t size_a, size_b;
+	const int * a = neighbors(node_a, size_a);
+	const int * b = neighbors(node_b, size_b);
+	size_t smallest = std::min(size_a, size_b);
+	return smallest == 0 ? 0.0 : (double) intersectSorted(a, size_a, b, size_b, NULL) / smallest;
+}
+
+// Count every triangle once: for each arc u < v, the common neighbors w > v
+size_t NeighborIndex :: triangleCount () const
+{
+	size_t count = 0;
+	size_t nb_nodes = _offsets.empty() ? 0 : _offsets.size() - 1;
+	for (size_t index = 0; index < nb_nodes; index++) {
+		int u = _map.nodeId(index);
+		const int * begin_u = _neighbors.data() + _offsets[index];
+		const int * end_u = _neighbors.data() + _offsets[index + 1];
+		for (const int * v = std::upper_bound(begin_u, end_u, u); v < end_u; v++) {
+			size_t count_v;
+			const int * neighbors_v = neighbors(*v, count_v);
+			const int * above_v = std::upper_bound(neighbors_v, neighbors_v + count_v, *v);
+			count += intersectSorted(v + 1, end_u - (v + 1), above_v, neighbors_v + count_v - above_v, NULL);
+		}
+	}
+	return count;
+}
+
+// Number of triangles a node belongs to: arcs between its neighbors
+size_t NeighborIndex :: triangleCount (int node_id) const
+{
+	size_t size_u;
+	const int * neighbors_u = neighbors(node_id, size_u);
+	size_t count = 0;
+	for (size_t i = 0; i < size_u; i++) {
+		size_t size_v;
+		const int * neighbors_v = neighbors(neighbors_u[i], size_v);
+		// Only the neighbors after v, so that each pair is counted once
+		const int * above_v = std::upper_bound(neighbors_v, neighbors_v + size_v, neighbors_u[i]);
+		count += intersectSorted(neighbors_u + i + 1, size_u - i - 1, above_v, neighbors_v + size_v - above_v, NULL);
+	}
+	return count;
+}
+
+MemoryUsage NeighborIndex :: memoryUsage () const
+{
+	size_t bytes = _offsets.capacity() * sizeof(uint64_t) + _neighbors.capacity() * sizeof(int) + _map.memoryUsage();
+	return MemoryUsage("neighbor_index", _neighbors.size(), bytes);
+}
@@ -0,0 +1,133 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__intersect__
+#define __tinyGraphDb__intersect__
+
+#include <stdint.h>
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include "tinygraphdb.h"
+#include "nodemap.h"
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * Sorted set intersection
+	 *
+	 * Intersection of two sorted arrays of distinct ids. out may be NULL to only
+	 * count (else it needs room for min(size_a, size_b) ids). The kernel depends
+	 * on the sizes: galloping (exponential search of the small array in the
+	 * large one) when one is much smaller, else a SIMD block kernel comparing 8x8
+	 * (AVX2, if the CPU has it) or 4x4 (SSE2) ids at once, else a scalar merge.
+	 *******************************************************************************/
+	size_t intersectSorted (const int * a, size_t size_a, const int * b, size_t size_b, int * out);
+	
+	// Kernels (for tests and benchmarks, intersectSorted picks one)
+	size_t intersectScalar (const int * a, size_t size_a, const int * b, size_t size_b, int * out);
+	size_t intersectGalloping (const int * small, size_t size_small, const int * large, size_t size_large, int * out);
+	size_t intersectSimd (const int * a, size_t size_a, const int * b, size_t size_b, int * out);
+	
+	// Name of the SIMD kernel used by intersectSimd ("avx2", "sse2" or "scalar")
+	const char * simdKernelName ();
+	
+	
+	/*******************************************************************************
+	 * NeighborIndex Class
+	 *
+	 * _offsets   : Start of the neighbors of each node in _neighbors (one more at the end)
+	 * _neighbors : Sorted distinct neighbor ids of every node, one node after the other
+	 * _map       : Node id to index
+	 *
+	 * Sorted neighbor arrays of the nodes of a GraphDb (through the arcs of one
+	 * type, or of every type, in both directions like Node::getNodeFromArcOfType)
+	 * to answer common neighbor, similarity and triangle queries with set
+	 * intersections and no intermediate std::set. Loops are left out. The index
+	 * is read only: build() it again after changes.
+	 *******************************************************************************/
+	class NeighborIndex
+	{
+	private:
+		std::vector<uint64_t> _offsets;
+		std::vector<int> _neighbors;
+		NodeIdMap _map;
+		
+		bool range (int node_id, size_t & begin, size_t & end) const;
+		
+	public:
+		NeighborIndex () {};
+		explicit NeighborIndex (GraphDb & db, std::string_view arc_type = "") {build(db, arc_type);};
+		
+		// Index the arcs of a type (of every type if arc_type is empty)
+		void build (GraphDb & db, std::string_view arc_type = "");
+		
+		// Sorted neighbors of a node (NULL and 0 if it has none)
+		const int * neighbors (int node_id, size_t & count) const;
+		size_t degree (int node_id) const;
+		
+		// Common neighbors and similarity of two nodes //
+		std::vector<int> commonNeighbors (int node_a, int node_b) const;
+		size_t commonNeighborCount (int node_a, int node_b) const;
+		double jaccard (int node_a, int node_b) const; // |A & B| / |A | B|
+		double overlap (int node_a, int node_b) const; // |A & B| / min(|A|, |B|)
+		
+		// Triangles (each one once, as u < v < w) //
+		size_t triangleCount () const;
+		size_t triangleCount (int node_id) const;
+		template <class F> void forEachTriangle (F f) const;
+		
+		MemoryUsage memoryUsage () const;
+	};
+	
+	// Call f(u, v, w) for every triangle u < v < w
+	template <class F>
+	void NeighborIndex :: forEachTriangle (F f) const
+	{
+		std::vector<int> common;
+		size_t nb_nodes = _offsets.empty() ? 0 : _offsets.size() - 1;
+		for (size_t index = 0; index < nb_nodes; index++) {
+			int u = _map.nodeId(index);
+			const int * begin_u = _neighbors.data() + _offsets[index];
+			const int * end_u = _neighbors.data() + _offsets[index + 1];
+			for (const int * v = std::upper_bound(begin_u, end_u, u); v < end_u; v++) {
+				// w > v among the neighbors of both u and v
+				size_t count_v;
+				const int * neighbors_v = neighbors(*v, count_v);
+				const int * above_v = std::upper_bound(neighbors_v, neighbors_v + count_v, *v);
+				size_t size_v = neighbors_v + count_v - above_v;
+				size_t size_u = end_u - (v + 1);
+				common.resize(std::min(size_u, size_v));
+				size_t found = intersectSorted(v + 1, size_u, above_v, size_v, common.data());
+				for (size_t w = 0; w < found; w++) {
+					f(u, *v, common[w]);
+				}
+			}
+		}
+	}
+	
+} // namespace tinygraphdb
+
+#endif
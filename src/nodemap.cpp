@@ -0,0 +1,65 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "nodemap.h"
+
+#include <algorithm>
+
+using namespace tinygraphdb;
+
+std::vector<Node *> NodeIdMap :: build (GraphDb & db)
+{
+	std::set<Node *> all_nodes = db.allNodes();
+	std::vector<Node *> nodes(all_nodes.begin(), all_nodes.end());
+	std::sort(nodes.begin(), nodes.end(), [](const Node * a, const Node * b) {return a->unique_id() < b->unique_id();});
+	
+	_ids.clear();
+	_first_id = nodes.empty() ? 0 : nodes.front()->unique_id();
+	_size = nodes.size();
+	
+	// Ids are dense if a direct index costs at most twice the sorted ids
+	int64_t range = nodes.empty() ? 0 : (int64_t) nodes.back()->unique_id() - _first_id + 1;
+	if (range <= 2 * (int64_t) nodes.size()) {
+		_size = (size_t) range;
+	} else {
+		_ids.reserve(nodes.size());
+		for (size_t n = 0; n < nodes.size(); n++) {
+			_ids.push_back(nodes[n]->unique_id());
+		}
+	}
+	_ids.shrink_to_fit();
+	return nodes;
+}
+
+int NodeIdMap :: index (int node_id) const
+{
+	if (_ids.empty()) {
+		if (node_id < _first_id || (int64_t) node_id - _first_id >= (int64_t) _size) {
+			return -1;
+		}
+		return node_id - _first_id;
+	}
+	std::vector<int>::const_iterator it = std::lower_bound(_ids.begin(), _ids.end(), node_id);
+	return it == _ids.end() || *it != node_id ? -1 : (int) (it - _ids.begin());
+}
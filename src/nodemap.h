@@ -0,0 +1,92 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__nodemap__
+#define __tinyGraphDb__nodemap__
+
+#include <stdint.h>
+#include <vector>
+
+#include "tinygraphdb.h"
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * NodeIdMap Class
+	 *
+	 * _ids      : Sorted node ids (empty if ids are dense: node id - _first_id is the index)
+	 * _first_id : Smallest node id
+	 * _size     : Number of indexes (with the missing ids of a dense range)
+	 *
+	 * Node ids to the indexes of a compressed sparse row (CSR) layout, shared by
+	 * CompressedAdjacency, NeighborIndex and GraphSampler. Ids are dense if a
+	 * direct index costs at most twice the sorted ids; the missing ids of a
+	 * dense range get an empty row.
+	 *******************************************************************************/
+	class NodeIdMap
+	{
+	private:
+		std::vector<int> _ids;
+		int _first_id;
+		size_t _size;
+		
+	public:
+		NodeIdMap (): _first_id(0), _size(0) {};
+		
+		// Map the nodes of a GraphDb and return them sorted by id (index() can be called right away)
+		std::vector<Node *> build (GraphDb & db);
+		
+		// Build the CSR rows in index order: row(node) appends the entries of a node
+		// (to a buffer starting empty) and returns their new total number
+		template <class F> void buildRows (const std::vector<Node *> & nodes, std::vector<uint64_t> & offsets, F row) const;
+		
+		size_t size () const {return _size;};
+		// Return the index of a node id (-1 if it is not in the map)
+		int index (int node_id) const;
+		int nodeId (size_t index) const {return _ids.empty() ? _first_id + (int) index : _ids[index];};
+		
+		size_t memoryUsage () const {return _ids.capacity() * sizeof(int);};
+	};
+	
+	// offsets gets the start of every row, and one more at the end
+	template <class F>
+	void NodeIdMap :: buildRows (const std::vector<Node *> & nodes, std::vector<uint64_t> & offsets, F row) const
+	{
+		offsets.clear();
+		offsets.reserve(_size + 1);
+		uint64_t end = 0;
+		for (size_t n = 0; n < nodes.size(); n++) {
+			size_t index = _ids.empty() ? (size_t) (nodes[n]->unique_id() - _first_id) : n;
+			while (offsets.size() < index) {
+				offsets.push_back(end);
+			}
+			offsets.push_back(end);
+			end = row(nodes[n]);
+		}
+		offsets.push_back(end);
+	}
+	
+} // namespace tinygraphdb
+
+#endif
@@ -0,0 +1,319 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "reachability.h"
+
+#include <algorithm>
+
+using namespace tinygraphdb;
+
+static const std::vector<int> NO_IDS;
+
+// Merge sorted ids into a sorted list, return the number of ids added
+static size_t mergeIds (std::vector<int> & ids, const std::vector<int> & added)
+{
+	size_t before = ids.size();
+	std::vector<int> merged;
+	merged.reserve(ids.size() + added.size());
+	std::set_union(ids.begin(), ids.end(), added.begin(), added.end(), std::back_inserter(merged));
+	ids.swap(merged);
+	return ids.size() - before;
+}
+
+// Return the sorted ids with one more id
+static std::vector<int> withId (const std::vector<int> & ids, int id)
+{
+	std::vector<int> result(ids);
+	std::vector<int>::iterator it = std::lower_bound(result.begin(), result.end(), id);
+	if (it == result.end() || *it != id) {
+		result.insert(it, id);
+	}
+	return result;
+}
+
+ReachabilityIndex :: ReachabilityIndex (const std::vector<std::string> & arc_types): _db(NULL), _pairs(0)
+{
+	for (size_t i = 0; i < arc_types.size(); i++) {
+		_types.push_back(StringPool::instance().intern(arc_types[i]));
+	}
+}
+
+bool ReachabilityIndex :: inHierarchy (const Arc & arc) const
+{
+	return std::find(_types.begin(), _types.end(), arc.typeId()) != _types.end();
+}
+
+// Compute the closure from the arcs of the hierarchy
+void ReachabilityIndex :: build (GraphDb & db)
+{
+	_db = &db;
+	clear();
+	std::set<int> nodes;
+	std::set<Arc *> arcs = db.allArcs();
+	for (std::set<Arc *>::iterator it = arcs.begin(); it != arcs.end(); it++) {
+		if (inHierarchy(**it)) {
+			nodes.insert((*it)->fromNode()->unique_id());
+		}
+	}
+	closeAncestors(std::vector<int>(nodes.begin(), nodes.end()), NULL);
+}
+
+// Every node reaching from (and from) now reaches to and every ancestor of to
+void ReachabilityIndex :: arcAdded (const Arc & arc)
+{
+	if (!inHierarchy(arc)) {
+		return;
+	}
+	int from_id = arc.fromNode()->unique_id();
+	int to_id = arc.toNode()->unique_id();
+	if (reaches(from_id, to_id)) {
+		return;
+	}
+	// Sources already reaching to already have its ancestors, targets already above from already have its descendants
+	std::vector<int> sources;
+	std::vector<int> all_sources = withId(descendants(from_id), from_id);
+	for (size_t i = 0; i < all_sources.size(); i++) {
+		if (!reaches(all_sources[i], to_id)) {
+			sources.push_back(all_sources[i]);
+		}
+	}
+	std::vector<int> targets;
+	std::vector<int> all_targets = withId(ancestors(to_id), to_id);
+	for (size_t i = 0; i < all_targets.size(); i++) {
+		if (!reaches(from_id, all_targets[i])) {
+			targets.push_back(all_targets[i]);
+		}
+	}
+	for (size_t i = 0; i < sources.size(); i++) {
+		_pairs += mergeIds(_closure[sources[i]].ancestors, targets);
+	}
+	for (size_t i = 0; i < targets.size(); i++) {
+		mergeIds(_closure[targets[i]].descendants, sources);
+	}
+}
+
+// Tarjan on the nodes (iterative): a component is complete after the components it reaches,
+// so its ancestors are its parent components and their ancestors (and itself on a cycle)
+void ReachabilityIndex :: closeAncestors (const std::vector<int> & ids, const Arc * skipped)
+{
+	size_t nb_nodes = ids.size();
+	std::unordered_map<int, int> index_of;
+	for (size_t i = 0; i < nb_nodes; i++) {
+		index_of[ids[i]] = (int) i;
+	}
+	// Parents in the set (local indexes) and out of it (ids, their ancestors are already right)
+	std::vector<std::vector<int> > parents(nb_nodes);
+	std::vector<std::vector<int> > outer_parents(nb_nodes);
+	for (size_t i = 0; i < nb_nodes; i++) {
+		Node * node = _db->getNode(ids[i]);
+		if (node == NULL) {
+			continue;
+		}
+		for (std::set<Arc *>::const_iterator it = node->arcs().begin(); it != node->arcs().end(); it++) {
+			if (*it == skipped || (*it)->fromNode() != node || !inHierarchy(**it)) {
+				continue;
+			}
+			int parent_id = (*it)->toNode()->unique_id();
+			std::unordered_map<int, int>::iterator found = index_of.find(parent_id);
+			if (found != index_of.end()) {
+				parents[i].push_back(found->second);
+			} else {
+				outer_parents[i].push_back(parent_id);
+			}
+		}
+	}
+	
+	std::vector<int> order(nb_nodes, -1);
+	std::vector<int> low(nb_nodes, 0);
+	std::vector<int> component(nb_nodes, -1);
+	std::vector<int> stack;
+	std::vector<std::pair<int, size_t> > calls;
+	std::vector<std::vector<int> > members;
+	std::vector<std::vector<int> > component_ancestors;
+	std::vector<int> touched;
+	int counter = 0;
+	for (size_t root = 0; root < nb_nodes; root++) {
+		if (order[root] >= 0) {
+			continue;
+		}
+		order[root] = low[root] = counter++;
+		stack.push_back((int) root);
+		calls.push_back(std::make_pair((int) root, 0));
+		while (!calls.empty()) {
+			int node = calls.back().first;
+			size_t & next = calls.back().second;
+			if (next < parents[node].size()) {
+				int parent = parents[node][next++];
+				if (order[parent] < 0) {
+					order[parent] = low[parent] = counter++;
+					stack.push_back(parent);
+					calls.push_back(std::make_pair(parent, 0));
+				} else if (component[parent] < 0) {
+					low[node] = std::min(low[node], order[parent]);
+				}
+				continue;
+			}
+			calls.pop_back();
+			if (!calls.empty()) {
+				low[calls.back().first] = std::min(low[calls.back().first], low[node]);
+			}
+			if (low[node] != order[node]) {
+				continue;
+			}
+			
+			// Pop the component and gather its ancestors
+			int current = (int) members.size();
+			members.push_back(std::vector<int>());
+			int member;
+			do {
+				member = stack.back();
+				stack.pop_back();
+				component[member] = current;
+				members.back().push_back(member);
+			} while (member != node);
+			std::vector<int> gathered;
+			for (size_t m = 0; m < members[current].size(); m++) {
+				int local = members[current][m];
+				for (size_t p = 0; p < parents[local].size(); p++) {
+					int parent_component = component[parents[local][p]];
+					const std::vector<int> & above = members[parent_component];
+					for (size_t a = 0; a < above.size(); a++) {
+						gathered.push_back(ids[above[a]]);
+					}
+					if (parent_component != current) {
+						gathered.insert(gathered.end(), component_ancestors[parent_component].begin(), component_ancestors[parent_component].end());
+					}
+				}
+				for (size_t p = 0; p < outer_parents[local].size(); p++) {
+					const std::vector<int> & above = ancestors(outer_parents[local][p]);
+					gathered.push_back(outer_parents[local][p]);
+					gathered.insert(gathered.end(), above.begin(), above.end());
+				}
+			}
+			std::sort(gathered.begin(), gathered.end());
+			gathered.erase(std::unique(gathered.begin(), gathered.end()), gathered.end());
+			component_ancestors.push_back(gathered);
+			
+			// Replace the ancestors of the members, and update the descendants of the lost and gained ones
+			for (size_t m = 0; m < members[current].size(); m++) {
+				int id = ids[members[current][m]];
+				std::vector<int> & old_ancestors = _closure[id].ancestors;
+				std::vector<int> lost;
+				std::set_difference(old_ancestors.begin(), old_ancestors.end(), gathered.begin(), gathered.end(), std::back_inserter(lost));
+				std::vector<int> gained;
+				std::set_difference(gathered.begin(), gathered.end(), old_ancestors.begin(), old_ancestors.end(), std::back_inserter(gained));
+				for (size_t l = 0; l < lost.size(); l++) {
+					std::vector<int> & descendants = _closure[lost[l]].descendants;
+					std::vector<int>::iterator it = std::lower_bound(descendants.begin(), descendants.end(), id);
+					if (it != descendants.end() && *it == id) {
+						descendants.erase(it);
+					}
+				}
+				for (size_t g = 0; g < gained.size(); g++) {
+					_closure[gained[g]].descendants.push_back(id);
+				}
+				touched.insert(touched.end(), gained.begin(), gained.end());
+				_pairs = _pairs + gathered.size() - old_ancestors.size();
+				old_ancestors = gathered;
+			}
+		}
+	}
+	
+	std::sort(touched.begin(), touched.end());
+	touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+	for (size_t i = 0; i < touched.size(); i++) {
+		std::vector<int> & descendants = _closure[touched[i]].descendants;
+		std::sort(descendants.begin(), descendants.end());
+		descendants.erase(std::unique(descendants.begin(), descendants.end()), descendants.end());
+	}
+}
+
+// Only from and its descendants can lose ancestors: compute them again
+void ReachabilityIndex :: arcErased (const Arc & arc)
+{
+	if (!inHierarchy(arc) || _db == NULL) {
+		return;
+	}
+	closeAncestors(withId(descendants(arc.fromNode()->unique_id()), arc.fromNode()->unique_id()), &arc);
+}
+
+// Arcs are erased before their nodes: only an empty entry is left
+void ReachabilityIndex :: nodeErased (const Node & node)
+{
+	_closure.erase(node.unique_id());
+}
+
+bool ReachabilityIndex :: reaches (int from_id, int to_id) const
+{
+	const std::vector<int> & found = ancestors(from_id);
+	return std::binary_search(found.begin(), found.end(), to_id);
+}
+
+const std::vector<int> & ReachabilityIndex :: ancestors (int node_id) const
+{
+	std::unordered_map<int, Closure>::const_iterator it = _closure.find(node_id);
+	return it == _closure.end() ? NO_IDS : it->second.ancestors;
+}
+
+const std::vector<int> & ReachabilityIndex :: descendants (int node_id) const
+{
+	std::unordered_map<int, Closure>::const_iterator it = _closure.find(node_id);
+	return it == _closure.end() ? NO_IDS : it->second.descendants;
+}
+
+// Keep the ids of the nodes of a type
+static std::vector<int> idsOfType (GraphDb * db, const std::vector<int> & ids, std::string_view type)
+{
+	std::vector<int> result;
+	int type_id = StringPool::instance().lookup(type);
+	if (db == NULL || type_id < 0) {
+		return result;
+	}
+	for (size_t i = 0; i < ids.size(); i++) {
+		Node * node = db->getNode(ids[i]);
+		if (node != NULL && node->typeId() == type_id) {
+			result.push_back(ids[i]);
+		}
+	}
+	return result;
+}
+
+std::vector<int> ReachabilityIndex :: ancestorsOfType (int node_id, std::string_view type) const
+{
+	return idsOfType(_db, ancestors(node_id), type);
+}
+
+std::vector<int> ReachabilityIndex :: descendantsOfType (int node_id, std::string_view type) const
+{
+	return idsOfType(_db, descendants(node_id), type);
+}
+
+MemoryUsage ReachabilityIndex :: memoryUsage () const
+{
+	size_t bytes = _closure.bucket_count() * sizeof(void *) + _closure.size() * (sizeof(Closure) + sizeof(int) + 2 * sizeof(void *));
+	for (std::unordered_map<int, Closure>::const_iterator it = _closure.begin(); it != _closure.end(); it++) {
+		bytes += (it->second.ancestors.capacity() + it->second.descendants.capacity()) * sizeof(int);
+	}
+	return MemoryUsage("reachability", _pairs, bytes);
+}
@@ -0,0 +1,103 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__reachability__
+#define __tinyGraphDb__reachability__
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tinygraphdb.h"
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * ReachabilityIndex Class
+	 *
+	 * _types   : Interned arc types of the hierarchy
+	 * _db      : Indexed graph (set by build)
+	 * _closure : Sorted ancestor and descendant ids of every node of the hierarchy
+	 * _pairs   : Number of (descendant, ancestor) pairs
+	 *
+	 * Transitive closure of the arcs of some types (for example "is a" and "is in
+	 * pathway"), registered with GraphDb::addView. A node's ancestors are the
+	 * nodes it reaches following the arcs from their from node to their to node,
+	 * its descendants the nodes reaching it. The lists are materialized, so
+	 * reaches() is a binary search and ancestors() and descendants() return them
+	 * without traversal. Memory grows with the number of pairs (node count times
+	 * depth for a hierarchy), so the index suits shallow hierarchies rather than
+	 * arbitrary graphs.
+	 *
+	 * build() computes the closure on the strongly connected components, in
+	 * topological order. The index is then kept up to date as a view. A new arc
+	 * from u to v adds v and its ancestors to the ancestors of u and of its
+	 * descendants (nothing if v was already an ancestor of u). An erased arc only
+	 * recomputes the ancestors of u and of its descendants, the same way. Cycles are
+	 * allowed: the nodes of a cycle are ancestors of themselves.
+	 *******************************************************************************/
+	class ReachabilityIndex : public AggregateView
+	{
+	private:
+		struct Closure
+		{
+			std::vector<int> ancestors;
+			std::vector<int> descendants;
+		};
+		
+		std::vector<int> _types;
+		GraphDb * _db;
+		std::unordered_map<int, Closure> _closure;
+		size_t _pairs;
+		
+		bool inHierarchy (const Arc & arc) const;
+		// Compute again the ancestors of nodes (with all their descendants), skipping an arc being erased
+		void closeAncestors (const std::vector<int> & ids, const Arc * skipped);
+		
+	public:
+		explicit ReachabilityIndex (const std::vector<std::string> & arc_types);
+		
+		// AggregateView //
+		void clear () {_closure.clear(); _pairs = 0;};
+		void build (GraphDb & db);
+		void arcAdded (const Arc & arc);
+		void arcErased (const Arc & arc);
+		void nodeErased (const Node & node);
+		
+		// Return true if from_id reaches to_id through at least one arc of the hierarchy
+		bool reaches (int from_id, int to_id) const;
+		// Sorted ids (empty if the node has no arc of the hierarchy)
+		const std::vector<int> & ancestors (int node_id) const;
+		const std::vector<int> & descendants (int node_id) const;
+		// Ancestors or descendants of a node type
+		std::vector<int> ancestorsOfType (int node_id, std::string_view type) const;
+		std::vector<int> descendantsOfType (int node_id, std::string_view type) const;
+		
+		size_t nbPairs () const {return _pairs;};
+		MemoryUsage memoryUsage () const;
+	};
+	
+} // namespace tinygraphdb
+
+#endif
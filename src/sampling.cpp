@@ -0,0 +1,322 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "sampling.h"
+#include "stream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+using namespace tinygraphdb;
+
+// Return the number of threads to use (hardware concurrency if nb_threads <= 0)
+static int threadCount (int nb_threads)
+{
+	if (nb_threads <= 0) {
+		nb_threads = (int) std::thread::hardware_concurrency();
+		if (nb_threads <= 0) {
+			nb_threads = 4;
+		}
+	}
+	return nb_threads;
+}
+
+// Call f(chunk) for every chunk from nb_threads threads, rethrow the first exception
+template <class F>
+static void runChunks (size_t nb_chunks, int nb_threads, F f)
+{
+	nb_threads = (int) std::min((size_t) threadCount(nb_threads), nb_chunks);
+	if (nb_threads <= 1) {
+		for (size_t chunk = 0; chunk < nb_chunks; chunk++) {
+			f(chunk);
+		}
+		return;
+	}
+	std::atomic<size_t> next(0);
+	std::exception_ptr error;
+	std::mutex mutex;
+	std::vector<std::thread> workers;
+	for (int t = 0; t < nb_threads; t++) {
+		workers.push_back(std::thread([&]() {
+			try {
+				for (size_t chunk = next++; chunk < nb_chunks; chunk = next++) {
+					f(chunk);
+				}
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!error) {
+					error = std::current_exception();
+				}
+				next = nb_chunks;
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+// Return the weight of an arc (1 without the property, 0 if it is not a number)
+static double arcWeight (const Arc & arc, int property)
+{
+	PropertyValues values = arc.properties().values(property);
+	if (values.empty()) {
+		return 1;
+	}
+	const PropEntry & entry = values.begin().entry();
+	if (entry.type != PROP_STRING) {
+		return entry.typed().asDouble();
+	}
+	std::string text = entry.text();
+	char * end;
+	double weight = strtod(text.c_str(), &end);
+	return text.empty() || *end != '\0' ? 0 : weight;
+}
+
+
+/*******************************************************************************
+ * GraphSampler
+ *******************************************************************************/
+
+void GraphSampler :: build (GraphDb & db, const std::vector<std::string> & arc_types, ArcDirection direction, std::string_view weight_property)
+{
+	std::vector<Node *> nodes = _map.build(db);
+	std::vector<int> type_ids;
+	for (size_t i = 0; i < arc_types.size(); i++) {
+		int type_id = StringPool::instance().lookup(arc_types[i]);
+		if (type_id >= 0) {
+			type_ids.push_back(type_id);
+		}
+	}
+	bool any_type = arc_types.empty();
+	bool weighted = !weight_property.empty();
+	int weight_id = StringPool::instance().lookup(weight_property);
+	
+	_neighbors.clear();
+	_prob.clear();
+	_alias.clear();
+	
+	std::vector<double> weights;
+	_map.buildRows(nodes, _offsets, [&](Node * node) {
+		size_t begin = _neighbors.size();
+		weights.clear();
+		for (std::set<Arc *>::const_iterator it = node->arcs().begin(); it != node->arcs().end(); it++) {
+			const Arc & arc = **it;
+			if (!any_type && std::find(type_ids.begin(), type_ids.end(), arc.typeId()) == type_ids.end()) {
+				continue;
+			}
+			bool outgoing = arc.fromNode() == node && (direction & DIRECTION_OUT) != 0;
+			bool incoming = arc.toNode() == node && (direction & DIRECTION_IN) != 0;
+			if (!outgoing && !incoming) {
+				continue;
+			}
+			double weight = weighted && weight_id >= 0 ? arcWeight(arc, weight_id) : 1;
+			if (!(weight > 0)) {
+				continue;
+			}
+			_neighbors.push_back((uint32_t) index((outgoing ? arc.toNode() : arc.fromNode())->unique_id()));
+			weights.push_back(weight);
+		}
+		if (weighted) {
+			buildAlias(begin, _neighbors.size(), weights);
+		}
+		return (uint64_t) _neighbors.size();
+	});
+	_offsets.shrink_to_fit();
+	_neighbors.shrink_to_fit();
+}
+
+// Vose's alias method: every position keeps its own neighbor with probability prob, else takes its alias
+void GraphSampler :: buildAlias (size_t begin, size_t end, const std::vector<double> & weights)
+{
+	size_t count = end - begin;
+	_prob.resize(end, 1);
+	_alias.resize(end, 0);
+	double total = 0;
+	for (size_t i = 0; i < count; i++) {
+		total += weights[i];
+	}
+	std::vector<double> scaled(count);
+	std::vector<uint32_t> small;
+	std::vector<uint32_t> large;
+	for (size_t i = 0; i < count; i++) {
+		scaled[i] = weights[i] * count / total;
+		if (scaled[i] < 1) {
+			small.push_back((uint32_t) i);
+		} else {
+			large.push_back((uint32_t) i);
+		}
+	}
+	while (!small.empty() && !large.empty()) {
+		uint32_t less = small.back();
+		uint32_t more = large.back();
+		small.pop_back();
+		_prob[begin + less] = (float) scaled[less];
+		_alias[begin + less] = more;
+		scaled[more] -= 1 - scaled[less];
+		if (scaled[more] < 1) {
+			large.pop_back();
+			small.push_back(more);
+		}
+	}
+	// The rest is 1 up to rounding errors
+	for (size_t i = 0; i < small.size(); i++) {
+		_prob[begin + small[i]] = 1;
+		_alias[begin + small[i]] = small[i];
+	}
+	for (size_t i = 0; i < large.size(); i++) {
+		_prob[begin + large[i]] = 1;
+		_alias[begin + large[i]] = large[i];
+	}
+}
+
+uint32_t GraphSampler :: pick (uint32_t index, SampleRng & rng) const
+{
+	uint64_t begin = _offsets[index];
+	uint32_t position = rng.below((uint32_t) (_offsets[index + 1] - begin));
+	if (!_prob.empty() && rng.unit() >= _prob[begin + position]) {
+		position = _alias[begin + position];
+	}
+	return _neighbors[begin + position];
+}
+
+size_t GraphSampler :: degree (int node_id) const
+{
+	int i = index(node_id);
+	return i < 0 ? 0 : _offsets[i + 1] - _offsets[i];
+}
+
+void GraphSampler :: walkRows (const std::vector<int> & starts, size_t walks_per_node, size_t length, uint64_t seed, size_t first_row, size_t last_row, int * out) const
+{
+	for (size_t row = first_row; row < last_row; row++, out += length) {
+		SampleRng rng(seed, row);
+		int current = index(starts[row / walks_per_node]);
+		out[0] = starts[row / walks_per_node];
+		for (size_t step = 1; step < length; step++) {
+			if (current < 0 || _offsets[current] == _offsets[current + 1]) {
+				std::fill(out + step, out + length, -1);
+				break;
+			}
+			current = (int) pick((uint32_t) current, rng);
+			out[step] = nodeId((uint32_t) current);
+		}
+	}
+}
+
+void GraphSampler :: walks (const std::vector<int> & starts, size_t walks_per_node, size_t length, uint64_t seed, int nb_threads, std::vector<int> & out) const
+{
+	size_t nb_rows = starts.size() * walks_per_node;
+	out.resize(nb_rows * length);
+	if (length == 0) {
+		return;
+	}
+	runChunks((nb_rows + ROWS_PER_CHUNK - 1) / ROWS_PER_CHUNK, nb_threads, [&](size_t chunk) {
+		size_t first = chunk * ROWS_PER_CHUNK;
+		walkRows(starts, walks_per_node, length, seed, first, std::min(first + ROWS_PER_CHUNK, nb_rows), out.data() + first * length);
+	});
+}
+
+// Rows in native int32, compressed if the name ends with .gz or .zst
+void GraphSampler :: writeWalks (const std::string & fname, const std::vector<int> & starts, size_t walks_per_node, size_t length, uint64_t seed, int nb_threads) const
+{
+	size_t nb_rows = length == 0 ? 0 : starts.size() * walks_per_node;
+	writeChunks(fname, (nb_rows + ROWS_PER_CHUNK - 1) / ROWS_PER_CHUNK, threadCount(nb_threads), [&](size_t chunk, std::string & buffer) {
+		size_t first = chunk * ROWS_PER_CHUNK;
+		size_t last = std::min(first + ROWS_PER_CHUNK, nb_rows);
+		buffer.resize((last - first) * length * sizeof(int));
+		walkRows(starts, walks_per_node, length, seed, first, last, (int *) &buffer[0]);
+	});
+}
+
+size_t GraphSampler :: sampleSize (const std::vector<size_t> & fanouts)
+{
+	size_t size = 1;
+	size_t level = 1;
+	for (size_t i = 0; i < fanouts.size(); i++) {
+		level *= fanouts[i];
+		size += level;
+	}
+	return size;
+}
+
+void GraphSampler :: sampleRows (const std::vector<int> & starts, const std::vector<size_t> & fanouts, uint64_t seed, size_t first_row, size_t last_row, int * out) const
+{
+	size_t size = sampleSize(fanouts);
+	std::vector<int> indexes(size);
+	for (size_t row = first_row; row < last_row; row++, out += size) {
+		SampleRng rng(seed, row);
+		out[0] = starts[row];
+		indexes[0] = index(starts[row]);
+		// Level parents are [begin, end), their samples follow from end
+		size_t begin = 0;
+		size_t end = 1;
+		for (size_t hop = 0; hop < fanouts.size(); hop++) {
+			size_t position = end;
+			for (size_t parent = begin; parent < end; parent++) {
+				int from = indexes[parent];
+				bool none = from < 0 || _offsets[from] == _offsets[from + 1];
+				for (size_t k = 0; k < fanouts[hop]; k++, position++) {
+					indexes[position] = none ? -1 : (int) pick((uint32_t) from, rng);
+					out[position] = none ? -1 : nodeId((uint32_t) indexes[position]);
+				}
+			}
+			begin = end;
+			end = position;
+		}
+	}
+}
+
+void GraphSampler :: sampleNeighbors (const std::vector<int> & starts, const std::vector<size_t> & fanouts, uint64_t seed, int nb_threads, std::vector<int> & out) const
+{
+	size_t size = sampleSize(fanouts);
+	out.resize(starts.size() * size);
+	runChunks((starts.size() + ROWS_PER_CHUNK - 1) / ROWS_PER_CHUNK, nb_threads, [&](size_t chunk) {
+		size_t first = chunk * ROWS_PER_CHUNK;
+		sampleRows(starts, fanouts, seed, first, std::min(first + ROWS_PER_CHUNK, starts.size()), out.data() + first * size);
+	});
+}
+
+void GraphSampler :: writeSamples (const std::string & fname, const std::vector<int> & starts, const std::vector<size_t> & fanouts, uint64_t seed, int nb_threads) const
+{
+	size_t size = sampleSize(fanouts);
+	writeChunks(fname, (starts.size() + ROWS_PER_CHUNK - 1) / ROWS_PER_CHUNK, threadCount(nb_threads), [&](size_t chunk, std::string & buffer) {
+		size_t first = chunk * ROWS_PER_CHUNK;
+		size_t last = std::min(first + ROWS_PER_CHUNK, starts.size());
+		buffer.resize((last - first) * size * sizeof(int));
+		sampleRows(starts, fanouts, seed, first, last, (int *) &buffer[0]);
+	});
+}
+
+MemoryUsage GraphSampler :: memoryUsage () const
+{
+	size_t bytes = _offsets.capacity() * sizeof(uint64_t) + _neighbors.capacity() * sizeof(uint32_t) + _prob.capacity() * sizeof(float) + _alias.capacity() * sizeof(uint32_t) + _map.memoryUsage();
+	return MemoryUsage("sampler", _neighbors.size(), bytes);
+}
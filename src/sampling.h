@@ -0,0 +1,142 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__sampling__
+#define __tinyGraphDb__sampling__
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tinygraphdb.h"
+#include "nodemap.h"
+#include "expand.h"
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * SampleRng struct
+	 *
+	 * state : SplitMix64 state
+	 *
+	 * Small generator for the samplers. Every walk or sample has its own
+	 * stream, seeded from the seed of the call and its row, so that results do
+	 * not depend on the number of threads.
+	 *******************************************************************************/
+	struct SampleRng
+	{
+		uint64_t state;
+		
+		explicit SampleRng (uint64_t seed, uint64_t row = 0): state(seed ^ (row * 0xD1B54A32D192ED03ULL)) {next();};
+		
+		uint64_t next ()
+		{
+			uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		};
+		// Return an integer in [0, bound) (bound < 2^32)
+		uint32_t below (uint32_t bound) {return (uint32_t) (((next() >> 32) * bound) >> 32);};
+		// Return a number in [0, 1)
+		float unit () {return (float) (next() >> 40) * (1.0f / 16777216.0f);};
+	};
+	
+	
+	/*******************************************************************************
+	 * GraphSampler Class
+	 *
+	 * _offsets   : Start of the neighbors of each node in _neighbors (one more at the end)
+	 * _neighbors : Neighbor indexes of every node, one node after the other
+	 * _prob      : Alias table probabilities, one per neighbor (empty if unweighted)
+	 * _alias     : Alias table aliases (position in the neighbors of the node)
+	 * _map       : Node id to index
+	 *
+	 * Random walks and fixed fan-out neighbor samples (for node embeddings and
+	 * training samples) over a flat copy of the arcs of some types, in one
+	 * direction. Every arc is a neighbor entry: parallel arcs of different
+	 * types are picked more often, a loop keeps the walk in place. Weighted
+	 * samplers pick a neighbor in proportion to a numeric arc property with an
+	 * alias table per node (constant time): arcs without the property weigh 1,
+	 * arcs whose value is not a positive number are left out.
+	 *
+	 * Results are rows of node ids in flat arrays (or files of native int32,
+	 * see writeWalks), -1 where a node has no neighbor to go on with. Rows are
+	 * computed by nb_threads threads (hardware concurrency if <= 0) and are the
+	 * same for a given seed whatever the number of threads. The sampler is read
+	 * only: build() it again after the graph changes.
+	 *******************************************************************************/
+	class GraphSampler
+	{
+	public:
+		static const size_t ROWS_PER_CHUNK = 4096;
+		
+	private:
+		std::vector<uint64_t> _offsets;
+		std::vector<uint32_t> _neighbors;
+		std::vector<float> _prob;
+		std::vector<uint32_t> _alias;
+		NodeIdMap _map;
+		
+		// Return the index of a node id (-1 if it is not in the sampler)
+		int index (int node_id) const {return _map.index(node_id);};
+		int nodeId (uint32_t index) const {return _map.nodeId(index);};
+		// Return a neighbor index of a node of degree > 0
+		uint32_t pick (uint32_t index, SampleRng & rng) const;
+		// Build the alias table of the neighbors [begin, end) from their weights
+		void buildAlias (size_t begin, size_t end, const std::vector<double> & weights);
+		void walkRows (const std::vector<int> & starts, size_t walks_per_node, size_t length, uint64_t seed, size_t first_row, size_t last_row, int * out) const;
+		void sampleRows (const std::vector<int> & starts, const std::vector<size_t> & fanouts, uint64_t seed, size_t first_row, size_t last_row, int * out) const;
+		
+	public:
+		GraphSampler () {};
+		explicit GraphSampler (GraphDb & db, const std::vector<std::string> & arc_types = std::vector<std::string>(), ArcDirection direction = DIRECTION_BOTH, std::string_view weight_property = "") {build(db, arc_types, direction, weight_property);};
+		
+		// Copy the arcs of some types (every type if arc_types is empty), weighted by a property if weight_property is not empty
+		void build (GraphDb & db, const std::vector<std::string> & arc_types = std::vector<std::string>(), ArcDirection direction = DIRECTION_BOTH, std::string_view weight_property = "");
+		
+		// Random walks //
+		// walks_per_node walks of length nodes (start included) from every start
+		// node: walk r of starts[s] is the row s * walks_per_node + r of out
+		void walks (const std::vector<int> & starts, size_t walks_per_node, size_t length, uint64_t seed, int nb_threads, std::vector<int> & out) const;
+		void writeWalks (const std::string & fname, const std::vector<int> & starts, size_t walks_per_node, size_t length, uint64_t seed, int nb_threads) const;
+		
+		// Neighbor samples //
+		// One row per start node: the node, fanouts[0] neighbors drawn with
+		// replacement, fanouts[1] neighbors of each of them, and so on
+		static size_t sampleSize (const std::vector<size_t> & fanouts);
+		void sampleNeighbors (const std::vector<int> & starts, const std::vector<size_t> & fanouts, uint64_t seed, int nb_threads, std::vector<int> & out) const;
+		void writeSamples (const std::string & fname, const std::vector<int> & starts, const std::vector<size_t> & fanouts, uint64_t seed, int nb_threads) const;
+		
+		size_t nbNodes () const {return _offsets.empty() ? 0 : _offsets.size() - 1;};
+		size_t nbArcs () const {return _neighbors.size();};
+		bool weighted () const {return !_prob.empty();};
+		size_t degree (int node_id) const;
+		MemoryUsage memoryUsage () const;
+	};
+	
+} // namespace tinygraphdb
+
+#endif
@@ -0,0 +1,215 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "stats.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <sstream>
+
+using namespace tinygraphdb;
+
+// Return the name of the given operation
+const char * tinygraphdb::statOpName (StatOp op)
+{
+	switch (op) {
+		case STAT_NEW_NODE: return "newNode";
+		case STAT_NEW_NODE_WITH_ID: return "newNodeWithId";
+		case STAT_ADD_ARC: return "addArc";
+		case STAT_ERASE_NODE: return "eraseNode";
+		case STAT_ERASE_NODES: return "eraseNodes";
+		case STAT_ERASE_ARC: return "eraseArc";
+		case STAT_GET_NODES_OF_TYPE: return "getNodesOfType";
+		case STAT_GET_NODES_WITH_PROPERTY: return "getNodesWithProperty(name)";
+		case STAT_GET_NODES_WITH_PROPERTY_VALUE: return "getNodesWithProperty(name,value)";
+		case STAT_GET_NODES_WITH_TYPED_PROPERTY: return "getNodesWithProperty(name,typed)";
+		case STAT_GET_NODES_WITH_VALUE: return "getNodesWithPropertyValue";
+		case STAT_GET_NODES_OF_TYPE_WITH_PROPERTY: return "getNodesOfTypeWithProperty(type,name)";
+		case STAT_GET_NODES_OF_TYPE_WITH_PROPERTY_VALUE: return "getNodesOfTypeWithProperty(type,name,value)";
+		case STAT_GET_NODES_OF_TYPE_WITH_TYPED_PROPERTY: return "getNodesOfTypeWithProperty(type,name,typed)";
+		case STAT_SAVE: return "save";
+		case STAT_LOAD_POLICY: return "load.policy";
+		case STAT_LOAD_NODES: return "load.nodes";
+		case STAT_LOAD_RELATIONS: return "load.relations";
+		default: return "unknown";
+	}
+}
+
+// Return the name of the given counter
+const char * tinygraphdb::statCounterName (StatCounter counter)
+{
+	switch (counter) {
+		case STAT_POLICY_REJECTIONS: return "policy_rejections";
+		case STAT_NODE_READ_ERRORS: return "node_read_errors";
+		case STAT_ARC_READ_ERRORS: return "arc_read_errors";
+		case STAT_CACHE_HITS: return "cache_hits";
+		case STAT_CACHE_MISSES: return "cache_misses";
+		default: return "unknown";
+	}
+}
+
+/*******************************************************************************
+ * LatencyHistogram methods
+ *******************************************************************************/
+
+// Add a latency to the histogram
+void LatencyHistogram :: record (unsigned long long ns)
+{
+	int bucket = 0;
+	while (bucket < NB_BUCKETS - 1 && (ns >> (bucket + 1)) != 0) {
+		bucket++;
+	}
+	_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	_count.fetch_add(1, std::memory_order_relaxed);
+	_total_ns.fetch_add(ns, std::memory_order_relaxed);
+	unsigned long long max = _max_ns.load(std::memory_order_relaxed);
+	while (ns > max && !_max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+}
+
+// Clear the histogram
+void LatencyHistogram :: reset ()
+{
+	for (int i = 0; i < NB_BUCKETS; i++) {
+		_buckets[i].store(0, std::memory_order_relaxed);
+	}
+	_count.store(0, std::memory_order_relaxed);
+	_total_ns.store(0, std::memory_order_relaxed);
+	_max_ns.store(0, std::memory_order_relaxed);
+}
+
+/*******************************************************************************
+ * Stats methods
+ *******************************************************************************/
+
+// Statistics are disabled unless TGDB_STATS is set to a non zero value
+Stats :: Stats ()
+{
+	const char * env = getenv("TGDB_STATS");
+	_enabled.store(env != NULL && atoi(env) != 0, std::memory_order_relaxed);
+	for (int i = 0; i < NB_STAT_COUNTERS; i++) {
+		_counters[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+// Clear all the statistics
+void Stats :: reset ()
+{
+	for (int i = 0; i < NB_STAT_OPS; i++) {
+		_ops[i].reset();
+	}
+	for (int i = 0; i < NB_STAT_COUNTERS; i++) {
+		_counters[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+// Return the upper bound of the bucket holding the given fraction of the latencies (capped by the max latency)
+static unsigned long long percentile (const std::vector<unsigned long long> & buckets, unsigned long long count, unsigned long long max, double fraction)
+{
+	if (count == 0) {
+		return 0;
+	}
+	unsigned long long rank = (unsigned long long) (fraction * count);
+	unsigned long long seen = 0;
+	for (size_t i = 0; i < buckets.size(); i++) {
+		seen += buckets[i];
+		if (seen > rank) {
+			return std::min(1ULL << (i + 1), max);
+		}
+	}
+	return max;
+}
+
+// Copy the current statistics
+StatsSnapshot Stats :: snapshot () const
+{
+	StatsSnapshot snapshot;
+	snapshot.enabled = enabled();
+	for (int i = 0; i < NB_STAT_OPS; i++) {
+		OpStats op;
+		op.name = statOpName((StatOp) i);
+		op.count = _ops[i].count();
+		op.total_ns = _ops[i].totalNs();
+		op.max_ns = _ops[i].maxNs();
+		op.buckets.resize(LatencyHistogram::NB_BUCKETS);
+		for (int b = 0; b < LatencyHistogram::NB_BUCKETS; b++) {
+			op.buckets[b] = _ops[i].bucket(b);
+		}
+		op.p50_ns = percentile(op.buckets, op.count, op.max_ns, 0.50);
+		op.p90_ns = percentile(op.buckets, op.count, op.max_ns, 0.90);
+		op.p99_ns = percentile(op.buckets, op.count, op.max_ns, 0.99);
+		snapshot.ops.push_back(op);
+	}
+	for (int i = 0; i < NB_STAT_COUNTERS; i++) {
+		snapshot.counters.push_back(std::make_pair(std::string(statCounterName((StatCounter) i)), _counters[i].load(std::memory_order_relaxed)));
+	}
+	return snapshot;
+}
+
+/*******************************************************************************
+ * StatsSnapshot methods
+ *******************************************************************************/
+
+// Export the operations that have been called and the counters as a text table
+std::string StatsSnapshot :: toText () const
+{
+	std::stringstream out;
+	out << "operation\tcount\ttotal_us\tmean_ns\tp50_ns\tp90_ns\tp99_ns\tmax_ns\n";
+	for (size_t i = 0; i < ops.size(); i++) {
+		if (ops[i].count == 0) {
+			continue;
+		}
+		out << ops[i].name << "\t" << ops[i].count << "\t" << ops[i].total_ns / 1000 << "\t" << ops[i].total_ns / ops[i].count;
+		out << "\t" << ops[i].p50_ns << "\t" << ops[i].p90_ns << "\t" << ops[i].p99_ns << "\t" << ops[i].max_ns << "\n";
+	}
+	for (size_t i = 0; i < counters.size(); i++) {
+		out << counters[i].first << "\t" << counters[i].second << "\n";
+	}
+	return out.str();
+}
+
+// Export all the statistics (with the histogram buckets) as a JSON object
+std::string StatsSnapshot :: toJson () const
+{
+	std::stringstream out;
+	out << "{\"enabled\": " << (enabled ? "true" : "false") << ", \"ops\": {";
+	for (size_t i = 0; i < ops.size(); i++) {
+		out << (i ? ", " : "") << "\"" << ops[i].name << "\": {\"count\": " << ops[i].count << ", \"total_ns\": " << ops[i].total_ns;
+		out << ", \"max_ns\": " << ops[i].max_ns << ", \"p50_ns\": " << ops[i].p50_ns << ", \"p90_ns\": " << ops[i].p90_ns << ", \"p99_ns\": " << ops[i].p99_ns;
+		out << ", \"buckets\": [";
+		size_t last = ops[i].buckets.size();
+		while (last > 0 && ops[i].buckets[last - 1] == 0) {
+			last--;
+		}
+		for (size_t b = 0; b < last; b++) {
+			out << (b ? ", " : "") << ops[i].buckets[b];
+		}
+		out << "]}";
+	}
+	out << "}, \"counters\": {";
+	for (size_t i = 0; i < counters.size(); i++) {
+		out << (i ? ", " : "") << "\"" << counters[i].first << "\": " << counters[i].second;
+	}
+	out << "}}";
+	return out.str();
+}
@@ -0,0 +1,195 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__stats__
+#define __tinyGraphDb__stats__
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * Timed operations and counters
+	 *
+	 * Statistics are enabled at run time with GraphDb::enableStats() or with the
+	 * environment variable TGDB_STATS=1 (needed to time the load of a file).
+	 * Compile with -DTGDB_NO_STATS to remove them completely.
+	 *******************************************************************************/
+	enum StatOp
+	{
+		STAT_NEW_NODE,
+		STAT_NEW_NODE_WITH_ID,
+		STAT_ADD_ARC,
+		STAT_ERASE_NODE,
+		STAT_ERASE_NODES,
+		STAT_ERASE_ARC,
+		STAT_GET_NODES_OF_TYPE,
+		STAT_GET_NODES_WITH_PROPERTY,
+		STAT_GET_NODES_WITH_PROPERTY_VALUE,
+		STAT_GET_NODES_WITH_TYPED_PROPERTY,
+		STAT_GET_NODES_WITH_VALUE,
+		STAT_GET_NODES_OF_TYPE_WITH_PROPERTY,
+		STAT_GET_NODES_OF_TYPE_WITH_PROPERTY_VALUE,
+		STAT_GET_NODES_OF_TYPE_WITH_TYPED_PROPERTY,
+		STAT_SAVE,
+		STAT_LOAD_POLICY,
+		STAT_LOAD_NODES,
+		STAT_LOAD_RELATIONS,
+		NB_STAT_OPS
+	};
+	
+	enum StatCounter
+	{
+		STAT_POLICY_REJECTIONS,
+		STAT_NODE_READ_ERRORS,
+		STAT_ARC_READ_ERRORS,
+		STAT_CACHE_HITS,
+		STAT_CACHE_MISSES,
+		NB_STAT_COUNTERS
+	};
+	
+	const char * statOpName (StatOp op);
+	const char * statCounterName (StatCounter counter);
+	
+	
+	/*******************************************************************************
+	 * LatencyHistogram Class
+	 *
+	 * Lock-free histogram of latencies. Bucket i counts the latencies in
+	 * [2^i, 2^(i+1)) nanoseconds.
+	 *******************************************************************************/
+	class LatencyHistogram
+	{
+	public:
+		static const int NB_BUCKETS = 48;
+		
+	private:
+		std::atomic<unsigned long long> _buckets[NB_BUCKETS];
+		std::atomic<unsigned long long> _count;
+		std::atomic<unsigned long long> _total_ns;
+		std::atomic<unsigned long long> _max_ns;
+		
+	public:
+		LatencyHistogram () {reset();};
+		
+		void record (unsigned long long ns);
+		void reset ();
+		
+		unsigned long long count () const {return _count.load(std::memory_order_relaxed);};
+		unsigned long long totalNs () const {return _total_ns.load(std::memory_order_relaxed);};
+		unsigned long long maxNs () const {return _max_ns.load(std::memory_order_relaxed);};
+		unsigned long long bucket (int i) const {return _buckets[i].load(std::memory_order_relaxed);};
+	};
+	
+	
+	/*******************************************************************************
+	 * StatsSnapshot struct
+	 *
+	 * Copy of the statistics at a given time, exportable as text or JSON.
+	 * Percentiles are upper bounds of histogram buckets.
+	 *******************************************************************************/
+	struct OpStats
+	{
+		std::string name;
+		unsigned long long count;
+		unsigned long long total_ns;
+		unsigned long long max_ns;
+		unsigned long long p50_ns;
+		unsigned long long p90_ns;
+		unsigned long long p99_ns;
+		std::vector<unsigned long long> buckets;
+	};
+	
+	struct StatsSnapshot
+	{
+		bool enabled;
+		std::vector<OpStats> ops;
+		std::vector<std::pair<std::string, unsigned long long> > counters;
+		
+		std::string toText () const;
+		std::string toJson () const;
+	};
+	
+	
+	/*******************************************************************************
+	 * Stats Class
+	 *
+	 * _enabled  : Statistics are recorded only when enabled
+	 * _ops      : One latency histogram per operation
+	 * _counters : Event counters (policy rejections, read errors)
+	 *******************************************************************************/
+	class Stats
+	{
+	private:
+		std::atomic<bool> _enabled;
+		LatencyHistogram _ops[NB_STAT_OPS];
+		std::atomic<unsigned long long> _counters[NB_STAT_COUNTERS];
+		
+	public:
+		Stats ();
+		
+		void enable (bool enabled) {_enabled.store(enabled, std::memory_order_relaxed);};
+		bool enabled () const {return _enabled.load(std::memory_order_relaxed);};
+		void reset ();
+		
+		void record (StatOp op, unsigned long long ns) {_ops[op].record(ns);};
+		void count (StatCounter counter) {if (enabled()) _counters[counter].fetch_add(1, std::memory_order_relaxed);};
+		
+		StatsSnapshot snapshot () const;
+	};
+	
+	
+	/*******************************************************************************
+	 * StatsScope Class
+	 *
+	 * Time the enclosing scope and record it in the given operation histogram
+	 * (does nothing but a flag check when statistics are disabled)
+	 *******************************************************************************/
+	class StatsScope
+	{
+	private:
+		Stats & _stats;
+		StatOp _op;
+		bool _active;
+		std::chrono::steady_clock::time_point _start;
+		
+	public:
+		StatsScope (Stats & stats, StatOp op): _stats(stats), _op(op), _active(stats.enabled()) {if (_active) _start = std::chrono::steady_clock::now();};
+		~StatsScope () {if (_active) _stats.record(_op, (unsigned long long) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count());};
+	};
+	
+} // namespace tinygraphdb
+
+#ifdef TGDB_NO_STATS
+#define TGDB_STATS_SCOPE(stats, op)
+#define TGDB_STATS_COUNT(stats, counter)
+#else
+#define TGDB_STATS_SCOPE(stats, op) tinygraphdb::StatsScope tgdb_stats_scope_(stats, op)
+#define TGDB_STATS_COUNT(stats, counter) (stats).count(counter)
+#endif
+
+#endif
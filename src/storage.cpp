@@ -0,0 +1,646 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "storage.h"
+#include "tinygraphdb.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace tinygraphdb;
+
+// Throw an exception about a file
+static void fileError (const std::string & fname, const std::string & what)
+{
+	std::stringstream error_message;
+	error_message << what << " " << fname << ": " << strerror(errno);
+	throw std::runtime_error(error_message.str());
+}
+
+/*******************************************************************************
+ * PageFile methods
+ *******************************************************************************/
+
+PageFile :: PageFile (const std::string & fname, size_t page_size): _page_size(page_size)
+{
+	_fd = open(fname.c_str(), O_RDONLY | O_CLOEXEC);
+	if (_fd < 0) {
+		fileError(fname, "Cannot open");
+	}
+	struct stat st;
+	if (fstat(_fd, &st) < 0) {
+		close(_fd);
+		fileError(fname, "Cannot stat");
+	}
+	_nb_pages = ((uint64_t) st.st_size + page_size - 1) / page_size;
+}
+
+PageFile :: ~PageFile ()
+{
+	close(_fd);
+}
+
+void PageFile :: read (uint64_t page_no, char * dest) const
+{
+	size_t done = 0;
+	off_t offset = (off_t) (page_no * _page_size);
+	while (done < _page_size) {
+		ssize_t size = pread(_fd, dest + done, _page_size - done, offset + done);
+		if (size < 0 && errno == EINTR) {
+			continue;
+		}
+		if (size < 0) {
+			throw std::runtime_error(std::string("Cannot read page: ") + strerror(errno));
+		}
+		if (size == 0) {
+			memset(dest + done, 0, _page_size - done);
+			break;
+		}
+		done += size;
+	}
+}
+
+
+/*******************************************************************************
+ * PageRef methods
+ *******************************************************************************/
+
+PageRef & PageRef :: operator= (PageRef && other)
+{
+	if (this != &other) {
+		release();
+		_pool = other._pool;
+		_frame = other._frame;
+		_data = other._data;
+		other._pool = NULL;
+	}
+	return *this;
+}
+
+void PageRef :: release ()
+{
+	if (_pool != NULL) {
+		_pool->unpin(_frame);
+		_pool = NULL;
+		_data = NULL;
+	}
+}
+
+
+/*******************************************************************************
+ * BufferPool methods
+ *******************************************************************************/
+
+BufferPool :: BufferPool (size_t nb_frames, size_t page_size): _page_size(page_size), _hand(0), _hits(0), _misses(0), _evictions(0)
+{
+	if (nb_frames < 4) {
+		nb_frames = 4;
+	}
+	_data.resize(nb_frames * page_size);
+	Frame empty = {{NULL, 0}, 0, false, false, false};
+	_frames.assign(nb_frames, empty);
+	_table.reserve(nb_frames);
+}
+
+// Return a frame to load a page in (clock algorithm)
+size_t BufferPool :: victim ()
+{
+	// Two full turns clear every reference bit: no victim after that means all frames are pinned
+	for (size_t step = 0; step < 2 * _frames.size(); step++) {
+		size_t frame = _hand;
+		_hand = (_hand + 1) % _frames.size();
+		Frame & candidate = _frames[frame];
+		if (!candidate.used) {
+			return frame;
+		}
+		if (candidate.pins > 0) {
+			continue;
+		}
+		if (candidate.referenced) {
+			candidate.referenced = false;
+			continue;
+		}
+		_table.erase(candidate.key);
+		candidate.used = false;
+		_evictions++;
+		return frame;
+	}
+	throw std::runtime_error("Buffer pool: every page is pinned");
+}
+
+PageRef BufferPool :: fetch (const PageFile & file, uint64_t page_no)
+{
+	PageKey key = {&file, page_no};
+	std::unique_lock<std::mutex> lock(_mutex);
+	std::unordered_map<PageKey, size_t, PageKeyHash>::iterator it = _table.find(key);
+	// Wait while another fetch reads the page (it is dropped from _table if the read fails)
+	while (it != _table.end() && _frames[it->second].loading) {
+		_loaded.wait(lock);
+		it = _table.find(key);
+	}
+	if (it != _table.end()) {
+		size_t frame = it->second;
+		_hits++;
+		_frames[frame].pins++;
+		_frames[frame].referenced = true;
+		return PageRef(this, frame, &_data[frame * _page_size]);
+	}
+	
+	// Miss: claim a frame, then read the page without the lock
+	size_t frame = victim();
+	Frame & claimed = _frames[frame];
+	claimed.key = key;
+	claimed.used = true;
+	claimed.loading = true;
+	claimed.pins = 1;
+	claimed.referenced = true;
+	_table[key] = frame;
+	_misses++;
+	lock.unlock();
+	try {
+		file.read(page_no, &_data[frame * _page_size]);
+	} catch (...) {
+		lock.lock();
+		_table.erase(key);
+		claimed.used = false;
+		claimed.loading = false;
+		claimed.pins = 0;
+		lock.unlock();
+		_loaded.notify_all();
+		throw;
+	}
+	lock.lock();
+	claimed.loading = false;
+	lock.unlock();
+	_loaded.notify_all();
+	return PageRef(this, frame, &_data[frame * _page_size]);
+}
+
+void BufferPool :: unpin (size_t frame)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_frames[frame].pins--;
+}
+
+BufferPoolStats BufferPool :: stats ()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	BufferPoolStats stats = {_frames.size(), _table.size(), 0, _hits, _misses, _evictions};
+	for (size_t i = 0; i < _frames.size(); i++) {
+		if (_frames[i].pins > 0) {
+			stats.pinned++;
+		}
+	}
+	return stats;
+}
+
+
+/*******************************************************************************
+ * PagedGraphDb writer
+ *******************************************************************************/
+
+// Records are written with a page granularity: a record never crosses a page
+class RecordWriter
+{
+private:
+	std::ofstream _out;
+	size_t _page_size;
+	size_t _record_size;
+	uint64_t _count;
+	
+public:
+	RecordWriter (const std::string & fname, size_t page_size, size_t record_size): _out(fname.c_str(), std::ios::binary | std::ios::trunc), _page_size(page_size), _record_size(record_size), _count(0)
+	{
+		if (!_out) {
+			fileError(fname, "Cannot write");
+		}
+	};
+	
+	void write (const void * record)
+	{
+		size_t per_page = _page_size / _record_size;
+		if (_count > 0 && _count % per_page == 0 && _page_size % _record_size != 0) {
+			// Pad the end of the page
+			std::string padding(_page_size - per_page * _record_size, '\0');
+			_out.write(padding.data(), padding.size());
+		}
+		_out.write((const char *) record, _record_size);
+		_count++;
+	};
+	
+	uint64_t count () const {return _count;};
+};
+
+// Heap of variable length data (returns the offset of what is written)
+class HeapWriter
+{
+private:
+	std::ofstream _out;
+	uint64_t _size;
+	
+public:
+	explicit HeapWriter (const std::string & fname): _out(fname.c_str(), std::ios::binary | std::ios::trunc), _size(0)
+	{
+		if (!_out) {
+			fileError(fname, "Cannot write");
+		}
+	};
+	
+	uint64_t write (const void * data, size_t size)
+	{
+		uint64_t offset = _size;
+		_out.write((const char *) data, size);
+		_size += size;
+		return offset;
+	};
+	
+	uint64_t size () const {return _size;};
+};
+
+// Return the index of a name in a dictionary (added if needed)
+static uint32_t dictionaryIndex (std::vector<std::string> & names, std::unordered_map<std::string, uint32_t> & index, const std::string & name)
+{
+	std::unordered_map<std::string, uint32_t>::iterator it = index.find(name);
+	if (it != index.end()) {
+		return it->second;
+	}
+	index[name] = (uint32_t) names.size();
+	names.push_back(name);
+	return (uint32_t) names.size() - 1;
+}
+
+// Write a property list in the heap: (u32 name, u32 length, value) per property
+static uint64_t writeProperties (HeapWriter & heap, const PropertyView & properties, std::vector<std::string> & names, std::unordered_map<std::string, uint32_t> & index)
+{
+	std::string buffer;
+	for (PropertyView::const_iterator it = properties.begin(); it != properties.end(); it++) {
+		uint32_t name = dictionaryIndex(names, index, it.name());
+		std::string value = it.value();
+		uint32_t size = (uint32_t) value.size();
+		buffer.append((const char *) &name, sizeof(name));
+		buffer.append((const char *) &size, sizeof(size));
+		buffer.append(value);
+	}
+	return heap.write(buffer.data(), buffer.size());
+}
+
+void PagedGraphDb :: write (GraphDb & db, const std::string & path, size_t page_size)
+{
+	if (page_size < 64 || page_size % sizeof(NodeRecord) != 0) {
+		throw std::runtime_error("Page size must be a multiple of 32 bytes");
+	}
+	std::set<Node *> all_nodes = db.allNodes();
+	std::vector<Node *> nodes(all_nodes.begin(), all_nodes.end());
+	std::sort(nodes.begin(), nodes.end(), [](const Node * a, const Node * b) {return a->unique_id() < b->unique_id();});
+	
+	std::vector<std::string> node_types, arc_types, prop_names;
+	std::unordered_map<std::string, uint32_t> node_type_index, arc_type_index, prop_name_index;
+	std::vector<std::vector<int> > type_ids;
+	HeapWriter heap(path + ".heap");
+	
+	// Arcs (numbered in the order of their from node)
+	RecordWriter arcs(path + ".arcs", page_size, sizeof(ArcRecord));
+	std::unordered_map<const Arc *, uint64_t> arc_numbers;
+	for (size_t i = 0; i < nodes.size(); i++) {
+		for (std::set<Arc *>::const_iterator it = nodes[i]->arcs().begin(); it != nodes[i]->arcs().end(); it++) {
+			if ((*it)->fromNode() != nodes[i]) {
+				continue;
+			}
+			PropertyView properties = (*it)->properties();
+			ArcRecord record;
+			memset(&record, 0, sizeof(record));
+			record.from = (*it)->fromNode()->unique_id();
+			record.to = (*it)->toNode()->unique_id();
+			record.type = dictionaryIndex(arc_types, arc_type_index, (*it)->type());
+			record.nb_props = (uint32_t) properties.size();
+			record.props = writeProperties(heap, properties, prop_names, prop_name_index);
+			arc_numbers[*it] = arcs.count();
+			arcs.write(&record);
+		}
+	}
+	
+	// Nodes and their adjacency
+	RecordWriter node_file(path + ".nodes", page_size, sizeof(NodeRecord));
+	RecordWriter adj(path + ".adj", page_size, sizeof(EdgeRecord));
+	std::vector<int> fences;
+	std::vector<EdgeRecord> edges;
+	for (size_t i = 0; i < nodes.size(); i++) {
+		Node * node = nodes[i];
+		edges.clear();
+		for (std::set<Arc *>::const_iterator it = node->arcs().begin(); it != node->arcs().end(); it++) {
+			bool outgoing = (*it)->fromNode() == node;
+			EdgeRecord edge;
+			edge.neighbor = outgoing ? (*it)->toNode()->unique_id() : (*it)->fromNode()->unique_id();
+			edge.type = dictionaryIndex(arc_types, arc_type_index, (*it)->type()) | (outgoing ? 0x80000000u : 0);
+			edge.arc = arc_numbers[*it];
+			edges.push_back(edge);
+		}
+		std::sort(edges.begin(), edges.end(), [](const EdgeRecord & a, const EdgeRecord & b) {
+			uint32_t type_a = a.type & 0x7FFFFFFFu, type_b = b.type & 0x7FFFFFFFu;
+			return type_a != type_b ? type_a < type_b : (a.neighbor != b.neighbor ? a.neighbor < b.neighbor : a.arc < b.arc);
+		});
+		
+		PropertyView properties = node->properties();
+		NodeRecord record;
+		memset(&record, 0, sizeof(record));
+		record.id = node->unique_id();
+		record.type = dictionaryIndex(node_types, node_type_index, node->type());
+		record.adj = adj.count();
+		record.degree = (uint32_t) edges.size();
+		record.nb_props = (uint32_t) properties.size();
+		record.props = writeProperties(heap, properties, prop_names, prop_name_index);
+		if (node_file.count() % (page_size / sizeof(NodeRecord)) == 0) {
+			fences.push_back(record.id);
+		}
+		node_file.write(&record);
+		for (size_t e = 0; e < edges.size(); e++) {
+			adj.write(&edges[e]);
+		}
+		if (type_ids.size() <= record.type) {
+			type_ids.resize(record.type + 1);
+		}
+		type_ids[record.type].push_back(record.id);
+	}
+	
+	// Ids of each type (already sorted) and fences
+	std::vector<std::pair<uint64_t, uint64_t> > type_lists;
+	for (size_t t = 0; t < type_ids.size(); t++) {
+		type_lists.push_back(std::make_pair(heap.write(type_ids[t].data(), type_ids[t].size() * sizeof(int)), (uint64_t) type_ids[t].size()));
+	}
+	uint64_t fences_offset = heap.write(fences.data(), fences.size() * sizeof(int));
+	
+	std::ofstream meta((path + ".meta").c_str(), std::ios::trunc);
+	if (!meta) {
+		fileError(path + ".meta", "Cannot write");
+	}
+	meta << "TGDB_PAGED\t1\n";
+	meta << "page_size\t" << page_size << "\n";
+	meta << "nodes\t" << node_file.count() << "\n";
+	meta << "arcs\t" << arcs.count() << "\n";
+	meta << "edges\t" << adj.count() << "\n";
+	meta << "fences\t" << fences_offset << "\t" << fences.size() << "\n";
+	for (size_t t = 0; t < node_types.size(); t++) {
+		meta << "node_type\t" << node_types[t] << "\t" << type_lists[t].first << "\t" << type_lists[t].second << "\n";
+	}
+	for (size_t t = 0; t < arc_types.size(); t++) {
+		meta << "arc_type\t" << arc_types[t] << "\n";
+	}
+	for (size_t p = 0; p < prop_names.size(); p++) {
+		meta << "prop_name\t" << prop_names[p] << "\n";
+	}
+}
+
+
+/*******************************************************************************
+ * PagedGraphDb methods
+ *******************************************************************************/
+
+// Read the page size in the header (needed before the files are opened)
+size_t PagedGraphDb :: pageSizeOf (const std::string & path)
+{
+	std::ifstream meta((path + ".meta").c_str());
+	std::string magic, version, key;
+	size_t page_size = 0;
+	if (!(meta >> magic >> version >> key >> page_size) || magic != "TGDB_PAGED" || key != "page_size" || page_size == 0) {
+		throw std::runtime_error("Not a paged graph: " + path + ".meta");
+	}
+	return page_size;
+}
+
+PagedGraphDb :: PagedGraphDb (const std::string & path, size_t pool_bytes):
+	_page_size(pageSizeOf(path)), _nb_nodes(0), _nb_arcs(0), _nb_edges(0),
+	_pool(pool_bytes / _page_size, _page_size),
+	_nodes(path + ".nodes", _page_size), _arcs(path + ".arcs", _page_size), _adj(path + ".adj", _page_size), _heap(path + ".heap", _page_size)
+{
+	std::ifstream meta((path + ".meta").c_str());
+	std::string line;
+	uint64_t fences_offset = 0, nb_fences = 0;
+	while (std::getline(meta, line)) {
+		std::vector<std::string> fields;
+		std::stringstream stream(line);
+		std::string field;
+		while (std::getline(stream, field, '\t')) {
+			fields.push_back(field);
+		}
+		if (fields.size() < 2) {
+			continue;
+		}
+		if (fields[0] == "nodes") _nb_nodes = std::stoull(fields[1]);
+		else if (fields[0] == "arcs") _nb_arcs = std::stoull(fields[1]);
+		else if (fields[0] == "edges") _nb_edges = std::stoull(fields[1]);
+		else if (fields[0] == "fences" && fields.size() == 3) {
+			fences_offset = std::stoull(fields[1]);
+			nb_fences = std::stoull(fields[2]);
+		} else if (fields[0] == "node_type" && fields.size() == 4) {
+			_node_types.push_back(fields[1]);
+			_type_lists.push_back(std::make_pair(std::stoull(fields[2]), std::stoull(fields[3])));
+		} else if (fields[0] == "arc_type") _arc_types.push_back(fields[1]);
+		else if (fields[0] == "prop_name") _prop_names.push_back(fields[1]);
+	}
+	_fences.resize(nb_fences);
+	if (nb_fences > 0) {
+		readHeap(fences_offset, nb_fences * sizeof(int), (char *) _fences.data());
+	}
+}
+
+// Read bytes of the heap (they may cross pages)
+void PagedGraphDb :: readHeap (uint64_t offset, size_t size, char * dest)
+{
+	while (size > 0) {
+		PageRef page = _pool.fetch(_heap, offset / _page_size);
+		size_t in_page = std::min<size_t>(size, _page_size - offset % _page_size);
+		memcpy(dest, page.data() + offset % _page_size, in_page);
+		dest += in_page;
+		offset += in_page;
+		size -= in_page;
+	}
+}
+
+template <class Record>
+Record PagedGraphDb :: readRecord (const PageFile & file, uint64_t index)
+{
+	const size_t per_page = _page_size / sizeof(Record);
+	PageRef page = _pool.fetch(file, index / per_page);
+	Record record;
+	memcpy(&record, page.data() + (index % per_page) * sizeof(Record), sizeof(Record));
+	return record;
+}
+
+// Find the record of a node: binary search of the fences, then of the page
+bool PagedGraphDb :: findNode (int node_id, NodeRecord & record)
+{
+	std::vector<int>::iterator fence = std::upper_bound(_fences.begin(), _fences.end(), node_id);
+	if (fence == _fences.begin()) {
+		return false;
+	}
+	uint64_t page_no = (fence - _fences.begin()) - 1;
+	const size_t per_page = _page_size / sizeof(NodeRecord);
+	size_t count = (size_t) std::min<uint64_t>(per_page, _nb_nodes - page_no * per_page);
+	PageRef page = _pool.fetch(_nodes, page_no);
+	size_t low = 0, high = count;
+	while (low < high) {
+		size_t middle = (low + high) / 2;
+		int32_t id;
+		memcpy(&id, page.data() + middle * sizeof(NodeRecord), sizeof(id));
+		if (id < node_id) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	if (low == count) {
+		return false;
+	}
+	memcpy(&record, page.data() + low * sizeof(NodeRecord), sizeof(NodeRecord));
+	return record.id == node_id;
+}
+
+PagedProperties PagedGraphDb :: readProperties (uint64_t offset, uint32_t nb_props)
+{
+	PagedProperties properties;
+	properties.reserve(nb_props);
+	for (uint32_t i = 0; i < nb_props; i++) {
+		uint32_t header[2];
+		readHeap(offset, sizeof(header), (char *) header);
+		std::string value(header[1], '\0');
+		readHeap(offset + sizeof(header), header[1], &value[0]);
+		properties.push_back(std::make_pair(_prop_names.at(header[0]), value));
+		offset += sizeof(header) + header[1];
+	}
+	return properties;
+}
+
+int32_t PagedGraphDb :: typeIndex (const std::vector<std::string> & names, std::string_view name) const
+{
+	for (size_t i = 0; i < names.size(); i++) {
+		if (names[i] == name) {
+			return (int32_t) i;
+		}
+	}
+	return -1;
+}
+
+bool PagedGraphDb :: hasNode (int node_id)
+{
+	NodeRecord record;
+	return findNode(node_id, record);
+}
+
+// Return a copy of a node (throw an exception if it does not exist)
+PagedNode PagedGraphDb :: getNode (int node_id)
+{
+	NodeRecord record;
+	if (!findNode(node_id, record)) {
+		std::stringstream error_message;
+		error_message << "Node '" << node_id << "' does not exist";
+		throw std::runtime_error(error_message.str());
+	}
+	PagedNode node;
+	node.unique_id = record.id;
+	node.type = _node_types.at(record.type);
+	node.properties = readProperties(record.props, record.nb_props);
+	return node;
+}
+
+PagedArc PagedGraphDb :: getArc (uint64_t arc)
+{
+	if (arc >= _nb_arcs) {
+		throw std::runtime_error("Arc number out of range");
+	}
+	ArcRecord record = readRecord<ArcRecord>(_arcs, arc);
+	PagedArc out;
+	out.from_id = record.from;
+	out.to_id = record.to;
+	out.type = _arc_types.at(record.type);
+	out.properties = readProperties(record.props, record.nb_props);
+	return out;
+}
+
+// Return the sorted ids of the nodes of a type
+std::vector<int> PagedGraphDb :: getNodesOfType (std::string_view type)
+{
+	std::vector<int> ids;
+	int32_t type_id = typeIndex(_node_types, type);
+	if (type_id >= 0) {
+		ids.resize(_type_lists[type_id].second);
+		readHeap(_type_lists[type_id].first, ids.size() * sizeof(int), (char *) ids.data());
+	}
+	return ids;
+}
+
+// Return the sorted ids of the nodes having a property value (reads every node: no index)
+std::vector<int> PagedGraphDb :: getNodesWithProperty (std::string_view prop_name, std::string_view prop_value)
+{
+	std::vector<int> ids;
+	if (typeIndex(_prop_names, prop_name) < 0) {
+		return ids;
+	}
+	const size_t per_page = _page_size / sizeof(NodeRecord);
+	for (uint64_t index = 0; index < _nb_nodes; index++) {
+		NodeRecord record;
+		{
+			PageRef page = _pool.fetch(_nodes, index / per_page);
+			memcpy(&record, page.data() + (index % per_page) * sizeof(NodeRecord), sizeof(NodeRecord));
+		}
+		PagedProperties properties = readProperties(record.props, record.nb_props);
+		for (PagedProperties::iterator it = properties.begin(); it != properties.end(); it++) {
+			if (it->first == prop_name && it->second == prop_value) {
+				ids.push_back(record.id);
+				break;
+			}
+		}
+	}
+	return ids;
+}
+
+// Return the neighbors of a node through arcs of a type (sorted, in both directions)
+std::vector<int> PagedGraphDb :: getNodeFromArcOfType (int node_id, std::string_view type)
+{
+	std::vector<int> ids;
+	int32_t type_id = typeIndex(_arc_types, type);
+	if (type_id < 0) {
+		return ids;
+	}
+	forEachArc(node_id, [&](const PagedEdge & edge) {
+		if (edge.type == (uint32_t) type_id) {
+			ids.push_back(edge.neighbor);
+		}
+	});
+	// Entries are sorted by neighbor within a type: remove the duplicates of both directions
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	return ids;
+}
+
+std::vector<PagedEdge> PagedGraphDb :: arcs (int node_id)
+{
+	std::vector<PagedEdge> edges;
+	forEachArc(node_id, [&](const PagedEdge & edge) {edges.push_back(edge);});
+	return edges;
+}
@@ -0,0 +1,339 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__storage__
+#define __tinyGraphDb__storage__
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace tinygraphdb
+{
+	class GraphDb;
+	
+	/*******************************************************************************
+	 * PageFile Class
+	 *
+	 * _fd        : File descriptor (read only)
+	 * _page_size : Size of a page in bytes
+	 * _nb_pages  : Number of pages (the last one may be partial)
+	 *******************************************************************************/
+	class PageFile
+	{
+	private:
+		int _fd;
+		size_t _page_size;
+		uint64_t _nb_pages;
+		
+	public:
+		PageFile (const std::string & fname, size_t page_size);
+		~PageFile ();
+		PageFile (const PageFile &) = delete;
+		PageFile & operator= (const PageFile &) = delete;
+		
+		// Read a page (the bytes past the end of the file are zeros)
+		void read (uint64_t page_no, char * dest) const;
+		uint64_t nbPages () const {return _nb_pages;};
+	};
+	
+	
+	/*******************************************************************************
+	 * BufferPoolStats struct
+	 *******************************************************************************/
+	struct BufferPoolStats
+	{
+		size_t frames;
+		size_t resident;
+		size_t pinned;
+		unsigned long long hits;
+		unsigned long long misses;
+		unsigned long long evictions;
+	};
+	
+	
+	class BufferPool;
+	
+	/*******************************************************************************
+	 * PageRef Class
+	 *
+	 * A pinned page of a BufferPool: the page stays resident (and data() valid)
+	 * until the PageRef is destroyed or released.
+	 *******************************************************************************/
+	class PageRef
+	{
+	private:
+		BufferPool * _pool;
+		size_t _frame;
+		const char * _data;
+		
+	public:
+		PageRef (): _pool(NULL), _frame(0), _data(NULL) {};
+		PageRef (BufferPool * pool, size_t frame, const char * data): _pool(pool), _frame(frame), _data(data) {};
+		PageRef (PageRef && other): _pool(other._pool), _frame(other._frame), _data(other._data) {other._pool = NULL;};
+		PageRef & operator= (PageRef && other);
+		PageRef (const PageRef &) = delete;
+		PageRef & operator= (const PageRef &) = delete;
+		~PageRef () {release();};
+		
+		void release ();
+		const char * data () const {return _data;};
+		bool valid () const {return _pool != NULL;};
+	};
+	
+	
+	/*******************************************************************************
+	 * BufferPool Class
+	 *
+	 * _page_size : Size of the pages (the same for every file)
+	 * _data      : Frames, _page_size bytes each
+	 * _frames    : Page held by each frame, its pin count and reference bit
+	 * _table     : (file, page) -> frame of the resident pages
+	 * _hand      : Clock hand (next frame considered for eviction)
+	 * _loaded    : Signaled when a frame has been read from its file
+	 *
+	 * Caches pages of read only PageFiles in a fixed number of frames. A page is
+	 * evicted with the clock algorithm (second chance): the hand skips pinned
+	 * frames and clears the reference bit of the others until it finds one that
+	 * was not used since its last pass. fetch() is thread safe: a miss claims
+	 * a frame (pinned and marked loading) under the lock and reads the page
+	 * without it, so hits on other pages do not wait for the disk; a fetch of
+	 * a page being loaded waits for _loaded.
+	 *******************************************************************************/
+	class BufferPool
+	{
+	private:
+		struct PageKey
+		{
+			const PageFile * file;
+			uint64_t page_no;
+			
+			bool operator== (const PageKey & other) const {return file == other.file && page_no == other.page_no;};
+		};
+		
+		struct PageKeyHash
+		{
+			size_t operator() (const PageKey & key) const {return std::hash<const void *>()(key.file) ^ std::hash<uint64_t>()(key.page_no * 0x9E3779B97F4A7C15ULL);};
+		};
+		
+		struct Frame
+		{
+			PageKey key;
+			int pins;
+			bool referenced;
+			bool used;
+			bool loading;
+		};
+		
+		size_t _page_size;
+		std::vector<char> _data;
+		std::vector<Frame> _frames;
+		std::unordered_map<PageKey, size_t, PageKeyHash> _table;
+		size_t _hand;
+		std::mutex _mutex;
+		std::condition_variable _loaded;
+		unsigned long long _hits;
+		unsigned long long _misses;
+		unsigned long long _evictions;
+		
+		size_t victim ();
+		
+	public:
+		BufferPool (size_t nb_frames, size_t page_size);
+		
+		// Return the page pinned (read from the file if it is not resident)
+		PageRef fetch (const PageFile & file, uint64_t page_no);
+		void unpin (size_t frame);
+		
+		size_t pageSize () const {return _page_size;};
+		BufferPoolStats stats ();
+	};
+	
+	
+	/*******************************************************************************
+	 * PagedNode and PagedArc structs
+	 *
+	 * Copies of a node or an arc read from a PagedGraphDb (property values are
+	 * returned as text)
+	 *******************************************************************************/
+	typedef std::vector<std::pair<std::string, std::string> > PagedProperties;
+	
+	struct PagedNode
+	{
+		int unique_id;
+		std::string type;
+		PagedProperties properties;
+	};
+	
+	struct PagedArc
+	{
+		int from_id;
+		int to_id;
+		std::string type;
+		PagedProperties properties;
+	};
+	
+	// Arc of a node during a traversal (type is an index in arcTypes())
+	struct PagedEdge
+	{
+		int neighbor;
+		uint32_t type;
+		bool outgoing;
+		uint64_t arc;
+	};
+	
+	
+	/*******************************************************************************
+	 * PagedGraphDb Class
+	 *
+	 * Read only graph stored in paged files and accessed through a buffer pool,
+	 * so that only the pages in use have to be in memory. Files (written by
+	 * PagedGraphDb::write from a GraphDb):
+	 *
+	 * <path>.meta  : Text header (page size, counts, type and property names)
+	 * <path>.nodes : Node records sorted by id (id, type, adjacency, properties)
+	 * <path>.arcs  : Arc records (from, to, type, properties)
+	 * <path>.adj   : Adjacency entries of each node, sorted by arc type and neighbor
+	 * <path>.heap  : Property lists, node ids per type and page fences
+	 *
+	 * Records never cross a page. The first id of every node page (the fences)
+	 * is kept in memory: finding a node reads a single page.
+	 *
+	 * _node_types   : Node type names (index is the type id)
+	 * _type_lists   : Offset in the heap and size of the sorted ids of each node type
+	 * _arc_types    : Arc type names
+	 * _prop_names   : Property names
+	 * _fences       : First node id of each node page
+	 *******************************************************************************/
+	class PagedGraphDb
+	{
+	private:
+		size_t _page_size;
+		uint64_t _nb_nodes;
+		uint64_t _nb_arcs;
+		uint64_t _nb_edges;
+		std::vector<std::string> _node_types;
+		std::vector<std::pair<uint64_t, uint64_t> > _type_lists;
+		std::vector<std::string> _arc_types;
+		std::vector<std::string> _prop_names;
+		std::vector<int> _fences;
+		
+		BufferPool _pool;
+		PageFile _nodes;
+		PageFile _arcs;
+		PageFile _adj;
+		PageFile _heap;
+		
+		struct NodeRecord
+		{
+			int32_t id;
+			uint32_t type;
+			uint64_t adj;
+			uint32_t degree;
+			uint32_t nb_props;
+			uint64_t props;
+		};
+		
+		struct ArcRecord
+		{
+			int32_t from;
+			int32_t to;
+			uint32_t type;
+			uint32_t nb_props;
+			uint64_t props;
+		};
+		
+		struct EdgeRecord
+		{
+			int32_t neighbor;
+			uint32_t type; // high bit set for an outgoing arc
+			uint64_t arc;
+		};
+		
+		static size_t pageSizeOf (const std::string & path);
+		bool findNode (int node_id, NodeRecord & record);
+		void readHeap (uint64_t offset, size_t size, char * dest);
+		PagedProperties readProperties (uint64_t offset, uint32_t nb_props);
+		template <class Record> Record readRecord (const PageFile & file, uint64_t index);
+		
+		int32_t typeIndex (const std::vector<std::string> & names, std::string_view name) const;
+		
+	public:
+		// Open the files written by write() with a buffer pool of pool_bytes
+		explicit PagedGraphDb (const std::string & path, size_t pool_bytes = 64 << 20);
+		
+		// Write a GraphDb to paged files
+		static void write (GraphDb & db, const std::string & path, size_t page_size = 4096);
+		
+		// Getters //
+		bool hasNode (int node_id);
+		PagedNode getNode (int node_id);
+		PagedArc getArc (uint64_t arc);
+		std::vector<int> getNodesOfType (std::string_view type);
+		std::vector<int> getNodesWithProperty (std::string_view prop_name, std::string_view prop_value);
+		std::vector<int> getNodeFromArcOfType (int node_id, std::string_view type);
+		std::vector<PagedEdge> arcs (int node_id);
+		
+		// Call f(const PagedEdge &) for every arc of a node (pages are pinned while they are read)
+		template <class F> void forEachArc (int node_id, F f);
+		
+		int nbNode () const {return (int) _nb_nodes;};
+		int nbArc () const {return (int) _nb_arcs;};
+		const std::vector<std::string> & nodeTypes () const {return _node_types;};
+		const std::vector<std::string> & arcTypes () const {return _arc_types;};
+		
+		BufferPoolStats poolStats () {return _pool.stats();};
+	};
+	
+	template <class F>
+	void PagedGraphDb :: forEachArc (int node_id, F f)
+	{
+		NodeRecord node;
+		if (!findNode(node_id, node)) {
+			return;
+		}
+		const size_t per_page = _page_size / sizeof(EdgeRecord);
+		uint64_t index = node.adj;
+		uint64_t end = node.adj + node.degree;
+		while (index < end) {
+			PageRef page = _pool.fetch(_adj, index / per_page);
+			uint64_t page_end = std::min<uint64_t>(end, (index / per_page + 1) * per_page);
+			for (; index < page_end; index++) {
+				EdgeRecord record;
+				memcpy(&record, page.data() + (index % per_page) * sizeof(EdgeRecord), sizeof(EdgeRecord));
+				PagedEdge edge = {record.neighbor, record.type & 0x7FFFFFFFu, (record.type & 0x80000000u) != 0, record.arc};
+				f(edge);
+			}
+		}
+	}
+	
+} // namespace tinygraphdb
+
+#endif
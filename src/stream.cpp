@@ -0,0 +1,366 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "stream.h"
+
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+#ifdef TGDB_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace tinygraphdb;
+
+const size_t InputStreamBuf :: BLOCK_SIZE;
+const size_t InputStreamBuf :: MAX_BLOCKS;
+
+static bool endsWith (const std::string & str, const std::string & suffix)
+{
+	return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+StreamCompression tinygraphdb :: compressionOf (const std::string & fname)
+{
+	if (endsWith(fname, ".gz")) {
+		return COMPRESSION_GZIP;
+	}
+	if (endsWith(fname, ".zst")) {
+		return COMPRESSION_ZSTD;
+	}
+	return COMPRESSION_NONE;
+}
+
+static void checkCompression (StreamCompression compression, const std::string & fname)
+{
+#ifndef TGDB_WITH_ZSTD
+	if (compression == COMPRESSION_ZSTD) {
+		std::stringstream error_message;
+		error_message << "Cannot open " << fname << ": compile with -DTGDB_WITH_ZSTD to read and write zstd files\n";
+		throw std::runtime_error(error_message.str());
+	}
+#endif
+}
+
+// Compress a chunk as a complete gzip member or zstd frame
+static void compressChunk (StreamCompression compression, const std::string & in, std::string & out)
+{
+	if (compression == COMPRESSION_GZIP) {
+		z_stream stream = z_stream();
+		if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			throw std::runtime_error("Cannot initialize the gzip compression\n");
+		}
+		out.resize(deflateBound(&stream, in.size()));
+		stream.next_in = (Bytef *) in.data();
+		stream.avail_in = (uInt) in.size();
+		stream.next_out = (Bytef *) &out[0];
+		stream.avail_out = (uInt) out.size();
+		int ret = deflate(&stream, Z_FINISH);
+		out.resize(out.size() - stream.avail_out);
+		deflateEnd(&stream);
+		if (ret != Z_STREAM_END) {
+			throw std::runtime_error("Cannot compress a chunk\n");
+		}
+	}
+#ifdef TGDB_WITH_ZSTD
+	else if (compression == COMPRESSION_ZSTD) {
+		out.resize(ZSTD_compressBound(in.size()));
+		size_t size = ZSTD_compress(&out[0], out.size(), in.data(), in.size(), 3);
+		if (ZSTD_isError(size)) {
+			throw std::runtime_error(std::string("Cannot compress a chunk: ") + ZSTD_getErrorName(size) + "\n");
+		}
+		out.resize(size);
+	}
+#endif
+}
+
+
+/*******************************************************************************
+ * writeChunks
+ *******************************************************************************/
+
+void tinygraphdb :: writeChunks (const std::string & fname, size_t nb_chunks, int nb_threads, const std::function<void (size_t, std::string &)> & format)
+{
+	StreamCompression compression = compressionOf(fname);
+	checkCompression(compression, fname);
+	FILE * outfile = fopen(fname.c_str(), "wb");
+	if (outfile == NULL) {
+		std::stringstream error_message;
+		error_message << "Cannot open file " << fname << "\n";
+		throw std::runtime_error(error_message.str());
+	}
+	if (nb_threads < 1) {
+		nb_threads = 1;
+	}
+	size_t window = 4 * (size_t) nb_threads;
+	
+	std::vector<std::string> buffers(nb_chunks);
+	std::vector<char> ready(nb_chunks, 0);
+	size_t next = 0;    // next chunk to format
+	size_t written = 0; // chunks written
+	bool failed = false;
+	std::exception_ptr error;
+	std::mutex mutex;
+	std::condition_variable cond;
+	
+	// Workers format and compress the chunks ahead of the writer, at most window chunks ahead
+	std::vector<std::thread> workers;
+	for (int t = 0; t < nb_threads; t++) {
+		workers.push_back(std::thread([&]() {
+			std::string text;
+			while (true) {
+				size_t chunk;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					cond.wait(lock, [&]() {return failed || next >= nb_chunks || next < written + window;});
+					if (failed || next >= nb_chunks) {
+						return;
+					}
+					chunk = next++;
+				}
+				try {
+					text.clear();
+					format(chunk, text);
+					if (compression == COMPRESSION_NONE) {
+						buffers[chunk].swap(text);
+					} else {
+						compressChunk(compression, text, buffers[chunk]);
+					}
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!failed) {
+						failed = true;
+						error = std::current_exception();
+					}
+					cond.notify_all();
+					return;
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				ready[chunk] = 1;
+				cond.notify_all();
+			}
+		}));
+	}
+	
+	for (size_t chunk = 0; chunk < nb_chunks; chunk++) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cond.wait(lock, [&]() {return failed || ready[chunk];});
+			if (failed) {
+				break;
+			}
+		}
+		bool ok = buffers[chunk].empty() || fwrite(buffers[chunk].data(), 1, buffers[chunk].size(), outfile) == buffers[chunk].size();
+		std::string().swap(buffers[chunk]);
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!ok && !failed) {
+			failed = true;
+			std::stringstream error_message;
+			error_message << "Cannot write file " << fname << "\n";
+			error = std::make_exception_ptr(std::runtime_error(error_message.str()));
+		}
+		written++;
+		cond.notify_all();
+	}
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+	if (fclose(outfile) != 0 && !failed) {
+		std::stringstream error_message;
+		error_message << "Cannot write file " << fname << "\n";
+		throw std::runtime_error(error_message.str());
+	}
+	if (failed) {
+		std::rethrow_exception(error);
+	}
+}
+
+
+/*******************************************************************************
+ * InputStreamBuf methods
+ *******************************************************************************/
+
+InputStreamBuf :: InputStreamBuf (const std::string & fname): _file(NULL), _compression(compressionOf(fname)), _done(false), _stop(false)
+{
+	checkCompression(_compression, fname);
+	_file = fopen(fname.c_str(), "rb");
+	if (_file != NULL && _compression != COMPRESSION_NONE) {
+		_reader = std::thread(&InputStreamBuf::read, this);
+	}
+}
+
+InputStreamBuf :: ~InputStreamBuf ()
+{
+	close();
+}
+
+void InputStreamBuf :: close ()
+{
+	if (_reader.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_cond.notify_all();
+		_reader.join();
+	}
+	if (_file != NULL) {
+		fclose(_file);
+		_file = NULL;
+	}
+	setg(NULL, NULL, NULL);
+}
+
+// Give a decompressed block to the parser (false if the stream is closed)
+bool InputStreamBuf :: push (std::string & block)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_cond.wait(lock, [&]() {return _stop || _blocks.size() < MAX_BLOCKS;});
+	if (_stop) {
+		return false;
+	}
+	_blocks.push_back(std::string());
+	_blocks.back().swap(block);
+	_cond.notify_all();
+	return true;
+}
+
+// Decompress the file block by block (reader thread)
+void InputStreamBuf :: read ()
+{
+	std::vector<unsigned char> in(BLOCK_SIZE);
+	std::string block(BLOCK_SIZE, '\0');
+	size_t filled = 0;
+	bool in_frame = false;
+	bool failed = false;
+	bool stopped = false;
+	
+	if (_compression == COMPRESSION_GZIP) {
+		// Concatenated gzip members are decompressed one after the other
+		z_stream stream = z_stream();
+		failed = inflateInit2(&stream, 15 + 32) != Z_OK;
+		while (!failed && !stopped) {
+			if (stream.avail_in == 0) {
+				size_t size = fread(in.data(), 1, in.size(), _file);
+				if (size == 0) {
+					break;
+				}
+				stream.next_in = in.data();
+				stream.avail_in = (uInt) size;
+			}
+			stream.next_out = (Bytef *) &block[filled];
+			stream.avail_out = (uInt) (BLOCK_SIZE - filled);
+			int ret = inflate(&stream, Z_NO_FLUSH);
+			filled = BLOCK_SIZE - stream.avail_out;
+			if (ret == Z_STREAM_END) {
+				in_frame = false;
+				inflateReset(&stream);
+			} else if (ret == Z_OK) {
+				in_frame = true;
+			} else {
+				failed = true;
+			}
+			if (filled == BLOCK_SIZE) {
+				stopped = !push(block);
+				block.assign(BLOCK_SIZE, '\0');
+				filled = 0;
+			}
+		}
+		inflateEnd(&stream);
+	}
+#ifdef TGDB_WITH_ZSTD
+	else if (_compression == COMPRESSION_ZSTD) {
+		// A zstd stream decompresses concatenated frames
+		ZSTD_DStream * stream = ZSTD_createDStream();
+		ZSTD_inBuffer input = {in.data(), 0, 0};
+		failed = stream == NULL;
+		while (!failed && !stopped) {
+			if (input.pos == input.size) {
+				size_t size = fread(in.data(), 1, in.size(), _file);
+				if (size == 0) {
+					break;
+				}
+				input.size = size;
+				input.pos = 0;
+			}
+			ZSTD_outBuffer output = {&block[filled], BLOCK_SIZE - filled, 0};
+			size_t ret = ZSTD_decompressStream(stream, &output, &input);
+			filled += output.pos;
+			if (ZSTD_isError(ret)) {
+				failed = true;
+			} else {
+				in_frame = ret != 0;
+			}
+			if (filled == BLOCK_SIZE) {
+				stopped = !push(block);
+				block.assign(BLOCK_SIZE, '\0');
+				filled = 0;
+			}
+		}
+		ZSTD_freeDStream(stream);
+	}
+#endif
+	
+	if (failed || (in_frame && !stopped)) {
+		std::cerr << "Corrupted or truncated compressed file -> ignore the end of the file\n";
+	}
+	if (!stopped && filled > 0) {
+		block.resize(filled);
+		push(block);
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	_done = true;
+	_cond.notify_all();
+}
+
+InputStreamBuf::int_type InputStreamBuf :: underflow ()
+{
+	if (gptr() < egptr()) {
+		return traits_type::to_int_type(*gptr());
+	}
+	if (_file == NULL) {
+		return traits_type::eof();
+	}
+	if (_compression == COMPRESSION_NONE) {
+		_current.resize(BLOCK_SIZE);
+		_current.resize(fread(&_current[0], 1, BLOCK_SIZE, _file));
+	} else {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_cond.wait(lock, [&]() {return _done || !_blocks.empty();});
+		if (_blocks.empty()) {
+			return traits_type::eof();
+		}
+		_current.swap(_blocks.front());
+		_blocks.pop_front();
+		_cond.notify_all();
+	}
+	if (_current.empty()) {
+		return traits_type::eof();
+	}
+	setg(&_current[0], &_current[0], &_current[0] + _current.size());
+	return traits_type::to_int_type(*gptr());
+}
@@ -0,0 +1,146 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__stream__
+#define __tinyGraphDb__stream__
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * Compressed files
+	 *
+	 * Files ending with .gz are gzip files (zlib, always available), files
+	 * ending with .zst are zstd files (compile with -DTGDB_WITH_ZSTD and link
+	 * with -lzstd, otherwise opening them throws). Compressed files are written
+	 * as independent gzip members or zstd frames, one per chunk, so that chunks
+	 * can be compressed in parallel; gzip and zstd tools read them as a single
+	 * stream.
+	 *******************************************************************************/
+	enum StreamCompression
+	{
+		COMPRESSION_NONE,
+		COMPRESSION_GZIP,
+		COMPRESSION_ZSTD
+	};
+	
+	// Return the compression of a file from its extension
+	StreamCompression compressionOf (const std::string & fname);
+	
+	
+	/*******************************************************************************
+	 * writeChunks
+	 *
+	 * Write nb_chunks chunks in a file, in order. format(i, buffer) fills the
+	 * buffer of chunk i; it is called by nb_threads threads at the same time,
+	 * which also compress the chunks, while the calling thread writes them. At
+	 * most 4 chunks per thread are in memory. Throw a runtime_error if the file
+	 * cannot be written.
+	 *******************************************************************************/
+	void writeChunks (const std::string & fname, size_t nb_chunks, int nb_threads, const std::function<void (size_t, std::string &)> & format);
+	
+	
+	/*******************************************************************************
+	 * InputStreamBuf Class
+	 *
+	 * _file        : Input file
+	 * _compression : Compression of the file
+	 * _reader      : Thread reading and decompressing the file (compressed files only)
+	 * _blocks      : Decompressed blocks waiting to be read (at most MAX_BLOCKS)
+	 * _current     : Block being read
+	 * _done        : true once the reader reached the end of the file (or an error)
+	 * _stop        : true to stop the reader before the end of the file
+	 *
+	 * Stream buffer over a plain or compressed file. A compressed file is
+	 * decompressed by a reader thread one block ahead of the parser, so that
+	 * decompression and parsing overlap.
+	 *******************************************************************************/
+	class InputStreamBuf : public std::streambuf
+	{
+	public:
+		static const size_t BLOCK_SIZE = 1 << 20;
+		static const size_t MAX_BLOCKS = 4;
+		
+	private:
+		FILE * _file;
+		StreamCompression _compression;
+		std::thread _reader;
+		std::mutex _mutex;
+		std::condition_variable _cond;
+		std::deque<std::string> _blocks;
+		std::string _current;
+		bool _done;
+		bool _stop;
+		
+		void read ();
+		bool push (std::string & block);
+		
+	public:
+		explicit InputStreamBuf (const std::string & fname);
+		~InputStreamBuf ();
+		
+		bool isOpen () const {return _file != NULL;};
+		// Stop the reader and close the file
+		void close ();
+		
+	protected:
+		int_type underflow ();
+	};
+	
+	
+	/*******************************************************************************
+	 * InputStream Class
+	 *
+	 * std::istream over a plain or compressed file (see InputStreamBuf), not
+	 * good() if the file cannot be opened.
+	 *******************************************************************************/
+	class InputStream : public std::istream
+	{
+	private:
+		InputStreamBuf _buffer;
+		
+	public:
+		explicit InputStream (const std::string & fname): std::istream(NULL), _buffer(fname)
+		{
+			rdbuf(&_buffer);
+			if (!_buffer.isOpen()) {
+				setstate(std::ios::failbit);
+			}
+		};
+		
+		void close () {_buffer.close();};
+	};
+	
+} // namespace tinygraphdb
+
+#endif
@@ -23,6 +23,12 @@
  */
 
 #include "tinygraphdb.h"
+#include "stream.h"
+#include <algorithm>
+#include <unordered_set>
+#include <charconv>
+#include <cerrno>
+#include <cstdio>
 
 using namespace tinygraphdb;
 
@@ -55,12 +61,13 @@ bool is_int(const std::string & s)
 // Remove spaces at the beginning and at the end of a std::string //
 void rem_spaces(std::string & str)
 {
-	int beg = 0;
-	while (str[beg] == ' ') beg++;
-	str = str.substr(beg);
-	int end = (int)str.size() - 1;
-	while (str[end] == ' ') end--;
-	str = str.substr(0,end + 1);
+	size_t end = str.find_last_not_of(' ');
+	if (end == std::string::npos) {
+		str.clear();
+		return;
+	}
+	str.erase(end + 1);
+	str.erase(0, str.find_first_not_of(' '));
 }
 
 // Remove tabulations inside a std::string //
@@ -161,451 +168,1581 @@ std::string readPropValue (std::string line)
 }
 
 /*******************************************************************************
- * Node methods
+ * Memory estimates (libstdc++ layout, allocator overhead excluded)
  *******************************************************************************/
 
-// Return the unique id of the node
-const int & Node :: unique_id () const
+// Return the given size rounded to the alignment of the allocator
+static size_t aligned (size_t bytes)
 {
-	return _unique_id;
+	return (bytes + 7) & ~(size_t) 7;
 }
 
-// Return the node type
-const std::string & Node :: type () const
+// Return the heap bytes of a string (short strings are stored inside the object)
+static size_t stringBytes (const std::string & str)
 {
-	return _type;
+	return str.capacity() > 15 ? str.capacity() + 1 : 0;
 }
 
-// Return the value of the given property  (throw an exception if it does not exist)
-const std::set<std::string> & Node :: property (const std::string & property) const
+// Return the bytes of one node of a std::set or a std::map (color, 3 links and the value)
+template <class T> static size_t treeNodeBytes ()
 {
-	if (_properties.find(property) == _properties.end()) {
-		std::stringstream error_message;
-		error_message << "Property \"" << property << "\" not found in node << " << unique_id() << "\n";
-		throw std::runtime_error(error_message.str());
-	}
-	return _properties.find(property)->second;
-};
+	return aligned(4 * sizeof(void *) + sizeof(T));
+}
 
-// Return all the properties of the node
-const std::map<std::string, std::set<std::string> > & Node :: properties () const
+// Return the bytes of one node of a std::unordered_map (link, cached hash if any and the value)
+template <class T> static size_t hashNodeBytes (bool cached_hash)
 {
-	return _properties;
+	return aligned(sizeof(void *) + sizeof(T) + (cached_hash ? sizeof(size_t) : 0));
 }
 
-// Erase a given arc in
-void Node::eraseArc	(const std::string & arc_id)
+// Return the bytes of a std::deque of the given size (512 bytes blocks and the map of blocks)
+template <class T> static size_t dequeBytes (size_t size)
 {
-	for (std::set<Arc *>::iterator it = _arcs.begin(); it != _arcs.end(); it++) {
-		if ((*it)->unique_id().compare(arc_id) == 0) {
-			_arcs.erase(it);
-			return;
-		}
+	size_t per_block = sizeof(T) < 512 ? 512 / sizeof(T) : 1;
+	size_t blocks = size / per_block + 1;
+	return blocks * per_block * sizeof(T) + std::max(blocks + 2, (size_t) 8) * sizeof(void *);
+}
+
+// Add the entries (ids) and the bytes of an index (string keys to sets of ids) to the given usage
+template <class Index> static void addIndexUsage (const Index & index, MemoryUsage & usage)
+{
+	for (typename Index::const_iterator it = index.begin(); it != index.end(); it++) {
+		usage.entries += it->second.size();
+		usage.bytes += treeNodeBytes<typename Index::value_type>() + stringBytes(it->first) + it->second.size() * treeNodeBytes<int>();
 	}
 }
 
+/*******************************************************************************
+ * StringPool methods
+ *******************************************************************************/
 
-// Return the set of input arcs of the given type
-std::set<Arc *> Node :: getArcOfType(const std::string & type)
+// Store a new string (the pool is locked by the caller) and return its id
+int StringPool :: add (std::string_view str)
 {
-	std::set<Arc *> tmp_arcs;
-	for (std::set<Arc *>::iterator it = _arcs.begin(); it != _arcs.end(); it++) {
-		if ((*it)->type().compare(type) == 0){
-			tmp_arcs.insert((*it));
+	int id;
+	if (!_free.empty()) {
+		id = _free.back();
+		_free.pop_back();
+	} else {
+		if (_size == MAX_CHUNKS * CHUNK_SIZE) {
+			throw std::runtime_error("String pool is full");
+		}
+		id = _size++;
+		if ((id & (CHUNK_SIZE - 1)) == 0) {
+			_chunks[id >> CHUNK_BITS].store(new Entry[CHUNK_SIZE], std::memory_order_release);
 		}
 	}
-	return tmp_arcs;
+	Entry & new_entry = entry(id);
+	new_entry.str.assign(str.data(), str.size());
+	new_entry.refs.store(0, std::memory_order_relaxed);
+	new_entry.pinned = false;
+	new_entry.live = true;
+	_ids[new_entry.str] = id;
+	return id;
+}
+
+// Return the id of the given string, kept in the pool for good (names and types)
+int StringPool :: intern (std::string_view str)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		std::unordered_map<std::string_view, int>::const_iterator it = _ids.find(str);
+		if (it != _ids.end() && entry(it->second).pinned) {
+			return it->second;
+		}
+	}
+	std::unique_lock<std::shared_mutex> lock(_mutex);
+	std::unordered_map<std::string_view, int>::const_iterator it = _ids.find(str);
+	int id = it != _ids.end() ? it->second : add(str);
+	entry(id).pinned = true;
+	return id;
+}
+
+// Return the id of the given value with a reference on it (give it back with release)
+int StringPool :: acquire (std::string_view str)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		std::unordered_map<std::string_view, int>::const_iterator it = _ids.find(str);
+		if (it != _ids.end()) {
+			// The string cannot be freed while the lock is shared
+			retain(it->second);
+			return it->second;
+		}
+	}
+	std::unique_lock<std::shared_mutex> lock(_mutex);
+	std::unordered_map<std::string_view, int>::const_iterator it = _ids.find(str);
+	int id = it != _ids.end() ? it->second : add(str);
+	retain(id);
+	return id;
 }
 
-// Return the set of nodes at the end of arcs of the given type
-std::set<Node *> Node :: getNodeFromArcOfType (std::string type)
+// Drop a reference on a value, the last one frees it (unless it is also a name or a type)
+void StringPool :: release (int id)
 {
-	std::set<Node *> out_node;
-	for (std::set<Arc *>::iterator it = _arcs.begin(); it != _arcs.end(); it++){
-		if ((*it)->type().compare(type) == 0){
-			if ((*it)->fromNode() == this) {
-				out_node.insert((*it)->toNode());
-			} else {
-				out_node.insert((*it)->fromNode());
-			}
-		}
+	Entry & released = entry(id);
+	if (released.refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		return;
 	}
-	return out_node;
+	std::unique_lock<std::shared_mutex> lock(_mutex);
+	// Acquired again, or already freed by another release, since the count was dropped
+	if (!released.live || released.pinned || released.refs.load(std::memory_order_relaxed) != 0) {
+		return;
+	}
+	_ids.erase(std::string_view(released.str));
+	std::string().swap(released.str);
+	released.live = false;
+	_free.push_back(id);
 }
 
+// Return the id of the given string or -1 if it is not in the pool
+int StringPool :: lookup (std::string_view str) const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	std::unordered_map<std::string_view, int>::const_iterator it = _ids.find(str);
+	if (it == _ids.end()) {
+		return -1;
+	}
+	return it->second;
+}
 
-// Check the existence of an arc of the given type
-bool Node :: hasArcOfType (std::string type)
+// Return the number of strings in the pool
+int StringPool :: size () const
 {
-	for (std::set<Arc *>::iterator it = _arcs.begin(); it != _arcs.end(); it++)
-		if ((*it)->type().compare(type) == 0)
-			return true;
-	return false;
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	return _size - (int) _free.size();
 }
 
-// Check the existence of an arc of the given type from the current node to the given node
-bool Node :: hasArcOfTypeToNode (std::string type, Node * node)
+// Return the estimated bytes used by the pool
+size_t StringPool :: memoryUsage () const
 {
-	for (std::set<Arc *>::iterator it = _arcs.begin(); it != _arcs.end(); it++){
-		if ((*it)->type().compare(type) == 0){
-			if ((*it)->toNode() == node || (*it)->fromNode() == node) {
-				return true;
-			}
-		}
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	size_t nb_chunks = (_size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	size_t bytes = MAX_CHUNKS * sizeof(std::atomic<Entry *>) + nb_chunks * CHUNK_SIZE * sizeof(Entry) + _free.capacity() * sizeof(int);
+	for (int id = 0; id < _size; id++) {
+		bytes += stringBytes(entry(id).str);
 	}
-	return false;
+	bytes += _ids.size() * hashNodeBytes<std::pair<const std::string_view, int> >(true) + _ids.bucket_count() * sizeof(void *);
+	return bytes;
 }
 
-// Check the existence of the given property with the given value
-bool Node :: hasProp (const std::string & prop_name, const std::string & prop_value)
+// Return the pool shared by all nodes and arcs (never destroyed: a static GraphDb may outlive it)
+StringPool & StringPool :: instance ()
+{
+	static StringPool * pool = new StringPool();
+	return *pool;
+}
+
+/*******************************************************************************
+ * Typed values methods
+ *******************************************************************************/
+
+// Return the name of the given property type
+const char * tinygraphdb::propTypeName (PropType type)
 {
-	if (_properties.find(prop_name) != _properties.end()) {
-		return _properties[prop_name].find(prop_value) != _properties[prop_name].end();
+	switch (type) {
+		case PROP_INT: return "int";
+		case PROP_DOUBLE: return "double";
+		case PROP_BOOL: return "bool";
+		default: return "string";
 	}
-	return false;
 }
 
-// Check the existence of the given property (does not check the value)
-bool Node :: hasProp (const std::string & prop_name)
+// Return the property type of the given name (throw an exception if it is unknown)
+PropType tinygraphdb::propTypeFromName (const std::string & name)
 {
-	return _properties.find(prop_name) != _properties.end();
+	if (name.compare("string") == 0) return PROP_STRING;
+	if (name.compare("int") == 0) return PROP_INT;
+	if (name.compare("double") == 0) return PROP_DOUBLE;
+	if (name.compare("bool") == 0) return PROP_BOOL;
+	std::stringstream error_message;
+	error_message << "Unknown property type \'" << name << "\'";
+	throw std::runtime_error(error_message.str());
 }
 
-// Print the node on the stdout
-void Node :: print()
+// Parse a value of the given type (throw an exception if the text does not match the type)
+PropValue PropValue :: parse (PropType type, std::string_view text)
 {
-	std::cout << _type << "\t" << _unique_id;
-	for (std::map<std::string, std::set<std::string> >::iterator it_name = _properties.begin(); it_name != _properties.end(); it_name++) {
-		for (std::set<std::string>::iterator it_value = it_name->second.begin(); it_value != it_name->second.end(); it_value++) {
-			std::cout << "\t" << it_name->first << "\t" << *it_value;
+	const char * beg = text.data();
+	const char * end = text.data() + text.size();
+	if (type == PROP_INT) {
+		long long value;
+		std::from_chars_result res = std::from_chars(beg, end, value);
+		if (!text.empty() && res.ec == std::errc() && res.ptr == end) {
+			return PropValue(value);
+		}
+	} else if (type == PROP_DOUBLE) {
+		double value;
+		std::from_chars_result res = std::from_chars(beg, end, value);
+		if (!text.empty() && res.ec == std::errc() && res.ptr == end) {
+			return PropValue(value);
+		}
+	} else if (type == PROP_BOOL) {
+		if (text.compare("true") == 0 || text.compare("1") == 0) {
+			return PropValue(true);
+		}
+		if (text.compare("false") == 0 || text.compare("0") == 0) {
+			return PropValue(false);
 		}
 	}
-	std::cout << "\n";
+	std::stringstream error_message;
+	error_message << "Value \'" << text << "\' is not of type " << propTypeName(type);
+	throw std::runtime_error(error_message.str());
 }
 
-// Print the node on the given stream
-void Node ::  print(std::ofstream & outfile)
+// Return the value as text (shortest text giving back the same value)
+std::string PropValue :: text () const
 {
-	outfile << _type << "\t" << _unique_id;
-	for (std::map<std::string, std::set<std::string> >::iterator it_name = _properties.begin(); it_name != _properties.end(); it_name++) {
-		for (std::set<std::string>::iterator it_value = it_name->second.begin(); it_value != it_name->second.end(); it_value++) {
-			outfile << "\t" << it_name->first << "\t" << *it_value;
-		}
+	if (_type == PROP_BOOL) {
+		return _int ? "true" : "false";
 	}
-	outfile << "\n";
+	char buffer[32];
+	std::to_chars_result res = _type == PROP_DOUBLE ? std::to_chars(buffer, buffer + sizeof(buffer), _double) : std::to_chars(buffer, buffer + sizeof(buffer), _int);
+	return std::string(buffer, res.ptr);
 }
 
+// Compare two values (numeric values of different types are compared as doubles)
+bool PropValue :: operator== (const PropValue & other) const
+{
+	if (isNumeric() && other.isNumeric() && _type != other._type) {
+		return asDouble() == other.asDouble();
+	}
+	if (_type != other._type) {
+		return false;
+	}
+	return _type == PROP_DOUBLE ? _double == other._double : _int == other._int;
+}
 
-/*******************************************************************************
- * Arc methods
- *******************************************************************************/
+// Build an entry holding an interned string
+PropEntry PropEntry :: make (int name, int str)
+{
+	PropEntry entry;
+	entry.name = name;
+	entry.type = PROP_STRING;
+	entry.value.integer = 0;
+	entry.value.str = str;
+	return entry;
+}
 
-// Return the unique id of the arc
-const std::string & Arc :: unique_id () const
+// Build an entry holding a typed value
+PropEntry PropEntry :: make (int name, const PropValue & value)
 {
-	return _unique_id;
+	PropEntry entry;
+	entry.name = name;
+	entry.type = value.type();
+	if (value.type() == PROP_DOUBLE) {
+		entry.value.real = value.asDouble();
+	} else {
+		entry.value.integer = value.asInt();
+	}
+	return entry;
 }
 
-// Return the type of the arc
-const std::string & Arc :: type () const
+// Return the typed value of the entry (throw an exception for strings)
+PropValue PropEntry :: typed () const
 {
-	return _type;
+	switch (type) {
+		case PROP_INT: return PropValue(value.integer);
+		case PROP_DOUBLE: return PropValue(value.real);
+		case PROP_BOOL: return PropValue(value.integer != 0);
+		default: break;
+	}
+	std::stringstream error_message;
+	error_message << "Property \'" << StringPool::instance().str(name) << "\' is a string";
+	throw std::runtime_error(error_message.str());
 }
 
-// Return the value of the given property (throw an exception if it does not exist)
-const std::set<std::string> & Arc :: property (const std::string & property) const
+// Return the value of the entry as text
+std::string PropEntry :: text () const
 {
-	if (_properties.find(property) == _properties.end()) {
-		std::stringstream error_message;
-		error_message << "Property \"" << property << "\" not found in node << " << unique_id() << "\n";
-		throw std::runtime_error(error_message.str());
+	if (type == PROP_STRING) {
+		return StringPool::instance().str(value.str);
 	}
-	return _properties.find(property)->second;
+	return typed().text();
 }
 
-// Return all the properties of the arc
-const std::map<std::string, std::set<std::string> > & Arc :: properties () const
+bool PropEntry :: operator< (const PropEntry & other) const
 {
-	return _properties;
+	if (name != other.name) return name < other.name;
+	if (type != other.type) return type < other.type;
+	switch (type) {
+		case PROP_STRING: return value.str < other.value.str;
+		case PROP_DOUBLE: return value.real < other.value.real;
+		default: return value.integer < other.value.integer;
+	}
 }
 
-// Return the input node
-Node * Arc :: fromNode ()
+bool PropEntry :: operator== (const PropEntry & other) const
 {
-	return _from_node;
+	if (name != other.name || type != other.type) return false;
+	switch (type) {
+		case PROP_STRING: return value.str == other.value.str;
+		case PROP_DOUBLE: return value.real == other.value.real;
+		default: return value.integer == other.value.integer;
+	}
 }
 
-// Return the ouput node
-Node * Arc :: toNode ()
+// Order entries by name only
+static bool entry_name_less (const PropEntry & entry, int name)
 {
-	return _to_node;
+	return entry.name < name;
 }
 
-// Print the arc on stdout
-void Arc :: print ()
+// Take a reference on the string values of the given entries
+static void retainValues (const PropEntry * begin, const PropEntry * end)
 {
-	std::cout << _from_node->unique_id() << "\t" << _type << "\t" << _to_node->unique_id();
-	for (std::map<std::string, std::set<std::string> >::iterator it_name = _properties.begin(); it_name != _properties.end(); it_name++) {
-		for (std::set<std::string>::iterator it_value = it_name->second.begin(); it_value != it_name->second.end(); it_value++) {
-			std::cout << "\t" << it_name->first << "\t" << *it_value;
+	for (const PropEntry * it = begin; it != end; it++) {
+		if (it->type == PROP_STRING) {
+			StringPool::instance().retain(it->value.str);
 		}
 	}
-	std::cout << "\n";
 }
 
-// Print the arc on the given stream
-void Arc :: print (std::ofstream & outfile)
+// Drop the references on the string values of the given entries
+static void releaseValues (const PropEntry * begin, const PropEntry * end)
 {
-	outfile << _from_node->unique_id() << "\t" << _type << "\t" << _to_node->unique_id();
-	for (std::map<std::string, std::set<std::string> >::iterator it_name = _properties.begin(); it_name != _properties.end(); it_name++) {
-		for (std::set<std::string>::iterator it_value = it_name->second.begin(); it_value != it_name->second.end(); it_value++) {
-			outfile << "\t" << it_name->first << "\t" << *it_value;
+	for (const PropEntry * it = begin; it != end; it++) {
+		if (it->type == PROP_STRING) {
+			StringPool::instance().release(it->value.str);
 		}
 	}
-	outfile << "\n";
 }
 
-
 /*******************************************************************************
- * Policy methods
+ * Property methods
  *******************************************************************************/
 
-// Add a node type to the policy
-void Policy :: addNodeType (std::string type)
+// Insert a string value in a list, which keeps its own reference (return false if it already exists)
+static bool insertString (PropertyList & list, int name, std::string_view value)
 {
-	_node_type.insert(type);
+	StringPool & pool = StringPool::instance();
+	int value_id = pool.acquire(value);
+	bool inserted = list.insert(PropEntry::make(name, value_id));
+	pool.release(value_id);
+	return inserted;
 }
 
-// Add an arc type to the policy
-void Policy :: addArcType  (std::string type)
+// Count the occurrences of the given value (0 or 1)
+size_t PropertyValues :: count (std::string_view value) const
 {
-	_arc_type.insert(type);
+	int value_id = StringPool::instance().lookup(value);
+	for (const PropEntry * it = _begin; it != _end; it++) {
+		if (it->type == PROP_STRING ? it->value.str == value_id : it->text().compare(value) == 0) {
+			return 1;
+		}
+	}
+	return 0;
 }
 
-// Add a constraint to the policy (node->arc->node)
-void Policy :: addConstraint (std::string from_type, std::string arc_link, std::string to_type)
+// Count the occurrences of the given typed value (0 or 1)
+size_t PropertyValues :: count (const PropValue & value) const
 {
-	if (! isArcType(arc_link))
-		_arc_type.insert(arc_link);
-	if (! isNodeType(from_type))
-		_node_type.insert(from_type);
-	if (! isNodeType(to_type))
-		_node_type.insert(to_type);
-	
-	// Check if the constraint already exists
-	for (int i = 0; i < _from_type.size(); i++)
-		if (from_type.compare(_from_type[i]) == 0 && to_type.compare(_to_type[i]) == 0 && arc_link.compare(_arc_link[i]) == 0)
-			return;
-	
-	_from_type.push_back(from_type);
-	_arc_link.push_back(arc_link);
-	_to_type.push_back(to_type);
+	for (const PropEntry * it = _begin; it != _end; it++) {
+		if (it->type != PROP_STRING && it->typed() == value) {
+			return 1;
+		}
+	}
+	return 0;
 }
 
-// Return the list of node types
-const std::set<std::string> & Policy :: getNodeType () const
+// Return the type of the first value
+PropType PropertyValues :: type () const
 {
-	return _node_type;
+	if (empty()) {
+		throw std::runtime_error("Empty property has no type");
+	}
+	return (PropType) _begin->type;
 }
 
-// Return the list of arc types
-const std::set<std::string> & Policy :: getArcType () const
+// Return the first value as an integer (throw an exception if it is not numeric)
+long long PropertyValues :: asInt () const
 {
-	return _arc_type;
+	if (type() != PROP_INT && type() != PROP_DOUBLE) {
+		throw std::runtime_error("Property value is not numeric");
+	}
+	return _begin->typed().asInt();
 }
 
-// Return the list of from_node types
-const std::vector<std::string> & Policy :: getFromType () const
+// Return the first value as a double (throw an exception if it is not numeric)
+double PropertyValues :: asDouble () const
 {
-	return _from_type;
+	if (type() != PROP_INT && type() != PROP_DOUBLE) {
+		throw std::runtime_error("Property value is not numeric");
+	}
+	return _begin->typed().asDouble();
 }
 
-// Return the list of to_node types
-const std::vector<std::string> & Policy :: getToType () const
+// Return the first value as a boolean (throw an exception if it is not a boolean)
+bool PropertyValues :: asBool () const
 {
-	return _to_type;
+	if (type() != PROP_BOOL) {
+		throw std::runtime_error("Property value is not a boolean");
+	}
+	return _begin->typed().asBool();
 }
 
-// Return the list of arc_link types
-const std::vector<std::string> & Policy :: getLinkType () const
+// Build a sorted list from a map of properties, declared types are parsed
+PropertyList :: PropertyList (const std::map<std::string, std::set<std::string> > & properties, const PropTypeMap * types): _data(_inline), _size(0), _capacity(INLINE_SIZE)
 {
-	return _arc_link;
+	PropertyPairs pairs;
+	for (std::map<std::string, std::set<std::string> >::const_iterator it_name = properties.begin(); it_name != properties.end(); it_name++) {
+		for (std::set<std::string>::const_iterator it_value = it_name->second.begin(); it_value != it_name->second.end(); it_value++) {
+			pairs.push_back(std::make_pair(std::string_view(it_name->first), std::string_view(*it_value)));
+		}
+	}
+	*this = PropertyList(pairs, types);
 }
 
-// Check the existence of the given node type
-bool Policy :: isNodeType (std::string type)
+// Build a sorted list from (name, value) pairs, declared types are parsed
+PropertyList :: PropertyList (const PropertyPairs & properties, const PropTypeMap * types): _data(_inline), _size(0), _capacity(INLINE_SIZE)
 {
-	return _node_type.find(type) != _node_type.end();
+	StringPool & pool = StringPool::instance();
+	reserve((unsigned) properties.size());
+	for (PropertyPairs::const_iterator it = properties.begin(); it != properties.end(); it++) {
+		PropType type = PROP_STRING;
+		if (types != NULL) {
+			PropTypeMap::const_iterator it_type = types->find(it->first);
+			if (it_type != types->end()) {
+				type = it_type->second;
+			}
+		}
+		int name = pool.intern(it->first);
+		if (type == PROP_STRING) {
+			_data[_size] = PropEntry::make(name, pool.acquire(it->second));
+		} else {
+			try {
+				_data[_size] = PropEntry::make(name, PropValue::parse(type, it->second));
+			} catch (...) {
+				// The destructor is not called when the constructor throws
+				releaseValues(_data, _data + _size);
+				if (_data != _inline) {
+					delete [] _data;
+				}
+				throw;
+			}
+		}
+		_size++;
+	}
+	dedupe();
 }
 
-// Check the existence of the given arc type
-bool Policy :: isArcType (std::string type)
+PropertyList :: PropertyList (const PropertyList & other): _data(_inline), _size(0), _capacity(INLINE_SIZE)
 {
-	return _arc_type.find(type) != _arc_type.end();
+	reserve(other._size);
+	std::copy(other._data, other._data + other._size, _data);
+	_size = other._size;
+	retainValues(_data, _data + _size);
 }
 
-// Check the validity of a link (node->arc->node)
-bool Policy :: isValid (std::string from_type, std::string arc_link, std::string to_type)
+PropertyList :: PropertyList (PropertyList && other): _data(_inline), _size(0), _capacity(INLINE_SIZE)
 {
-	for (int i = 0; i < _from_type.size(); i++)
-		if (from_type.compare(_from_type[i]) == 0 && to_type.compare(_to_type[i]) == 0 && arc_link.compare(_arc_link[i]) == 0)
-			return true;
-	return false;
+	*this = std::move(other);
 }
 
-// Print the policy on stdout
-void Policy :: print ()
+PropertyList & PropertyList :: operator= (const PropertyList & other)
 {
-	std::cout << "Policy\n";
-	for (std::set<std::string>::iterator it = _node_type.begin(); it != _node_type.end(); it++) {
-		for (int i = 0; i < _from_type.size(); i++) {
-			if ((*it).compare(_from_type[i]) == 0) {
-			std::cout << _from_type[i] << "-\t" << _arc_link[i] << "\t" << _to_type[i] << "\n";
-			}
-		}
+	if (this != &other) {
+		releaseValues(_data, _data + _size);
+		_size = 0;
+		reserve(other._size);
+		std::copy(other._data, other._data + other._size, _data);
+		_size = other._size;
+		retainValues(_data, _data + _size);
 	}
+	return *this;
 }
 
-// Print the policy on the given stream
-void Policy :: print (std::ofstream & outfile)
+PropertyList & PropertyList :: operator= (PropertyList && other)
 {
-	outfile << "Policy\n";
-	for (std::set<std::string>::iterator it = _node_type.begin(); it != _node_type.end(); it++) {
-		for (int i = 0; i < _from_type.size(); i++) {
-			if ((*it).compare(_from_type[i]) == 0) {
-				outfile << _from_type[i] << "\t" << _arc_link[i] << "\t" << _to_type[i] << "\n";
-			}
+	if (this == &other) {
+		return *this;
+	}
+	releaseValues(_data, _data + _size);
+	if (other._data == other._inline) {
+		std::copy(other._data, other._data + other._size, _inline);
+		if (_data != _inline) {
+			delete [] _data;
+		}
+		_data = _inline;
+		_capacity = INLINE_SIZE;
+	} else {
+		if (_data != _inline) {
+			delete [] _data;
 		}
+		_data = other._data;
+		_capacity = other._capacity;
+		other._data = other._inline;
+		other._capacity = INLINE_SIZE;
 	}
+	_size = other._size;
+	other._size = 0;
+	return *this;
 }
 
-// Read the policy from the given stream
-void Policy :: read (std::string fname)
+PropertyList :: ~PropertyList ()
 {
-	std::string line;
-	std::ifstream infile;
-	infile.open (fname.c_str());
-	if (!infile.good()) {
-		std::cerr << "Cannot open file " << fname << "\n";
-		exit(1);
-	}
-	// Find the Policy keyword to read the policies //
-	getline(infile, line);
-	rem_spaces(line);
-	while(infile.good() && line.compare("Policy") != 0) {
-		getline(infile, line);
-		rem_spaces(line);
-	}
-	while(infile.good()) {
-		getline(infile, line);
-		int pos = (int) line.find("#");
-		if (pos >= 0 && pos < line.size()) {
-			line = line.substr(0, pos);
-		}
-		rem_spaces(line);
-		if (!line.empty()) {
-			if (line.compare("Nodes") == 0 || line.compare("Relations") == 0) {
-				break;
-			}
-			std::vector<std::string> line_element = chomp_line(line, '\t');
-			if (line_element.size() < 3) {
-				std::cerr << "A policy constraint contains 3 types: node_type, arc_type, node_type -> ignore " << line << "\n";
-			}
-			std::string from_type = line_element[0];
-			rem_spaces(from_type);
-			std::string arc_type = line_element[1];
-			rem_spaces(arc_type);
-			std::string to_type = line_element[2];
-			rem_spaces(to_type);
-			
-			addConstraint (from_type, arc_type, to_type);
-		}
+	releaseValues(_data, _data + _size);
+	if (_data != _inline) {
+		delete [] _data;
 	}
-	infile.close();
 }
 
-/*******************************************************************************
- * GraphDb methods
- *******************************************************************************/
-
-// Read a node from a string : (type)unique_id{prop_name="prop_value",prop_name="prop_value",...}
-void GraphDb :: readNode (std::string line)
+// Sort the entries and drop the duplicates (and their references)
+void PropertyList :: dedupe ()
 {
-	try {
-		std::vector<std::string> line_element = chomp_line(line, '\t');
-		if (line_element.size() < 2) {
-			std::stringstream error_message;
-			error_message << "A node needs at least a type (string) and a unique identifier (int)";
-			throw std::runtime_error(error_message.str());
-		}
-		
-		// Read node type and unique id
-		std::vector<std::string>::iterator it = line_element.begin();
-		std::string node_type = *it;
-		rem_spaces(node_type);
-		it++;
-		int node_id = atoi((*it).c_str());
-		it++;
-		// read node properties
-		std::map<std::string, std::set<std::string> > node_properties;
-		for (; it != line_element.end(); it++) {
-			std::string prop_name = *it;
-			rem_spaces(prop_name);
-			it++;
-			if (it == line_element.end()) {
-				std::stringstream error_message;
-				error_message << "Cannot find property value in \'" << line << "\'";
-				throw std::runtime_error(error_message.str());
-			}
-			std::string prop_value = *it;
-			rem_spaces(prop_value);
-			node_properties[prop_name].insert(prop_value);
+	std::sort(_data, _data + _size);
+	unsigned kept = 0;
+	for (unsigned i = 0; i < _size; i++) {
+		if (kept > 0 && _data[kept - 1] == _data[i]) {
+			releaseValues(_data + i, _data + i + 1);
+		} else {
+			_data[kept++] = _data[i];
 		}
-		
-		// create the node
-		newNodeWithId(node_id, node_type, node_properties);
-		
-	} catch (std::exception & e) {
-		throw;
 	}
+	_size = kept;
 }
 
-// Read an arc from a string : id->[type{prop="value",...}]->id
-void GraphDb :: readArc (std::string line)
+// Make room for the given number of entries
+void PropertyList :: reserve (unsigned capacity)
 {
-	try {
+	if (capacity <= _capacity) {
+		return;
+	}
+	PropEntry * data = new PropEntry[capacity];
+	std::copy(_data, _data + _size, data);
+	if (_data != _inline) {
+		delete [] _data;
+	}
+	_data = data;
+	_capacity = capacity;
+}
+
+// Release the unused capacity (entries go back inline when they fit)
+void PropertyList :: shrink ()
+{
+	if (_data == _inline || _size == _capacity) {
+		return;
+	}
+	PropEntry * data = _size <= INLINE_SIZE ? _inline : new PropEntry[_size];
+	std::copy(_data, _data + _size, data);
+	delete [] _data;
+	_data = data;
+	_capacity = _size <= INLINE_SIZE ? INLINE_SIZE : _size;
+}
+
+// Insert an entry at its sorted position, its string value is retained (return false if it already exists)
+bool PropertyList :: insert (const PropEntry & entry)
+{
+	PropEntry * pos = std::lower_bound(_data, _data + _size, entry);
+	if (pos != _data + _size && *pos == entry) {
+		return false;
+	}
+	unsigned index = (unsigned) (pos - _data);
+	if (_size == _capacity) {
+		reserve(2 * _capacity);
+	}
+	std::copy_backward(_data + index, _data + _size, _data + _size + 1);
+	_data[index] = entry;
+	_size++;
+	retainValues(&entry, &entry + 1);
+	return true;
+}
+
+// Erase all the entries of the given name
+void PropertyList :: erase (int name)
+{
+	PropEntry * beg = std::lower_bound(_data, _data + _size, name, entry_name_less);
+	PropEntry * end = beg;
+	while (end != _data + _size && end->name == name) {
+		end++;
+	}
+	releaseValues(beg, end);
+	std::copy(end, _data + _size, beg);
+	_size -= (unsigned) (end - beg);
+}
+
+// Erase the given entry
+void PropertyList :: erase (const PropEntry & entry)
+{
+	PropEntry * pos = std::lower_bound(_data, _data + _size, entry);
+	if (pos != _data + _size && *pos == entry) {
+		releaseValues(pos, pos + 1);
+		std::copy(pos + 1, _data + _size, pos);
+		_size--;
+	}
+}
+
+// Return the values of the given property name (binary search)
+PropertyValues PropertyList :: values (int name) const
+{
+	const PropEntry * beg = std::lower_bound(_data, _data + _size, name, entry_name_less);
+	const PropEntry * end = beg;
+	while (end != _data + _size && end->name == name) {
+		end++;
+	}
+	return PropertyValues(beg, end);
+}
+
+// Check the existence of an entry with the given name
+bool PropertyList :: contains (int name) const
+{
+	const PropEntry * pos = std::lower_bound(_data, _data + _size, name, entry_name_less);
+	return pos != _data + _size && pos->name == name;
+}
+
+// Check the existence of the given entry
+bool PropertyList :: contains (const PropEntry & entry) const
+{
+	return std::binary_search(_data, _data + _size, entry);
+}
+
+// Convert the entries which are not of the declared type of their property (as their text)
+void PropertyList :: conform (const PropTypeMap * types)
+{
+	StringPool & pool = StringPool::instance();
+	bool changed = false;
+	for (unsigned i = 0; i < _size; i++) {
+		PropType type = PROP_STRING;
+		if (types != NULL) {
+			PropTypeMap::const_iterator it_type = types->find(pool.str(_data[i].name));
+			if (it_type != types->end()) {
+				type = it_type->second;
+			}
+		}
+		if (_data[i].type == type) {
+			continue;
+		}
+		std::string text = _data[i].text();
+		if (type == PROP_STRING) {
+			_data[i] = PropEntry::make(_data[i].name, pool.acquire(text));
+		} else {
+			PropEntry converted = PropEntry::make(_data[i].name, PropValue::parse(type, text));
+			releaseValues(_data + i, _data + i + 1);
+			_data[i] = converted;
+		}
+		changed = true;
+	}
+	if (changed) {
+		dedupe();
+	}
+}
+
+// Return the values of the given property name
+PropertyValues PropertyView :: find (std::string_view name) const
+{
+	int name_id = StringPool::instance().lookup(name);
+	if (name_id < 0) {
+		return PropertyValues();
+	}
+	return _list->values(name_id);
+}
+
+// Copy the properties in a map
+PropertyView :: operator std::map<std::string, std::set<std::string> > () const
+{
+	std::map<std::string, std::set<std::string> > properties;
+	for (const_iterator it = begin(); it != end(); it++) {
+		properties[it.name()].insert(it.value());
+	}
+	return properties;
+}
+
+/*******************************************************************************
+ * Node methods
+ *******************************************************************************/
+
+// Return the unique id of the node
+const int & Node :: unique_id () const
+{
+	return _unique_id;
+}
+
+// Return the node type
+const std::string & Node :: type () const
+{
+	return StringPool::instance().str(_type);
+}
+
+// Return the values of the given property  (throw an exception if it does not exist)
+PropertyValues Node :: property (std::string_view property) const
+{
+	PropertyValues values = properties().find(property);
+	if (values.empty()) {
+		std::stringstream error_message;
+		error_message << "Property \"" << property << "\" not found in node << " << unique_id() << "\n";
+		throw std::runtime_error(error_message.str());
+	}
+	return values;
+};
+
+// Return all the properties of the node
+PropertyView Node :: properties () const
+{
+	return PropertyView(_properties);
+}
+
+// Add a value to the given property
+void Node :: addProperty (const std::string & property, const std::string & value)
+{
+	insertString(_properties, StringPool::instance().intern(property), value);
+}
+
+// Add a typed value to the given property
+void Node :: addProperty (const std::string & property, const PropValue & value)
+{
+	_properties.insert(PropEntry::make(StringPool::instance().intern(property), value));
+}
+
+// Erase all the values of the given property
+void Node :: eraseProperty (const std::string & property)
+{
+	int name = StringPool::instance().lookup(property);
+	if (name >= 0) {
+		_properties.erase(name);
+	}
+}
+
+// Erase a value of the given property
+void Node :: eraseProperty (const std::string & property, const std::string & value)
+{
+	StringPool & pool = StringPool::instance();
+	int name = pool.lookup(property);
+	int value_id = pool.lookup(value);
+	if (name >= 0 && value_id >= 0) {
+		_properties.erase(PropEntry::make(name, value_id));
+	}
+}
+
+// Erase a typed value of the given property
+void Node :: eraseProperty (const std::string & property, const PropValue & value)
+{
+	int name = StringPool::instance().lookup(property);
+	if (name >= 0) {
+		_properties.erase(PropEntry::make(name, value));
+	}
+}
+
+// Erase a given arc in
+void Node::eraseArc	(const std::string & arc_id)
+{
+	for (std::set<Arc *>::iterator it = _arcs.begin(); it != _arcs.end(); it++) {
+		if ((*it)->unique_id().compare(arc_id) == 0) {
+			_arcs.erase(it);
+			return;
+		}
+	}
+}
+
+
+// Return the set of input arcs of the given type
+std::set<Arc *> Node :: getArcOfType(std::string_view type)
+{
+	std::set<Arc *> tmp_arcs;
+	int type_id = StringPool::instance().lookup(type);
+	for (std::set<Arc *>::iterator it = _arcs.begin(); it != _arcs.end(); it++) {
+		if ((*it)->typeId() == type_id){
+			tmp_arcs.insert((*it));
+		}
+	}
+	return tmp_arcs;
+}
+
+// Return the set of nodes at the end of arcs of the given type
+std::set<Node *> Node :: getNodeFromArcOfType (std::string_view type)
+{
+	std::set<Node *> out_node;
+	int type_id = StringPool::instance().lookup(type);
+	for (std::set<Arc *>::iterator it = _arcs.begin(); it != _arcs.end(); it++){
+		if ((*it)->typeId() == type_id){
+			if ((*it)->fromNode() == this) {
+				out_node.insert((*it)->toNode());
+			} else {
+				out_node.insert((*it)->fromNode());
+			}
+		}
+	}
+	return out_node;
+}
+
+
+// Check the existence of an arc of the given type
+bool Node :: hasArcOfType (std::string_view type)
+{
+	int type_id = StringPool::instance().lookup(type);
+	for (std::set<Arc *>::iterator it = _arcs.begin(); it != _arcs.end(); it++)
+		if ((*it)->typeId() == type_id)
+			return true;
+	return false;
+}
+
+// Check the existence of an arc of the given type from the current node to the given node
+bool Node :: hasArcOfTypeToNode (std::string_view type, Node * node)
+{
+	int type_id = StringPool::instance().lookup(type);
+	for (std::set<Arc *>::iterator it = _arcs.begin(); it != _arcs.end(); it++){
+		if ((*it)->typeId() == type_id){
+			if ((*it)->toNode() == node || (*it)->fromNode() == node) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Check the existence of the given property with the given value
+bool Node :: hasProp (std::string_view prop_name, std::string_view prop_value) const
+{
+	return properties().find(prop_name).count(prop_value) > 0;
+}
+
+// Check the existence of the given property (does not check the value)
+bool Node :: hasProp (std::string_view prop_name) const
+{
+	int name = StringPool::instance().lookup(prop_name);
+	return name >= 0 && _properties.contains(name);
+}
+
+// Print the node on the stdout
+void Node :: print()
+{
+	std::cout << type() << "\t" << _unique_id;
+	for (PropertyView::const_iterator it = properties().begin(); it != properties().end(); it++) {
+		std::cout << "\t" << it.name() << "\t" << it.value();
+	}
+	std::cout << "\n";
+}
+
+// Print the node on the given stream
+void Node ::  print(std::ostream & outfile)
+{
+	outfile << type() << "\t" << _unique_id;
+	for (PropertyView::const_iterator it = properties().begin(); it != properties().end(); it++) {
+		outfile << "\t" << it.name() << "\t" << it.value();
+	}
+	outfile << "\n";
+}
+
+
+/*******************************************************************************
+ * Arc methods
+ *******************************************************************************/
+
+// Return the unique id of the arc
+const std::string & Arc :: unique_id () const
+{
+	return *_unique_id;
+}
+
+// Return the type of the arc
+const std::string & Arc :: type () const
+{
+	return StringPool::instance().str(_type);
+}
+
+// Return the values of the given property (throw an exception if it does not exist)
+PropertyValues Arc :: property (std::string_view property) const
+{
+	PropertyValues values = properties().find(property);
+	if (values.empty()) {
+		std::stringstream error_message;
+		error_message << "Property \"" << property << "\" not found in node << " << unique_id() << "\n";
+		throw std::runtime_error(error_message.str());
+	}
+	return values;
+}
+
+// Return all the properties of the arc
+PropertyView Arc :: properties () const
+{
+	return PropertyView(_properties);
+}
+
+// Add a value to the given property
+void Arc :: addProperty (const std::string & property, const std::string & value)
+{
+	insertString(_properties, StringPool::instance().intern(property), value);
+}
+
+// Add a typed value to the given property
+void Arc :: addProperty (const std::string & property, const PropValue & value)
+{
+	_properties.insert(PropEntry::make(StringPool::instance().intern(property), value));
+}
+
+// Return the input node
+Node * Arc :: fromNode () const
+{
+	return _from_node;
+}
+
+// Return the ouput node
+Node * Arc :: toNode () const
+{
+	return _to_node;
+}
+
+// Print the arc on stdout
+void Arc :: print ()
+{
+	std::cout << _from_node->unique_id() << "\t" << type() << "\t" << _to_node->unique_id();
+	for (PropertyView::const_iterator it = properties().begin(); it != properties().end(); it++) {
+		std::cout << "\t" << it.name() << "\t" << it.value();
+	}
+	std::cout << "\n";
+}
+
+// Print the arc on the given stream
+void Arc :: print (std::ostream & outfile)
+{
+	outfile << _from_node->unique_id() << "\t" << type() << "\t" << _to_node->unique_id();
+	for (PropertyView::const_iterator it = properties().begin(); it != properties().end(); it++) {
+		outfile << "\t" << it.name() << "\t" << it.value();
+	}
+	outfile << "\n";
+}
+
+
+/*******************************************************************************
+ * Policy methods
+ *******************************************************************************/
+
+// Add a node type to the policy
+void Policy :: addNodeType (std::string type)
+{
+	_node_type.insert(type);
+}
+
+// Add an arc type to the policy
+void Policy :: addArcType  (std::string type)
+{
+	_arc_type.insert(type);
+}
+
+// Add a constraint to the policy (node->arc->node)
+void Policy :: addConstraint (std::string from_type, std::string arc_link, std::string to_type)
+{
+	if (! isArcType(arc_link))
+		_arc_type.insert(arc_link);
+	if (! isNodeType(from_type))
+		_node_type.insert(from_type);
+	if (! isNodeType(to_type))
+		_node_type.insert(to_type);
+	
+	// Check if the constraint already exists
+	if (isValid(from_type, arc_link, to_type))
+		return;
+	
+	_valid[from_type][arc_link].insert(to_type);
+	_from_type.push_back(from_type);
+	_arc_link.push_back(arc_link);
+	_to_type.push_back(to_type);
+}
+
+// Declare the value type of a property for the given node or arc type
+void Policy :: addPropertyType (std::string type, std::string prop_name, PropType prop_type)
+{
+	_prop_types[type][prop_name] = prop_type;
+}
+
+// Return the list of node types
+const StringSet & Policy :: getNodeType () const
+{
+	return _node_type;
+}
+
+// Return the list of arc types
+const StringSet & Policy :: getArcType () const
+{
+	return _arc_type;
+}
+
+// Return the list of from_node types
+const std::vector<std::string> & Policy :: getFromType () const
+{
+	return _from_type;
+}
+
+// Return the list of to_node types
+const std::vector<std::string> & Policy :: getToType () const
+{
+	return _to_type;
+}
+
+// Return the list of arc_link types
+const std::vector<std::string> & Policy :: getLinkType () const
+{
+	return _arc_link;
+}
+
+// Return the declared property types of the given node or arc type (NULL if none)
+const PropTypeMap * Policy :: propertyTypes (std::string_view type) const
+{
+	std::map<std::string, PropTypeMap, std::less<> >::const_iterator it = _prop_types.find(type);
+	if (it == _prop_types.end()) {
+		return NULL;
+	}
+	return &it->second;
+}
+
+// Return the declared type of the given property (PROP_STRING if not declared)
+PropType Policy :: propertyType (std::string_view type, std::string_view prop_name) const
+{
+	const PropTypeMap * types = propertyTypes(type);
+	if (types == NULL) {
+		return PROP_STRING;
+	}
+	PropTypeMap::const_iterator it = types->find(prop_name);
+	return it == types->end() ? PROP_STRING : it->second;
+}
+
+// Check the existence of the given node type
+bool Policy :: isNodeType (std::string_view type) const
+{
+	return _node_type.find(type) != _node_type.end();
+}
+
+// Check the existence of the given arc type
+bool Policy :: isArcType (std::string_view type) const
+{
+	return _arc_type.find(type) != _arc_type.end();
+}
+
+// Check the validity of a link (node->arc->node)
+bool Policy :: isValid (std::string_view from_type, std::string_view arc_link, std::string_view to_type) const
+{
+	std::map<std::string, std::map<std::string, StringSet, std::less<> >, std::less<> >::const_iterator it_from = _valid.find(from_type);
+	if (it_from == _valid.end())
+		return false;
+	std::map<std::string, StringSet, std::less<> >::const_iterator it_link = it_from->second.find(arc_link);
+	if (it_link == it_from->second.end())
+		return false;
+	return it_link->second.find(to_type) != it_link->second.end();
+}
+
+// Print the policy on stdout
+void Policy :: print ()
+{
+	std::cout << "Policy\n";
+	for (StringSet::iterator it = _node_type.begin(); it != _node_type.end(); it++) {
+		for (int i = 0; i < _from_type.size(); i++) {
+			if ((*it).compare(_from_type[i]) == 0) {
+			std::cout << _from_type[i] << "-\t" << _arc_link[i] << "\t" << _to_type[i] << "\n";
+			}
+		}
+	}
+	if (!_prop_types.empty()) {
+		std::cout << "\nProperties\n";
+		for (std::map<std::string, PropTypeMap, std::less<> >::iterator it = _prop_types.begin(); it != _prop_types.end(); it++) {
+			for (PropTypeMap::iterator it_prop = it->second.begin(); it_prop != it->second.end(); it_prop++) {
+				std::cout << it->first << "\t" << it_prop->first << "\t" << propTypeName(it_prop->second) << "\n";
+			}
+		}
+	}
+}
+
+// Print the policy on the given stream
+void Policy :: print (std::ostream & outfile)
+{
+	outfile << "Policy\n";
+	for (StringSet::iterator it = _node_type.begin(); it != _node_type.end(); it++) {
+		for (int i = 0; i < _from_type.size(); i++) {
+			if ((*it).compare(_from_type[i]) == 0) {
+				outfile << _from_type[i] << "\t" << _arc_link[i] << "\t" << _to_type[i] << "\n";
+			}
+		}
+	}
+	if (!_prop_types.empty()) {
+		outfile << "\nProperties\n\n";
+		for (std::map<std::string, PropTypeMap, std::less<> >::iterator it = _prop_types.begin(); it != _prop_types.end(); it++) {
+			for (PropTypeMap::iterator it_prop = it->second.begin(); it_prop != it->second.end(); it_prop++) {
+				outfile << it->first << "\t" << it_prop->first << "\t" << propTypeName(it_prop->second) << "\n";
+			}
+		}
+	}
+}
+
+// Read the policy from the given stream
+void Policy :: read (std::string fname)
+{
+	std::string line;
+	InputStream infile(fname);
+	if (!infile.good()) {
+		std::cerr << "Cannot open file " << fname << "\n";
+		exit(1);
+	}
+	// Find the Policy keyword to read the policies //
+	getline(infile, line);
+	rem_spaces(line);
+	while(infile.good() && line.compare("Policy") != 0) {
+		getline(infile, line);
+		rem_spaces(line);
+	}
+	bool in_types = false;
+	while(infile.good()) {
+		getline(infile, line);
+		int pos = (int) line.find("#");
+		if (pos >= 0 && pos < line.size()) {
+			line = line.substr(0, pos);
+		}
+		rem_spaces(line);
+		if (!line.empty()) {
+			if (line.compare("Nodes") == 0 || line.compare("Relations") == 0) {
+				break;
+			}
+			if (line.compare("Properties") == 0) {
+				in_types = true;
+				continue;
+			}
+			std::vector<std::string> line_element = chomp_line(line, '\t');
+			if (line_element.size() < 3) {
+				if (in_types) {
+					std::cerr << "A property declaration contains 3 fields: node_or_arc_type, prop_name, prop_type -> ignore " << line << "\n";
+				} else {
+					std::cerr << "A policy constraint contains 3 types: node_type, arc_type, node_type -> ignore " << line << "\n";
+				}
+				continue;
+			}
+			for (size_t i = 0; i < line_element.size(); i++) {
+				rem_spaces(line_element[i]);
+			}
+			
+			if (in_types) {
+				try {
+					addPropertyType (line_element[0], line_element[1], propTypeFromName(line_element[2]));
+				} catch (std::exception & e) {
+					std::cerr << e.what() << " -> ignore " << line << "\n";
+				}
+			} else {
+				addConstraint (line_element[0], line_element[1], line_element[2]);
+			}
+		}
+	}
+	infile.close();
+}
+
+/*******************************************************************************
+ * MemoryReport methods
+ *******************************************************************************/
+
+// Return the total of the structure bytes
+size_t MemoryReport :: total () const
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < structures.size(); i++) {
+		bytes += structures[i].bytes;
+	}
+	return bytes;
+}
+
+// Export the report as text tables (structures, node types and arc types)
+std::string MemoryReport :: toText () const
+{
+	std::stringstream out;
+	out << "structure\tentries\tbytes\n";
+	for (size_t i = 0; i < structures.size(); i++) {
+		out << structures[i].name << "\t" << structures[i].entries << "\t" << structures[i].bytes << "\n";
+	}
+	out << "total\t\t" << total() << "\n";
+	out << "\nnode_type\tnodes\tbytes\n";
+	for (size_t i = 0; i < node_types.size(); i++) {
+		out << node_types[i].name << "\t" << node_types[i].entries << "\t" << node_types[i].bytes << "\n";
+	}
+	out << "\narc_type\tarcs\tbytes\n";
+	for (size_t i = 0; i < arc_types.size(); i++) {
+		out << arc_types[i].name << "\t" << arc_types[i].entries << "\t" << arc_types[i].bytes << "\n";
+	}
+	return out.str();
+}
+
+// Write a list of usages as a JSON object
+static void writeUsages (std::stringstream & out, const std::vector<MemoryUsage> & usages)
+{
+	out << "{";
+	for (size_t i = 0; i < usages.size(); i++) {
+		out << (i ? ", " : "") << "\"" << usages[i].name << "\": {\"entries\": " << usages[i].entries << ", \"bytes\": " << usages[i].bytes << "}";
+	}
+	out << "}";
+}
+
+// Export the report as a JSON object
+std::string MemoryReport :: toJson () const
+{
+	std::stringstream out;
+	out << "{\"total\": " << total() << ", \"structures\": ";
+	writeUsages(out, structures);
+	out << ", \"node_types\": ";
+	writeUsages(out, node_types);
+	out << ", \"arc_types\": ";
+	writeUsages(out, arc_types);
+	out << "}";
+	return out.str();
+}
+
+/*******************************************************************************
+ * Aggregate views methods
+ *******************************************************************************/
+
+// Compute the view from scratch (replay the addition of every node, property and arc)
+void AggregateView :: build (GraphDb & db)
+{
+	clear();
+	std::set<Node *> nodes = db.allNodes();
+	for (std::set<Node *>::iterator it = nodes.begin(); it != nodes.end(); it++) {
+		nodeAdded(**it);
+		PropertyView properties = (*it)->properties();
+		for (PropertyView::const_iterator it_prop = properties.begin(); it_prop != properties.end(); it_prop++) {
+			propertyAdded(**it, *it_prop);
+		}
+	}
+	std::set<Arc *> arcs = db.allArcs();
+	for (std::set<Arc *>::iterator it = arcs.begin(); it != arcs.end(); it++) {
+		arcAdded(**it);
+	}
+}
+
+// Return the number of nodes of the given type
+long long NodeTypeCountView :: count (std::string_view type) const
+{
+	std::unordered_map<int, long long>::const_iterator it = _counts.find(StringPool::instance().lookup(type));
+	return it == _counts.end() ? 0 : it->second;
+}
+
+// Return the number of nodes of each type
+std::map<std::string, long long> NodeTypeCountView :: counts () const
+{
+	std::map<std::string, long long> counts;
+	for (std::unordered_map<int, long long>::const_iterator it = _counts.begin(); it != _counts.end(); it++) {
+		if (it->second != 0) {
+			counts[StringPool::instance().str(it->first)] = it->second;
+		}
+	}
+	return counts;
+}
+
+void TripleCountView :: arcAdded (const Arc & arc)
+{
+	_counts[Triple(arc.fromNode()->typeId(), arc.typeId(), arc.toNode()->typeId())]++;
+}
+
+void TripleCountView :: arcErased (const Arc & arc)
+{
+	_counts[Triple(arc.fromNode()->typeId(), arc.typeId(), arc.toNode()->typeId())]--;
+}
+
+// Return the number of arcs of the given type between nodes of the given types
+long long TripleCountView :: count (std::string_view from_type, std::string_view arc_type, std::string_view to_type) const
+{
+	StringPool & pool = StringPool::instance();
+	std::map<Triple, long long>::const_iterator it = _counts.find(Triple(pool.lookup(from_type), pool.lookup(arc_type), pool.lookup(to_type)));
+	return it == _counts.end() ? 0 : it->second;
+}
+
+// Move a node from a degree to another one (-1 for none)
+void DegreeHistogramView :: move (int from_degree, int to_degree)
+{
+	if (from_degree >= 0) {
+		_histogram[from_degree]--;
+	}
+	if (to_degree >= 0) {
+		if (to_degree >= (int) _histogram.size()) {
+			_histogram.resize(to_degree + 1, 0);
+		}
+		_histogram[to_degree]++;
+	}
+	while (!_histogram.empty() && _histogram.back() == 0) {
+		_histogram.pop_back();
+	}
+}
+
+// Compute the histogram from the current degrees
+void DegreeHistogramView :: build (GraphDb & db)
+{
+	clear();
+	std::set<Node *> nodes = db.allNodes();
+	for (std::set<Node *>::iterator it = nodes.begin(); it != nodes.end(); it++) {
+		move(-1, (int) (*it)->arcs().size());
+	}
+}
+
+// The arc is already attached to both nodes
+void DegreeHistogramView :: arcAdded (const Arc & arc)
+{
+	int degree = (int) arc.fromNode()->arcs().size();
+	move(degree - 1, degree);
+	if (arc.toNode() != arc.fromNode()) {
+		degree = (int) arc.toNode()->arcs().size();
+		move(degree - 1, degree);
+	}
+}
+
+// The arc is still attached to both nodes
+void DegreeHistogramView :: arcErased (const Arc & arc)
+{
+	int degree = (int) arc.fromNode()->arcs().size();
+	move(degree, degree - 1);
+	if (arc.toNode() != arc.fromNode()) {
+		degree = (int) arc.toNode()->arcs().size();
+		move(degree, degree - 1);
+	}
+}
+
+// Return the key of a value (interned string or bits of the typed value)
+std::pair<int, long long> PropertyValueCountView :: key (const PropEntry & entry)
+{
+	return std::make_pair(entry.type, entry.type == PROP_STRING ? (long long) entry.value.str : entry.value.integer);
+}
+
+void PropertyValueCountView :: propertyAdded (const Node &, const PropEntry & entry)
+{
+	if (entry.name == _name) {
+		_counts[key(entry)]++;
+	}
+}
+
+void PropertyValueCountView :: propertyErased (const Node &, const PropEntry & entry)
+{
+	if (entry.name != _name) {
+		return;
+	}
+	std::map<std::pair<int, long long>, long long>::iterator it = _counts.find(key(entry));
+	if (it != _counts.end() && --it->second == 0) {
+		_counts.erase(it);
+	}
+}
+
+// Return the number of nodes having the given (string) value
+long long PropertyValueCountView :: count (std::string_view value) const
+{
+	int value_id = StringPool::instance().lookup(value);
+	if (value_id < 0) {
+		return 0;
+	}
+	std::map<std::pair<int, long long>, long long>::const_iterator it = _counts.find(key(PropEntry::make(_name, value_id)));
+	return it == _counts.end() ? 0 : it->second;
+}
+
+// Return the number of nodes having the given typed value
+long long PropertyValueCountView :: count (const PropValue & value) const
+{
+	std::map<std::pair<int, long long>, long long>::const_iterator it = _counts.find(key(PropEntry::make(_name, value)));
+	return it == _counts.end() ? 0 : it->second;
+}
+
+// Return the number of nodes having each value (values as text)
+std::map<std::string, long long> PropertyValueCountView :: counts () const
+{
+	std::map<std::string, long long> counts;
+	for (std::map<std::pair<int, long long>, long long>::const_iterator it = _counts.begin(); it != _counts.end(); it++) {
+		PropEntry entry;
+		entry.name = _name;
+		entry.type = it->first.first;
+		if (entry.type == PROP_STRING) {
+			entry.value.str = (int) it->first.second;
+		} else {
+			entry.value.integer = it->first.second;
+		}
+		counts[entry.text()] += it->second;
+	}
+	return counts;
+}
+
+/*******************************************************************************
+ * QueryCache methods
+ *******************************************************************************/
+
+// Set the maximum number of results (0 disables the cache and drops all the results)
+void QueryCache :: setCapacity (size_t capacity)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_capacity.store(capacity, std::memory_order_relaxed);
+	while (_entries.size() > capacity) {
+		_index.erase(_entries.back().key);
+		_entries.pop_back();
+	}
+}
+
+// Return the number of results in the cache
+size_t QueryCache :: size ()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _entries.size();
+}
+
+// Drop all the results
+void QueryCache :: clear ()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_entries.clear();
+	_index.clear();
+}
+
+// Return the result of the given query if it was computed at the given version (NULL otherwise)
+NodeSetPtr QueryCache :: find (const std::string & key, unsigned long long version)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::unordered_map<std::string, std::list<Entry>::iterator>::iterator it = _index.find(key);
+	if (it == _index.end()) {
+		return NodeSetPtr();
+	}
+	if (it->second->version != version) {
+		// Stale result, the data it depends on has changed
+		_entries.erase(it->second);
+		_index.erase(it);
+		return NodeSetPtr();
+	}
+	_entries.splice(_entries.begin(), _entries, it->second);
+	return it->second->result;
+}
+
+// Keep the result of the given query (the least recently used result is dropped when full)
+void QueryCache :: insert (const std::string & key, unsigned long long version, const NodeSetPtr & result)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	size_t capacity = _capacity.load(std::memory_order_relaxed);
+	if (capacity == 0) {
+		return;
+	}
+	std::unordered_map<std::string, std::list<Entry>::iterator>::iterator it = _index.find(key);
+	if (it != _index.end()) {
+		it->second->version = version;
+		it->second->result = result;
+		_entries.splice(_entries.begin(), _entries, it->second);
+		return;
+	}
+	Entry entry;
+	entry.key = key;
+	entry.version = version;
+	entry.result = result;
+	_entries.push_front(entry);
+	_index[key] = _entries.begin();
+	while (_entries.size() > capacity) {
+		_index.erase(_entries.back().key);
+		_entries.pop_back();
+	}
+}
+
+/*******************************************************************************
+ * GraphDb methods
+ *******************************************************************************/
+
+// Return the unique id of an arc (from id, type and to id), allocated once
+static std::string arcId (int from_id, std::string_view type, int to_id)
+{
+	char from[16];
+	char to[16];
+	int from_size = snprintf(from, sizeof(from), "%d", from_id);
+	int to_size = snprintf(to, sizeof(to), "%d", to_id);
+	std::string unique_id;
+	unique_id.reserve(from_size + type.size() + to_size);
+	unique_id.append(from, from_size);
+	unique_id.append(type);
+	unique_id.append(to, to_size);
+	return unique_id;
+}
+
+// Time an operation in the statistics and in the trace
+#define TGDB_OP_SCOPE(op) TGDB_STATS_SCOPE(_stats, op); TGDB_TRACE_SCOPE(statOpName(op))
+
+// Ask for a cache line ahead of its use (no effect on other compilers)
+#if defined(__GNUC__)
+#define TGDB_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define TGDB_PREFETCH(address)
+#endif
+
+// Record a section of a loaded file (given in tracer time) in the statistics and in the trace
+static void recordSection (Stats & stats, StatOp op, long long start_ns, long long end_ns)
+{
+#ifndef TGDB_NO_STATS
+	if (stats.enabled()) {
+		stats.record(op, (unsigned long long) (end_ns - start_ns));
+	}
+#endif
+#ifndef TGDB_NO_TRACE
+	if (Tracer::instance().enabled()) {
+		Tracer::instance().complete(statOpName(op), start_ns, end_ns);
+	}
+#endif
+}
+
+// Read a node from a string : (type)unique_id{prop_name="prop_value",prop_name="prop_value",...}
+void GraphDb :: readNode (std::string line)
+{
+	try {
+		std::vector<std::string> line_element = chomp_line(line, '\t');
+		if (line_element.size() < 2) {
+			std::stringstream error_message;
+			error_message << "A node needs at least a type (string) and a unique identifier (int)";
+			throw std::runtime_error(error_message.str());
+		}
+		for (std::vector<std::string>::iterator it = line_element.begin(); it != line_element.end(); it++) {
+			rem_spaces(*it);
+		}
+		
+		// Read node type and unique id
+		std::vector<std::string>::iterator it = line_element.begin();
+		const std::string & node_type = *it;
+		it++;
+		int node_id = atoi((*it).c_str());
+		it++;
+		// read node properties (views on line_element)
+		PropertyPairs node_properties;
+		node_properties.reserve((line_element.size() - 2) / 2);
+		for (; it != line_element.end(); it++) {
+			const std::string & prop_name = *it;
+			it++;
+			if (it == line_element.end()) {
+				std::stringstream error_message;
+				error_message << "Cannot find property value in \'" << line << "\'";
+				throw std::runtime_error(error_message.str());
+			}
+			node_properties.push_back(std::make_pair(std::string_view(prop_name), std::string_view(*it)));
+		}
+		
+		// create the node
+		newNodeWithId(node_id, node_type, node_properties);
+		
+	} catch (std::exception & e) {
+		throw;
+	}
+}
+
+// Read an arc from a string : id->[type{prop="value",...}]->id
+void GraphDb :: readArc (std::string line)
+{
+	try {
 		std::vector<std::string> line_element = chomp_line(line, '\t');
 		if (line_element.size() < 3) {
 			std::stringstream error_message;
 			error_message << "An arc needs at least an input node id (int), a type (string) and an ouput node id (int)";
 			throw std::runtime_error(error_message.str());
 		}
+		for (std::vector<std::string>::iterator it = line_element.begin(); it != line_element.end(); it++) {
+			rem_spaces(*it);
+		}
 		
 		// Read input id, arc type, output id
 		std::vector<std::string>::iterator it = line_element.begin();
 		int from_node_id = atoi((*it).c_str());
 		it++;
-		std::string arc_type = *it;
-		rem_spaces(arc_type);
+		const std::string & arc_type = *it;
 		it++;
 		int to_node_id = atoi((*it).c_str());
 		it++;
 		
 		
-		// Read arc properties
-		std::map<std::string, std::set<std::string> > arc_properties;
+		// Read arc properties (views on line_element)
+		PropertyPairs arc_properties;
+		arc_properties.reserve((line_element.size() - 3) / 2);
 		for (; it != line_element.end(); it++) {
-			std::string prop_name = *it;
-			rem_spaces(prop_name);
+			const std::string & prop_name = *it;
 			it++;
 			if (it == line_element.end()) {
 				std::stringstream error_message;
 				error_message << "Cannot find property value in \'" << line << "\'";
 				throw std::runtime_error(error_message.str());
 			}
-			std::string prop_value = *it;
-			rem_spaces(prop_value);
-			arc_properties[prop_name].insert(prop_value);
+			arc_properties.push_back(std::make_pair(std::string_view(prop_name), std::string_view(*it)));
 		}
 		
 		// Add the arc to the database
@@ -640,17 +1777,24 @@ std::map<std::string, std::string> GraphDb :: readProperties (std::string line)
 }
 
 // Create a GraphDb instance from the given file
-GraphDb :: GraphDb (std::string fname)
+GraphDb :: GraphDb (std::string fname, bool check_policy): _check_policy(check_policy), _next_id(0), _mutation_seq(0), _value_version(0)
 {
-	
-	_policy.read(fname);
+	_views.push_back(&_counts);
+	TGDB_TRACE_SCOPE("load");
+	{
+		TGDB_OP_SCOPE(STAT_LOAD_POLICY);
+		_policy.read(fname);
+	}
 	std::string line;
-	std::ifstream infile;
-	infile.open (fname.c_str());
+	InputStream infile(fname);
 	if (!infile.good()) {
 		std::cerr << "Cannot open file " << fname << "\n";
 		exit(1);
 	}
+	// Time spent in the Nodes and Relations sections
+	long long section_start = 0;
+	StatOp section_op = NB_STAT_OPS;
+	
 	// Find the Database keyword to read the database //
 	getline(infile, line);
 	rem_spaces(line);
@@ -662,6 +1806,14 @@ GraphDb :: GraphDb (std::string fname)
 		rem_spaces(line);
 		if (!line.empty() && line[0] != '#') {
 			rem_spaces(line);
+			if (line.compare("Nodes") == 0 || line.compare("Relations") == 0) {
+				long long now = Tracer::instance().now();
+				if (section_op != NB_STAT_OPS) {
+					recordSection(_stats, section_op, section_start, now);
+				}
+				section_start = now;
+				section_op = line.compare("Nodes") == 0 ? STAT_LOAD_NODES : STAT_LOAD_RELATIONS;
+			}
 			if (line.compare("Nodes") == 0) {
 				in_db = true;
 				in_nodes = true;
@@ -675,107 +1827,535 @@ GraphDb :: GraphDb (std::string fname)
 					try {
 						readNode(line);
 					} catch (std::exception & e) {
+						TGDB_STATS_COUNT(_stats, STAT_NODE_READ_ERRORS);
+						TGDB_TRACE_INSTANT("readNode.error", e.what());
 						std::cerr << "Read node: " << e.what() << " -> ignore node\n";
 					}
 				 } else if (in_rel){
 					 try {
 						 readArc(line);
 					 } catch (std::exception & e) {
+						 TGDB_STATS_COUNT(_stats, STAT_ARC_READ_ERRORS);
+						 TGDB_TRACE_INSTANT("readArc.error", e.what());
 						 std::cerr << "Read arc: " << e.what() << " -> ignore arc\n";
 					 }
 				 }
 			}
 		}
 	}
+	if (section_op != NB_STAT_OPS) {
+		recordSection(_stats, section_op, section_start, Tracer::instance().now());
+	}
 	infile.close();
 }
 
-// Create a node of given type with the given properties and return its unique id
-int GraphDb :: newNode (const std::string & type, const std::map<std::string, std::set<std::string> > & properties)
+// Return a pointer to the node stored with the given id (NULL if it does not exist)
+Node * GraphDb :: findNode (int node_id)
+{
+	if (node_id >= 0 && node_id < (int) _dense_slot.size()) {
+		int slot = _dense_slot[node_id];
+		return slot < 0 ? NULL : &_nodes[slot];
+	}
+	if (_sparse_slot.empty()) {
+		return NULL;
+	}
+	std::unordered_map<int, int>::iterator it = _sparse_slot.find(node_id);
+	if (it == _sparse_slot.end()) {
+		return NULL;
+	}
+	return &_nodes[it->second];
+}
+
+// Find the nodes of a group of ids, prefetching every slot before reading one, then the nodes
+void GraphDb :: findNodes (const int * ids, size_t count, Node ** out)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (ids[i] >= 0 && ids[i] < (int) _dense_slot.size()) {
+			TGDB_PREFETCH(&_dense_slot[ids[i]]);
+		}
+	}
+	for (size_t i = 0; i < count; i++) {
+		out[i] = findNode(ids[i]);
+		if (out[i] != NULL) {
+			TGDB_PREFETCH(out[i]);
+		}
+	}
+}
+
+// Store a new node in a free slot (or a new one) and index its id, type and properties
+Node * GraphDb :: insertNode (int unique_id, std::string_view type, PropertyList && properties)
+{
+	return insertNode(unique_id, StringPool::instance().intern(type), std::move(properties));
+}
+
+// Store a new node of an interned type (the caller has checked that its id is free)
+Node * GraphDb :: insertNode (int unique_id, int type_id, PropertyList && properties)
+{
+	const std::string & type = StringPool::instance().str(type_id);
+	int slot;
+	if (!_free_slots.empty()) {
+		slot = _free_slots.back();
+		_free_slots.pop_back();
+		_nodes[slot] = Node(unique_id, type_id, std::move(properties));
+		_slot_used[slot] = 1;
+	} else {
+		slot = (int) _nodes.size();
+		_nodes.emplace_back(unique_id, type_id, std::move(properties));
+		_slot_used.push_back(1);
+	}
+	
+	// Ids close to the dense range are directly indexed, the others are hashed
+	if (unique_id >= 0 && unique_id < (int) _dense_slot.size()) {
+		_dense_slot[unique_id] = slot;
+	} else if (unique_id >= 0 && unique_id < 2 * (_counts.nodes() + 1) + 1024) {
+		int old_size = (int) _dense_slot.size();
+		int new_size = 2 * old_size > unique_id + 1 ? 2 * old_size : unique_id + 1;
+		_dense_slot.resize(new_size, -1);
+		// Move the hashed ids now falling in the dense range
+		for (std::unordered_map<int, int>::iterator it = _sparse_slot.begin(); it != _sparse_slot.end();) {
+			if (it->first >= old_size && it->first < new_size) {
+				_dense_slot[it->first] = it->second;
+				it = _sparse_slot.erase(it);
+			} else {
+				it++;
+			}
+		}
+		_dense_slot[unique_id] = slot;
+	} else {
+		_sparse_slot[unique_id] = slot;
+	}
+	if (unique_id >= _next_id) {
+		_next_id = unique_id + 1;
+	}
+	
+	IdIndex::iterator it_type = _node_types.find(type);
+	if (it_type == _node_types.end()) {
+		it_type = _node_types.emplace(std::string(type), std::set<int>()).first;
+	}
+	it_type->second.insert(unique_id);
+	_type_versions[type_id] = ++_mutation_seq;
+	Node & node = _nodes[slot];
+	for (size_t i = 0; i < _views.size(); i++) {
+		_views[i]->nodeAdded(node);
+	}
+	PropertyView stored = node.properties();
+	for (PropertyView::const_iterator it = stored.begin(); it != stored.end(); it++) {
+		indexProperty(node, *it);
+	}
+	return &node;
+}
+
+// Add a node to the property indexes (strings are only copied the first time they are seen)
+void GraphDb :: indexProperty (const Node & node, const PropEntry & entry)
+{
+	int node_id = node.unique_id();
+	StringPool & pool = StringPool::instance();
+	std::string text;
+	std::string_view value;
+	if (entry.type == PROP_STRING) {
+		value = pool.str(entry.value.str);
+	} else {
+		text = entry.text();
+		value = text;
+	}
+	const std::string & name = pool.str(entry.name);
+	std::map<std::string, IdIndex, std::less<> >::iterator it_name = _props.find(name);
+	if (it_name == _props.end()) {
+		it_name = _props.emplace(name, IdIndex()).first;
+	}
+	IdIndex::iterator it_value = it_name->second.find(value);
+	if (it_value == it_name->second.end()) {
+		it_value = it_name->second.emplace(std::string(value), std::set<int>()).first;
+	}
+	it_value->second.insert(node_id);
+	IdIndex::iterator it_rev = _rev_props.find(value);
+	if (it_rev == _rev_props.end()) {
+		it_rev = _rev_props.emplace(std::string(value), std::set<int>()).first;
+	}
+	it_rev->second.insert(node_id);
+	_prop_versions[entry.name] = ++_mutation_seq;
+	_value_version = _mutation_seq;
+	for (size_t i = 0; i < _views.size(); i++) {
+		_views[i]->propertyAdded(node, entry);
+	}
+}
+
+// Return true if a property of the node other than the one of entry has the value (as text)
+static bool hasValueElsewhere (const Node & node, const PropEntry & entry, std::string_view value)
+{
+	PropertyView properties = node.properties();
+	for (PropertyView::const_iterator it = properties.begin(); it != properties.end(); it++) {
+		if (it->name == entry.name) {
+			continue;
+		}
+		if (it->type == PROP_STRING ? StringPool::instance().str(it->value.str) == value : it->text() == value) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Remove a node from the property indexes
+void GraphDb :: unindexProperty (const Node & node, const PropEntry & entry, bool whole_node)
+{
+	int node_id = node.unique_id();
+	StringPool & pool = StringPool::instance();
+	std::string text;
+	std::string_view value;
+	if (entry.type == PROP_STRING) {
+		value = pool.str(entry.value.str);
+	} else {
+		text = entry.text();
+		value = text;
+	}
+	// Empty entries are removed at once (no tombstone is left in the indexes)
+	std::map<std::string, IdIndex, std::less<> >::iterator it_name = _props.find(pool.str(entry.name));
+	if (it_name != _props.end()) {
+		IdIndex::iterator it_value = it_name->second.find(value);
+		if (it_value != it_name->second.end()) {
+			it_value->second.erase(node_id);
+			if (it_value->second.empty()) {
+				it_name->second.erase(it_value);
+			}
+		}
+		if (it_name->second.empty()) {
+			_props.erase(it_name);
+		}
+	}
+	// The node stays under the value while a property of another name still has it
+	IdIndex::iterator it_rev = _rev_props.find(value);
+	if (it_rev != _rev_props.end() && (whole_node || !hasValueElsewhere(node, entry, value))) {
+		it_rev->second.erase(node_id);
+		if (it_rev->second.empty()) {
+			_rev_props.erase(it_rev);
+		}
+	}
+	_prop_versions[entry.name] = ++_mutation_seq;
+	_value_version = _mutation_seq;
+	for (size_t i = 0; i < _views.size(); i++) {
+		_views[i]->propertyErased(node, entry);
+	}
+}
+
+// Remove a node from the indexes and put its slot and its id in the free lists
+void GraphDb :: releaseNode (int node_id)
+{
+	int slot = -1;
+	if (node_id >= 0 && node_id < (int) _dense_slot.size()) {
+		slot = _dense_slot[node_id];
+		_dense_slot[node_id] = -1;
+	} else {
+		std::unordered_map<int, int>::iterator it = _sparse_slot.find(node_id);
+		if (it != _sparse_slot.end()) {
+			slot = it->second;
+			_sparse_slot.erase(it);
+		}
+	}
+	if (slot < 0) {
+		return;
+	}
+	Node & node = _nodes[slot];
+	IdIndex::iterator it_type = _node_types.find(node.type());
+	if (it_type != _node_types.end()) {
+		it_type->second.erase(node_id);
+		if (it_type->second.empty()) {
+			_node_types.erase(it_type);
+		}
+	}
+	_type_versions[node.typeId()] = ++_mutation_seq;
+	PropertyView properties = node.properties();
+	for (PropertyView::const_iterator it = properties.begin(); it != properties.end(); it++) {
+		unindexProperty(node, *it, true);
+	}
+	for (size_t i = 0; i < _views.size(); i++) {
+		_views[i]->nodeErased(node);
+	}
+	node = Node();
+	_slot_used[slot] = 0;
+	_free_slots.push_back(slot);
+	if (node_id >= 0) {
+		_free_ids.push_back(node_id);
+	}
+}
+
+// Throw an exception if the given node type is not in the policy
+void GraphDb :: checkNodeType (std::string_view type)
 {
-	if (!_policy.isNodeType(type)) {
+	if (_check_policy && !_policy.isNodeType(type)) {
+		TGDB_STATS_COUNT(_stats, STAT_POLICY_REJECTIONS);
 		std::stringstream error_message;
 		error_message << "Unknown node type \'" << type << "\'";
 		throw std::runtime_error(error_message.str());
 	}
-	int unique_id = (int) _nodes.size();
-	if (_nodes.find(unique_id) != _nodes.end()) {
-		std::map<int, Node>::iterator it = _nodes.end();
-		it--;
-		unique_id = it->first + 1;
+}
+
+// Throw an exception if the policy does not allow the given arc
+void GraphDb :: checkArc (const Node & from, std::string_view type, const Node & to)
+{
+	if (_check_policy && !_policy.isValid(from.type(), type, to.type())) {
+		TGDB_STATS_COUNT(_stats, STAT_POLICY_REJECTIONS);
+		std::stringstream error_message;
+		error_message << "Arc not valid : " << from.type() << "->[" << type << "]->" << to.type();
+		throw std::runtime_error(error_message.str());
 	}
-	_nodes[unique_id] = Node(unique_id, type, properties);
-	_node_types[type].insert(unique_id);
-	for (std::map<std::string, std::set<std::string> >::const_iterator it_name = properties.begin(); it_name != properties.end(); it_name++) {
-		for (std::set<std::string>::iterator it_value = it_name->second.begin(); it_value != it_name->second.end(); it_value++) {
-			_props[it_name->first][*it_value].insert(unique_id);
-			_rev_props[*it_value].insert(unique_id);
+}
+
+// Return the id of an erased node if it has not been taken back by newNodeWithId, else a new id
+int GraphDb :: takeFreeId ()
+{
+	while (!_free_ids.empty()) {
+		int free_id = _free_ids.back();
+		_free_ids.pop_back();
+		if (findNode(free_id) == NULL) {
+			return free_id;
 		}
 	}
+	return _next_id;
+}
+
+// Create a node of given type with the given properties and return its unique id
+int GraphDb :: newNode (const std::string & type, const std::map<std::string, std::set<std::string> > & properties)
+{
+	TGDB_OP_SCOPE(STAT_NEW_NODE);
+	checkNodeType(type);
+	PropertyList list(properties, _policy.propertyTypes(type));
+	int unique_id = takeFreeId();
+	insertNode(unique_id, type, std::move(list));
+	return unique_id;
+}
+
+// Create a node of given type with the given (name, value) pairs and return its unique id
+int GraphDb :: newNode (std::string_view type, const PropertyPairs & properties)
+{
+	TGDB_OP_SCOPE(STAT_NEW_NODE);
+	checkNodeType(type);
+	PropertyList list(properties, _policy.propertyTypes(type));
+	int unique_id = takeFreeId();
+	insertNode(unique_id, type, std::move(list));
+	return unique_id;
+}
+
+// Create a node of given type with a property list built by the caller (moved into the node) and return its unique id
+int GraphDb :: newNode (std::string_view type, PropertyList && properties)
+{
+	TGDB_OP_SCOPE(STAT_NEW_NODE);
+	checkNodeType(type);
+	properties.conform(_policy.propertyTypes(type));
+	int unique_id = takeFreeId();
+	insertNode(unique_id, type, std::move(properties));
 	return unique_id;
 }
 
 // Create a node of the given type with the given unique id and the given properties
 void GraphDb :: newNodeWithId(const int & unique_id, const std::string & type, const std::map<std::string, std::set<std::string> > & properties)
 {
-	if (!_policy.isNodeType(type)) {
-		std::stringstream error_message;
-		error_message << "Unknown node type \'" << type << "\'";
-		throw std::runtime_error(error_message.str());
+	TGDB_OP_SCOPE(STAT_NEW_NODE_WITH_ID);
+	checkNodeType(type);
+	if (findNode(unique_id) == NULL) {
+		insertNode(unique_id, type, PropertyList(properties, _policy.propertyTypes(type)));
 	}
-	if (_nodes.find(unique_id) == _nodes.end()) {
-		_nodes[unique_id] = Node(unique_id, type, properties);
-		_node_types[type].insert(unique_id);
-		for (std::map<std::string, std::set<std::string> >::const_iterator it_name = properties.begin(); it_name != properties.end(); it_name++) {
-			for (std::set<std::string>::iterator it_value = it_name->second.begin(); it_value != it_name->second.end(); it_value++) {
-				_props[it_name->first][*it_value].insert(unique_id);
-				_rev_props[*it_value].insert(unique_id);
-			}
-		}
+}
+
+// Create a node of the given type with the given unique id and the given (name, value) pairs
+void GraphDb :: newNodeWithId(int unique_id, std::string_view type, const PropertyPairs & properties)
+{
+	TGDB_OP_SCOPE(STAT_NEW_NODE_WITH_ID);
+	checkNodeType(type);
+	if (findNode(unique_id) == NULL) {
+		insertNode(unique_id, type, PropertyList(properties, _policy.propertyTypes(type)));
+	}
+}
+
+// Create a node of the given type with the given unique id and a property list built by the caller (moved into the node)
+void GraphDb :: newNodeWithId (int unique_id, std::string_view type, PropertyList && properties)
+{
+	TGDB_OP_SCOPE(STAT_NEW_NODE_WITH_ID);
+	checkNodeType(type);
+	if (findNode(unique_id) == NULL) {
+		properties.conform(_policy.propertyTypes(type));
+		insertNode(unique_id, type, std::move(properties));
 	}
 }
 
 // Add an arc from from_id to to_id with the given type and the given properties
 void GraphDb :: addArc  (const int & from_id, const std::string & type, const int & to_id, const std::map<std::string, std::set<std::string> > & properties)
 {
-	// Check from_node existence
-	if (_nodes.find(from_id) == _nodes.end()) {
+	PropertyPairs pairs;
+	for (std::map<std::string, std::set<std::string> >::const_iterator it_name = properties.begin(); it_name != properties.end(); it_name++) {
+		for (std::set<std::string>::const_iterator it_value = it_name->second.begin(); it_value != it_name->second.end(); it_value++) {
+			pairs.push_back(std::make_pair(std::string_view(it_name->first), std::string_view(*it_value)));
+		}
+	}
+	addArc(from_id, std::string_view(type), to_id, pairs);
+}
+
+// Return the stored node at an end of an arc to add (throw an exception if it does not exist)
+Node * GraphDb :: arcEnd (int node_id)
+{
+	Node * node = findNode(node_id);
+	if (node == NULL) {
 		std::stringstream error_message;
-		error_message << "Node \'" << from_id << "\' does not exist";
+		error_message << "Node \'" << node_id << "\' does not exist";
 		throw std::runtime_error(error_message.str());
 	}
-	Node * node_from = &_nodes[from_id];
-	
-	// Check to_node existence
-	if (_nodes.find(to_id) == _nodes.end()) {
+	return node;
+}
+
+// Find the place in _arcs of an arc between two checked nodes (false if it already exists)
+bool GraphDb :: placeArc (Node * from, std::string_view type, Node * to, ArcPlace & place)
+{
+	place.from = from;
+	place.to = to;
+	place.unique_id = arcId(from->unique_id(), type, to->unique_id());
+	place.hint = _arcs.lower_bound(place.unique_id);
+	return place.hint == _arcs.end() || place.hint->first != place.unique_id;
+}
+
+// Add an arc at its place (the Arc refers to its key in _arcs: the id is stored once)
+void GraphDb :: insertArc (ArcPlace & place, int type_id, PropertyList && properties)
+{
+	std::map<std::string, Arc>::iterator it = _arcs.emplace_hint(place.hint, std::move(place.unique_id), Arc());
+	it->second = Arc(it->first, type_id, std::move(properties), place.from, place.to);
+	place.from->addArc(&it->second);
+	place.to->addArc(&it->second);
+	for (size_t i = 0; i < _views.size(); i++) {
+		_views[i]->arcAdded(it->second);
+	}
+}
+
+// Add an arc from from_id to to_id with the given type and the given (name, value) pairs
+void GraphDb :: addArc (int from_id, std::string_view type, int to_id, const PropertyPairs & properties)
+{
+	TGDB_OP_SCOPE(STAT_ADD_ARC);
+	Node * from = arcEnd(from_id);
+	Node * to = arcEnd(to_id);
+	checkArc(*from, type, *to);
+	ArcPlace place;
+	if (placeArc(from, type, to, place)) {
+		insertArc(place, StringPool::instance().intern(type), PropertyList(properties, _policy.propertyTypes(type)));
+	}
+}
+
+// Add an arc with a property list built by the caller (moved into the arc)
+void GraphDb :: addArc (int from_id, std::string_view type, int to_id, PropertyList && properties)
+{
+	TGDB_OP_SCOPE(STAT_ADD_ARC);
+	Node * from = arcEnd(from_id);
+	Node * to = arcEnd(to_id);
+	checkArc(*from, type, *to);
+	ArcPlace place;
+	if (placeArc(from, type, to, place)) {
+		properties.conform(_policy.propertyTypes(type));
+		insertArc(place, StringPool::instance().intern(type), std::move(properties));
+	}
+}
+
+// Create a node of a type checked by the caller and return its unique id
+int GraphDb :: newCheckedNode (int type_id, const PropTypeMap * prop_types, const PropertyPairs & properties)
+{
+	TGDB_OP_SCOPE(STAT_NEW_NODE);
+	PropertyList list(properties, prop_types);
+	int unique_id = takeFreeId();
+	insertNode(unique_id, type_id, std::move(list));
+	return unique_id;
+}
+
+// Create a node of a type checked by the caller with the given unique id
+void GraphDb :: newCheckedNodeWithId (int unique_id, int type_id, const PropTypeMap * prop_types, const PropertyPairs & properties)
+{
+	TGDB_OP_SCOPE(STAT_NEW_NODE_WITH_ID);
+	if (findNode(unique_id) == NULL) {
+		insertNode(unique_id, type_id, PropertyList(properties, prop_types));
+	}
+}
+
+// Add an arc checked by the caller between two stored nodes
+void GraphDb :: addCheckedArc (Node * from, int type_id, Node * to, const PropTypeMap * prop_types, const PropertyPairs & properties)
+{
+	TGDB_OP_SCOPE(STAT_ADD_ARC);
+	ArcPlace place;
+	if (placeArc(from, StringPool::instance().str(type_id), to, place)) {
+		insertArc(place, type_id, PropertyList(properties, prop_types));
+	}
+}
+
+// Add a value to a property of a stored node (the value is parsed if the policy declares a type)
+void GraphDb :: addProperty (int node_id, std::string_view prop_name, std::string_view prop_value)
+{
+	Node * node = findNode(node_id);
+	if (node == NULL) {
 		std::stringstream error_message;
-		error_message << "Node \'" << to_id << "\' does not exist";
+		error_message << "Node \'" << node_id << "\' does not exist";
 		throw std::runtime_error(error_message.str());
 	}
-	Node * node_to = &_nodes[to_id];
-	
-	// If the arc can exist between the two nodes, create it
-	if (!_policy.isValid(node_from->type(), type, node_to->type())) {
+	StringPool & pool = StringPool::instance();
+	PropType type = _policy.propertyType(node->type(), prop_name);
+	if (type != PROP_STRING) {
+		PropEntry entry = PropEntry::make(pool.intern(prop_name), PropValue::parse(type, prop_value));
+		if (node->addProperty(entry)) {
+			indexProperty(*node, entry);
+		}
+		return;
+	}
+	// The node takes its own reference on the value
+	PropEntry entry = PropEntry::make(pool.intern(prop_name), pool.acquire(prop_value));
+	if (node->addProperty(entry)) {
+		indexProperty(*node, entry);
+	}
+	pool.release(entry.value.str);
+}
+
+// Add a typed value to a property of a stored node (converted like its text if the policy declares another type)
+void GraphDb :: addProperty (int node_id, std::string_view prop_name, const PropValue & prop_value)
+{
+	Node * node = findNode(node_id);
+	if (node == NULL) {
 		std::stringstream error_message;
-		error_message << "Arc not valid : " << node_from->type() << "->[" << type << "]->" << node_to->type();
+		error_message << "Node \'" << node_id << "\' does not exist";
 		throw std::runtime_error(error_message.str());
 	}
-	
-	// If the unique id has been seen, create the new arc
-	std::stringstream unique_id;
-	unique_id << from_id << type << to_id;
-	if (_arcs.find(unique_id.str()) == _arcs.end()) {
-		_arcs[unique_id.str()] = Arc(unique_id.str(), type, properties, node_from, node_to);
-		node_from->addArc (&_arcs[unique_id.str()]);
-		node_to->addArc (&_arcs[unique_id.str()]);
+	if (_policy.propertyType(node->type(), prop_name) != prop_value.type()) {
+		addProperty(node_id, prop_name, std::string_view(prop_value.text()));
+		return;
+	}
+	PropEntry entry = PropEntry::make(StringPool::instance().intern(prop_name), prop_value);
+	if (node->addProperty(entry)) {
+		indexProperty(*node, entry);
+	}
+}
+
+// Erase all the values of a property of a stored node
+void GraphDb :: eraseProperty (int node_id, std::string_view prop_name)
+{
+	Node * node = findNode(node_id);
+	int name = StringPool::instance().lookup(prop_name);
+	if (node == NULL || name < 0) {
+		return;
+	}
+	PropertyValues values = node->properties().values(name);
+	for (PropertyValues::const_iterator it = values.begin(); it != values.end(); it++) {
+		unindexProperty(*node, it.entry());
 	}
+	node->eraseProperty(std::string(prop_name));
 }
 
 // Return the set of all nodes in the GraphDb
 std::set<Node *> GraphDb :: allNodes ()
 {
 	std::set<Node *>  all;
-	for (std::map<int, Node>::iterator it = _nodes.begin(); it != _nodes.end(); it++) {
+	for (size_t slot = 0; slot < _nodes.size(); slot++) {
+		if (_slot_used[slot]) {
+			all.insert(&_nodes[slot]);
+		}
+	}
+	return all;
+}
+
+// Return the set of all arcs in the GraphDb
+std::set<Arc *> GraphDb :: allArcs ()
+{
+	std::set<Arc *> all;
+	for (std::map<std::string, Arc>::iterator it = _arcs.begin(); it != _arcs.end(); it++) {
 		all.insert(&it->second);
 	}
 	return all;
@@ -784,71 +2364,120 @@ std::set<Node *> GraphDb :: allNodes ()
 // Return a pointer to the node with the given unique id
 Node * GraphDb :: getNode (int node_id)
 {
-	if (_nodes.find(node_id) == _nodes.end()) {
-		return NULL;
+	return findNode(node_id);
+}
+
+// Return the nodes of a batch of ids in out (NULL if it does not exist) and the number found
+size_t GraphDb :: getNodes (const int * ids, size_t count, Node ** out)
+{
+	size_t found = 0;
+	for (size_t first = 0; first < count; first += BATCH_GROUP) {
+		size_t size = count - first < BATCH_GROUP ? count - first : BATCH_GROUP;
+		findNodes(ids + first, size, out + first);
+		for (size_t i = 0; i < size; i++) {
+			found += out[first + i] != NULL;
+		}
+	}
+	return found;
+}
+
+// Return the values of a property of a batch of nodes in out (empty if the node or the property does not exist)
+// and the number of nodes having it
+size_t GraphDb :: getProperties (const int * ids, size_t count, std::string_view prop_name, PropertyValues * out)
+{
+	int name = StringPool::instance().lookup(prop_name);
+	Node * nodes[BATCH_GROUP];
+	size_t found = 0;
+	for (size_t first = 0; first < count; first += BATCH_GROUP) {
+		size_t size = count - first < BATCH_GROUP ? count - first : BATCH_GROUP;
+		findNodes(ids + first, size, nodes);
+		// The entries of heap property lists are one more miss away
+		for (size_t i = 0; i < size; i++) {
+			if (nodes[i] != NULL) {
+				TGDB_PREFETCH(&*nodes[i]->properties().begin());
+			}
+		}
+		for (size_t i = 0; i < size; i++) {
+			out[first + i] = nodes[i] == NULL || name < 0 ? PropertyValues() : nodes[i]->properties().values(name);
+			found += !out[first + i].empty();
+		}
 	}
-	return &_nodes[node_id];
+	return found;
 }
 
 // Return a pointer to the arc with the given id
 Arc * GraphDb :: getArc (const std::string & arc_id)
 {
-	if (_arcs.find(arc_id) == _arcs.end()) {
+	std::map<std::string, Arc>::iterator it = _arcs.find(arc_id);
+	if (it == _arcs.end()) {
 		std::stringstream error_message;
 		error_message << "Arc \'" << arc_id << "\' does not exist";
 		throw std::runtime_error(error_message.str());
 	}
-	return & _arcs[arc_id];
+	return & it->second;
 }
 
 // Return the set of all nodes of the given type
-std::set<Node *> GraphDb :: getNodesOfType (std::string type)
+std::set<Node *> GraphDb :: getNodesOfType (std::string_view type)
 {
+	TGDB_OP_SCOPE(STAT_GET_NODES_OF_TYPE);
 	std::set<Node *> nodes;
-	if (_node_types.find(type) != _node_types.end()) {
-		std::set<int> & node_set = _node_types[type];
+	IdIndex::iterator it_type = _node_types.find(type);
+	if (it_type != _node_types.end()) {
+		std::set<int> & node_set = it_type->second;
 		for (std::set<int>::iterator it = node_set.begin(); it != node_set.end(); it++) {
-			nodes.insert(&_nodes[*it]);
+			nodes.insert(findNode(*it));
 		}
 	}
 	return nodes;
 }
 
 // Return the set of all nodes of the given type with the given property field
-std::set<Node *> GraphDb :: getNodesOfTypeWithProperty (std::string type, std::string prop_name)
+std::set<Node *> GraphDb :: getNodesOfTypeWithProperty (std::string_view type, std::string_view prop_name)
 {
+	TGDB_OP_SCOPE(STAT_GET_NODES_OF_TYPE_WITH_PROPERTY);
 	std::set<Node *> nodes;
-	if (_node_types.find(type) != _node_types.end()) {
-		std::set<int> & node_set = _node_types[type];
+	IdIndex::iterator it_type = _node_types.find(type);
+	int name = StringPool::instance().lookup(prop_name);
+	if (it_type != _node_types.end() && name >= 0) {
+		std::set<int> & node_set = it_type->second;
 		for (std::set<int>::iterator it = node_set.begin(); it != node_set.end(); it++) {
-			if (_nodes[*it].hasProp(prop_name)) {
-				nodes.insert(&_nodes[*it]);
+			Node * node = findNode(*it);
+			if (!node->properties().values(name).empty()) {
+				nodes.insert(node);
 			}
 		}
 	}
 	return nodes;
 }
 
-std::set<Node *>  GraphDb :: getNodesWithPropertyValue (std::string prop_value)
+std::set<Node *>  GraphDb :: getNodesWithPropertyValue (std::string_view prop_value)
 {
+	TGDB_OP_SCOPE(STAT_GET_NODES_WITH_VALUE);
 	std::set<Node *> nodes;
-	if (_rev_props.find(prop_value) != _rev_props.end()) {
-		for (std::set<int>::iterator it = _rev_props[prop_value].begin(); it != _rev_props[prop_value].end(); it++) {
-			nodes.insert(&_nodes[*it]);
+	IdIndex::iterator it_value = _rev_props.find(prop_value);
+	if (it_value != _rev_props.end()) {
+		for (std::set<int>::iterator it = it_value->second.begin(); it != it_value->second.end(); it++) {
+			nodes.insert(findNode(*it));
 		}
 	}
 	return nodes;
 }
 
 // Return the set of all nodes of the given type with the given property field and property value
-std::set<Node *> GraphDb :: getNodesOfTypeWithProperty (std::string type, std::string prop_name, std::string prop_value)
+std::set<Node *> GraphDb :: getNodesOfTypeWithProperty (std::string_view type, std::string_view prop_name, std::string_view prop_value)
 {
+	TGDB_OP_SCOPE(STAT_GET_NODES_OF_TYPE_WITH_PROPERTY_VALUE);
 	std::set<Node *> nodes;
-	if (_props.find(prop_name) != _props.end()) {
-		if (_props[prop_name].find(prop_value) != _props[prop_name].end()) {
-			for (std::set<int>::iterator it = _props[prop_name][prop_value].begin(); it != _props[prop_name][prop_value].end(); it++) {
-				if (_nodes[*it].type().compare(type) == 0) {
-					nodes.insert(&_nodes[*it]);
+	int type_id = StringPool::instance().lookup(type);
+	std::map<std::string, IdIndex, std::less<> >::iterator it_name = _props.find(prop_name);
+	if (it_name != _props.end() && type_id >= 0) {
+		IdIndex::iterator it_value = it_name->second.find(prop_value);
+		if (it_value != it_name->second.end()) {
+			for (std::set<int>::iterator it = it_value->second.begin(); it != it_value->second.end(); it++) {
+				Node * node = findNode(*it);
+				if (node->typeId() == type_id) {
+					nodes.insert(node);
 				}
 			}
 		}
@@ -857,13 +2486,15 @@ std::set<Node *> GraphDb :: getNodesOfTypeWithProperty (std::string type, std::s
 }
 
 // Return the set of nodes with the given property field
-std::set<Node *> GraphDb :: getNodesWithProperty (std::string prop_name)
+std::set<Node *> GraphDb :: getNodesWithProperty (std::string_view prop_name)
 {
+	TGDB_OP_SCOPE(STAT_GET_NODES_WITH_PROPERTY);
 	std::set<Node *> nodes;
-	if (_props.find(prop_name) != _props.end()) {
-		for (std::map<std::string, std::set<int> >::iterator pit = _props[prop_name].begin(); pit != _props[prop_name].end(); pit++) {
+	std::map<std::string, IdIndex, std::less<> >::iterator it_name = _props.find(prop_name);
+	if (it_name != _props.end()) {
+		for (IdIndex::iterator pit = it_name->second.begin(); pit != it_name->second.end(); pit++) {
 			for (std::set<int>::iterator it = pit->second.begin(); it != pit->second.end(); it++) {
-				nodes.insert(&_nodes[*it]);
+				nodes.insert(findNode(*it));
 			}
 		}
 	}
@@ -871,35 +2502,263 @@ std::set<Node *> GraphDb :: getNodesWithProperty (std::string prop_name)
 }
 
 // Return the set of nodes with the given property field and property value
-std::set<Node *> GraphDb :: getNodesWithProperty (std::string prop_name, std::string prop_value)
+std::set<Node *> GraphDb :: getNodesWithProperty (std::string_view prop_name, std::string_view prop_value)
+{
+	TGDB_OP_SCOPE(STAT_GET_NODES_WITH_PROPERTY_VALUE);
+	std::set<Node *> nodes;
+	std::map<std::string, IdIndex, std::less<> >::iterator it_name = _props.find(prop_name);
+	if (it_name != _props.end()) {
+		IdIndex::iterator it_value = it_name->second.find(prop_value);
+		if (it_value != it_name->second.end()) {
+			for (std::set<int>::iterator it = it_value->second.begin(); it != it_value->second.end(); it++) {
+				nodes.insert(findNode(*it));
+			}
+		}
+	}
+	return nodes;
+}
+
+// Return the set of nodes with the given property field equal to the given typed value
+std::set<Node *> GraphDb :: getNodesWithProperty (std::string_view prop_name, const PropValue & prop_value)
+{
+	TGDB_OP_SCOPE(STAT_GET_NODES_WITH_TYPED_PROPERTY);
+	return nodesWithTypedValue("", prop_name, prop_value);
+}
+
+// Return the set of all nodes of the given type with the given property field equal to the given typed value
+std::set<Node *> GraphDb :: getNodesOfTypeWithProperty (std::string_view type, std::string_view prop_name, const PropValue & prop_value)
+{
+	TGDB_OP_SCOPE(STAT_GET_NODES_OF_TYPE_WITH_TYPED_PROPERTY);
+	return nodesWithTypedValue(type, prop_name, prop_value);
+}
+
+// Return the set of all nodes of the given type (any type if empty) with the given property field equal to the given typed value
+std::set<Node *> GraphDb :: nodesWithTypedValue (std::string_view type, std::string_view prop_name, const PropValue & prop_value)
 {
 	std::set<Node *> nodes;
-	if (_props.find(prop_name) != _props.end()) {
-		if (_props[prop_name].find(prop_value) != _props[prop_name].end()) {
-			for (std::set<int>::iterator it = _props[prop_name][prop_value].begin(); it != _props[prop_name][prop_value].end(); it++) {
-				nodes.insert(&_nodes[*it]);
+	int type_id = StringPool::instance().lookup(type);
+	int name = StringPool::instance().lookup(prop_name);
+	std::map<std::string, IdIndex, std::less<> >::iterator it_name = _props.find(prop_name);
+	if (it_name != _props.end() && (type.empty() || type_id >= 0)) {
+		IdIndex::iterator it_value = it_name->second.find(prop_value.text());
+		if (it_value != it_name->second.end()) {
+			for (std::set<int>::iterator it = it_value->second.begin(); it != it_value->second.end(); it++) {
+				Node * node = findNode(*it);
+				if ((type.empty() || node->typeId() == type_id) && node->properties().values(name).count(prop_value) > 0) {
+					nodes.insert(node);
+				}
 			}
 		}
 	}
 	return nodes;
 }
 
+// Aggregate the numeric values of the given property over the nodes of the given type
+PropertyStats GraphDb :: aggregateProperty (std::string_view type, std::string_view prop_name)
+{
+	PropertyStats stats;
+	int name = StringPool::instance().lookup(prop_name);
+	IdIndex::iterator it_type = _node_types.find(type);
+	if (name < 0 || it_type == _node_types.end()) {
+		return stats;
+	}
+	for (std::set<int>::iterator it = it_type->second.begin(); it != it_type->second.end(); it++) {
+		PropertyValues values = findNode(*it)->properties().values(name);
+		for (PropertyValues::const_iterator it_value = values.begin(); it_value != values.end(); it_value++) {
+			const PropEntry & entry = it_value.entry();
+			if (entry.type != PROP_INT && entry.type != PROP_DOUBLE) {
+				continue;
+			}
+			double value = entry.type == PROP_INT ? (double) entry.value.integer : entry.value.real;
+			if (stats.count == 0 || value < stats.min) stats.min = value;
+			if (stats.count == 0 || value > stats.max) stats.max = value;
+			stats.sum += value;
+			stats.count++;
+		}
+	}
+	return stats;
+}
+
+// Return the version of the nodes of the given type
+unsigned long long GraphDb :: typeVersion (std::string_view type) const
+{
+	std::unordered_map<int, unsigned long long>::const_iterator it = _type_versions.find(StringPool::instance().lookup(type));
+	return it == _type_versions.end() ? 0 : it->second;
+}
+
+// Return the version of the values of the given property
+unsigned long long GraphDb :: propVersion (std::string_view prop_name) const
+{
+	std::unordered_map<int, unsigned long long>::const_iterator it = _prop_versions.find(StringPool::instance().lookup(prop_name));
+	return it == _prop_versions.end() ? 0 : it->second;
+}
+
+// Return the cached result of the given query if it is still valid (NULL otherwise)
+NodeSetPtr GraphDb :: cacheFind (const std::string & key, unsigned long long version)
+{
+	if (_cache.capacity() == 0) {
+		return NodeSetPtr();
+	}
+	NodeSetPtr result = _cache.find(key, version);
+	if (result) {
+		TGDB_STATS_COUNT(_stats, STAT_CACHE_HITS);
+	} else {
+		TGDB_STATS_COUNT(_stats, STAT_CACHE_MISSES);
+	}
+	return result;
+}
+
+// Share the result of a query and keep it in the cache
+NodeSetPtr GraphDb :: cacheInsert (const std::string & key, unsigned long long version, std::set<Node *> && nodes)
+{
+	NodeSetPtr result = std::make_shared<const std::set<Node *> >(std::move(nodes));
+	if (_cache.capacity() != 0) {
+		_cache.insert(key, version, result);
+	}
+	return result;
+}
+
+// Cache keys are the query name and its arguments separated by an unused character
+static std::string cacheKey (const char * query, std::string_view arg1, std::string_view arg2 = std::string_view(), std::string_view arg3 = std::string_view())
+{
+	std::string key(query);
+	key.append(1, '\x1f').append(arg1).append(1, '\x1f').append(arg2).append(1, '\x1f').append(arg3);
+	return key;
+}
+
+// Cached getNodesOfType (depends on the insertions and erasures of nodes of the type)
+NodeSetPtr GraphDb :: cachedNodesOfType (std::string_view type)
+{
+	std::string key = cacheKey("T", type);
+	unsigned long long version = typeVersion(type);
+	NodeSetPtr result = cacheFind(key, version);
+	return result ? result : cacheInsert(key, version, getNodesOfType(type));
+}
+
+// Cached getNodesWithProperty (depends on the values of the property)
+NodeSetPtr GraphDb :: cachedNodesWithProperty (std::string_view prop_name)
+{
+	std::string key = cacheKey("P", prop_name);
+	unsigned long long version = propVersion(prop_name);
+	NodeSetPtr result = cacheFind(key, version);
+	return result ? result : cacheInsert(key, version, getNodesWithProperty(prop_name));
+}
+
+NodeSetPtr GraphDb :: cachedNodesWithProperty (std::string_view prop_name, std::string_view prop_value)
+{
+	std::string key = cacheKey("PV", prop_name, prop_value);
+	unsigned long long version = propVersion(prop_name);
+	NodeSetPtr result = cacheFind(key, version);
+	return result ? result : cacheInsert(key, version, getNodesWithProperty(prop_name, prop_value));
+}
+
+// Cached getNodesWithPropertyValue (depends on the values of all the properties)
+NodeSetPtr GraphDb :: cachedNodesWithPropertyValue (std::string_view prop_value)
+{
+	std::string key = cacheKey("V", prop_value);
+	NodeSetPtr result = cacheFind(key, _value_version);
+	return result ? result : cacheInsert(key, _value_version, getNodesWithPropertyValue(prop_value));
+}
+
+// Cached getNodesOfTypeWithProperty (depends on the nodes of the type and on the values of the property)
+NodeSetPtr GraphDb :: cachedNodesOfTypeWithProperty (std::string_view type, std::string_view prop_name)
+{
+	std::string key = cacheKey("TP", type, prop_name);
+	unsigned long long version = std::max(typeVersion(type), propVersion(prop_name));
+	NodeSetPtr result = cacheFind(key, version);
+	return result ? result : cacheInsert(key, version, getNodesOfTypeWithProperty(type, prop_name));
+}
+
+NodeSetPtr GraphDb :: cachedNodesOfTypeWithProperty (std::string_view type, std::string_view prop_name, std::string_view prop_value)
+{
+	std::string key = cacheKey("TPV", type, prop_name, prop_value);
+	unsigned long long version = std::max(typeVersion(type), propVersion(prop_name));
+	NodeSetPtr result = cacheFind(key, version);
+	return result ? result : cacheInsert(key, version, getNodesOfTypeWithProperty(type, prop_name, prop_value));
+}
+
+// Detach an arc from its nodes and erase it
+void GraphDb :: removeArc (std::map<std::string, Arc>::iterator it)
+{
+	// Views are told about the arc while it is still attached to both nodes
+	Arc * arc = &it->second;
+	for (size_t i = 0; i < _views.size(); i++) {
+		_views[i]->arcErased(*arc);
+	}
+	arc->fromNode()->eraseArc(arc);
+	arc->toNode()->eraseArc(arc);
+	_arcs.erase(it);
+}
+
+// Erase a node, its arcs and its index entries: O(degree + properties) (with log factors)
+void GraphDb :: removeNode (Node * node)
+{
+	while (!node->arcs().empty()) {
+		removeArc(_arcs.find((*node->arcs().begin())->unique_id()));
+	}
+	releaseNode(node->unique_id());
+}
+
+// Drop the free slots at the end of the node storage (other slots keep their address)
+void GraphDb :: trimSlots ()
+{
+	if (_nodes.empty() || _slot_used.back()) {
+		return;
+	}
+	while (!_nodes.empty() && !_slot_used.back()) {
+		_nodes.pop_back();
+		_slot_used.pop_back();
+	}
+	size_t nb_free = 0;
+	for (size_t i = 0; i < _free_slots.size(); i++) {
+		if (_free_slots[i] < (int) _nodes.size()) {
+			_free_slots[nb_free++] = _free_slots[i];
+		}
+	}
+	_free_slots.resize(nb_free);
+}
+
 // Removes a node and the input and output arcs
 void GraphDb :: eraseNode (int node_id)
 {
-	if (_nodes.find(node_id) == _nodes.end()) {
-		Node & current_node = _nodes[node_id];
-		std::set<std::string> arc_to_remove;
-		for (std::set<Arc *>::const_iterator it = current_node.arcs().begin(); it != current_node.arcs().end(); it++) {
-			arc_to_remove.insert((*it)->unique_id());
-			_nodes[(*it)->fromNode()->unique_id()].eraseArc((*it)->unique_id());
-		}
-		for (std::set<std::string>::iterator it = arc_to_remove.begin(); it != arc_to_remove.end(); it++) {
-			_arcs.erase(_arcs.find(*it));
+	TGDB_OP_SCOPE(STAT_ERASE_NODE);
+	Node * current_node = findNode(node_id);
+	if (current_node != NULL) {
+		removeNode(current_node);
+	}
+}
+
+// Removes a set of nodes and their arcs (unknown ids are ignored), then trims the node storage
+void GraphDb :: eraseNodes (const std::vector<int> & node_ids)
+{
+	TGDB_OP_SCOPE(STAT_ERASE_NODES);
+	for (size_t i = 0; i < node_ids.size(); i++) {
+		Node * node = findNode(node_ids[i]);
+		if (node != NULL) {
+			removeNode(node);
 		}
-		_nodes.erase(_nodes.find(node_id));
 	}
+	trimSlots();
+}
+
+// Removes the arc with the given unique id
+void GraphDb :: eraseArc (const std::string & arc_id)
+{
+	TGDB_OP_SCOPE(STAT_ERASE_ARC);
+	std::map<std::string, Arc>::iterator it = _arcs.find(arc_id);
+	if (it == _arcs.end()) {
+		std::stringstream error_message;
+		error_message << "Arc \'" << arc_id << "\' does not exist";
+		throw std::runtime_error(error_message.str());
+	}
+	removeArc(it);
+}
 
+// Removes the arc of the given type from from_id to to_id
+void GraphDb :: eraseArc (int from_id, std::string_view type, int to_id)
+{
+	std::string unique_id = arcId(from_id, type, to_id);
+	eraseArc(unique_id);
 }
 
 // Return the policy of the GraphDb
@@ -911,32 +2770,523 @@ const Policy & GraphDb :: policy () const
 // Return the number of nodes in the GraphDb
 int GraphDb :: nbNode()
 {
-	return (int) _nodes.size();
+	return (int) _counts.nodes();
 }
 
 // Return the number of arcs in the GraphDb
 int GraphDb :: nbArc()
 {
-	return (int) _arcs.size();
+	return (int) _counts.arcs();
+}
+
+// Register an aggregate view and build it from the current graph
+void GraphDb :: addView (AggregateView * view)
+{
+	view->build(*this);
+	_views.push_back(view);
+}
+
+// Unregister an aggregate view (it is not updated anymore)
+void GraphDb :: removeView (AggregateView * view)
+{
+	for (size_t i = 1; i < _views.size(); i++) {
+		if (_views[i] == view) {
+			_views.erase(_views.begin() + i);
+			return;
+		}
+	}
+}
+
+// Return the estimated memory footprint of each structure and of the nodes and arcs of each type
+MemoryReport GraphDb :: memoryUsage () const
+{
+	StringPool & pool = StringPool::instance();
+	MemoryReport report;
+	
+	// Nodes (a node of a type counts its slot, its properties and its arc set)
+	MemoryUsage nodes("nodes", _counts.nodes(), dequeBytes<Node>(_nodes.size()));
+	MemoryUsage node_properties("node_properties");
+	MemoryUsage node_arcs("node_arc_sets");
+	std::map<int, MemoryUsage> node_types;
+	for (size_t slot = 0; slot < _nodes.size(); slot++) {
+		if (!_slot_used[slot]) {
+			continue;
+		}
+		const Node & node = _nodes[slot];
+		size_t properties = node.properties().heapBytes();
+		size_t arcs = node.arcs().size() * treeNodeBytes<Arc *>();
+		node_properties.entries += node.properties().size();
+		node_properties.bytes += properties;
+		node_arcs.entries += node.arcs().size();
+		node_arcs.bytes += arcs;
+		MemoryUsage & usage = node_types[node.typeId()];
+		usage.entries++;
+		usage.bytes += sizeof(Node) + properties + arcs;
+	}
+	MemoryUsage slots("node_slots", _nodes.size());
+	slots.bytes = _slot_used.capacity() * sizeof(char) + (_free_slots.capacity() + _free_ids.capacity() + _dense_slot.capacity()) * sizeof(int);
+	slots.bytes += _sparse_slot.size() * hashNodeBytes<std::pair<const int, int> >(false) + _sparse_slot.bucket_count() * sizeof(void *);
+	
+	// Arcs (an arc of a type counts its map node, its id and its properties)
+	MemoryUsage arcs("arcs", _arcs.size());
+	MemoryUsage arc_properties("arc_properties");
+	std::map<int, MemoryUsage> arc_types;
+	for (std::map<std::string, Arc>::const_iterator it = _arcs.begin(); it != _arcs.end(); it++) {
+		size_t bytes = treeNodeBytes<std::map<std::string, Arc>::value_type>() + stringBytes(it->first);
+		size_t properties = it->second.properties().heapBytes();
+		arcs.bytes += bytes;
+		arc_properties.entries += it->second.properties().size();
+		arc_properties.bytes += properties;
+		MemoryUsage & usage = arc_types[it->second.typeId()];
+		usage.entries++;
+		usage.bytes += bytes + properties;
+	}
+	
+	// Indexes
+	MemoryUsage types_index("node_types");
+	addIndexUsage(_node_types, types_index);
+	MemoryUsage props_index("props");
+	for (std::map<std::string, IdIndex, std::less<> >::const_iterator it = _props.begin(); it != _props.end(); it++) {
+		props_index.bytes += treeNodeBytes<std::map<std::string, IdIndex, std::less<> >::value_type>() + stringBytes(it->first);
+		addIndexUsage(it->second, props_index);
+	}
+	MemoryUsage rev_props_index("rev_props");
+	addIndexUsage(_rev_props, rev_props_index);
+	
+	report.structures.push_back(nodes);
+	report.structures.push_back(node_properties);
+	report.structures.push_back(node_arcs);
+	report.structures.push_back(slots);
+	report.structures.push_back(arcs);
+	report.structures.push_back(arc_properties);
+	report.structures.push_back(types_index);
+	report.structures.push_back(props_index);
+	report.structures.push_back(rev_props_index);
+	// The pool is shared by all the GraphDb of the process
+	report.structures.push_back(MemoryUsage("string_pool", pool.size(), pool.memoryUsage()));
+	
+	for (std::map<int, MemoryUsage>::iterator it = node_types.begin(); it != node_types.end(); it++) {
+		it->second.name = pool.str(it->first);
+		report.node_types.push_back(it->second);
+	}
+	for (std::map<int, MemoryUsage>::iterator it = arc_types.begin(); it != arc_types.end(); it++) {
+		it->second.name = pool.str(it->first);
+		report.arc_types.push_back(it->second);
+	}
+	return report;
+}
+
+// Release the slack of the containers and return the number of bytes released (estimate)
+// Node addresses do not change: only trailing free slots are dropped from the node storage
+size_t GraphDb :: shrink ()
+{
+	size_t before = memoryUsage().total();
+	
+	trimSlots();
+	for (size_t slot = 0; slot < _nodes.size(); slot++) {
+		if (_slot_used[slot]) {
+			_nodes[slot].shrink();
+		}
+	}
+	for (std::map<std::string, Arc>::iterator it = _arcs.begin(); it != _arcs.end(); it++) {
+		it->second.shrink();
+	}
+	_slot_used.shrink_to_fit();
+	_free_slots.shrink_to_fit();
+	_free_ids.shrink_to_fit();
+	_dense_slot.shrink_to_fit();
+	_sparse_slot.rehash(0);
+	
+	size_t after = memoryUsage().total();
+	return before > after ? before - after : 0;
+}
+
+
+// Return true if the diff has no change
+bool GraphDiff :: empty () const
+{
+	return added_nodes.empty() && updated_nodes.empty() && replaced_nodes.empty() && erased_nodes.empty() && added_arcs.empty() && updated_arcs.empty() && erased_arcs.empty();
+}
+
+std::string ReloadSummary :: toText () const
+{
+	std::stringstream text;
+	text << "nodes: " << nodes_added << " added, " << nodes_updated << " updated, " << nodes_replaced << " replaced, " << nodes_erased << " erased, " << nodes_unchanged << " unchanged\n";
+	text << "arcs: " << arcs_added << " added, " << arcs_updated << " updated, " << arcs_erased << " erased, " << arcs_unchanged << " unchanged\n";
+	text << "errors: " << errors << "\n";
+	return text.str();
+}
+
+// Split the fields of a node or arc line (nb_fixed fields, then property name and value pairs)
+static void readDiffLine (const std::string & line, size_t nb_fixed, std::vector<std::string> & fields, GraphDiff::Properties & properties)
+{
+	fields = chomp_line(line, '\t');
+	for (std::vector<std::string>::iterator it = fields.begin(); it != fields.end(); it++) {
+		rem_spaces(*it);
+	}
+	if (fields.size() < nb_fixed) {
+		std::stringstream error_message;
+		error_message << "Not enough fields in \'" << line << "\'";
+		throw std::runtime_error(error_message.str());
+	}
+	if ((fields.size() - nb_fixed) % 2 != 0) {
+		std::stringstream error_message;
+		error_message << "Cannot find property value in \'" << line << "\'";
+		throw std::runtime_error(error_message.str());
+	}
+	properties.clear();
+	for (size_t i = nb_fixed; i < fields.size(); i += 2) {
+		properties.push_back(std::make_pair(fields[i], fields[i + 1]));
+	}
+}
+
+// Compare stored properties with the properties of a line (without interning: a string missing from the pool is a change)
+bool GraphDb :: sameProperties (const PropertyView & properties, const GraphDiff::Properties & pairs, const PropTypeMap * types) const
+{
+	StringPool & pool = StringPool::instance();
+	std::vector<PropEntry> entries;
+	entries.reserve(pairs.size());
+	for (GraphDiff::Properties::const_iterator it = pairs.begin(); it != pairs.end(); it++) {
+		PropType type = PROP_STRING;
+		if (types != NULL) {
+			PropTypeMap::const_iterator it_type = types->find(it->first);
+			if (it_type != types->end()) {
+				type = it_type->second;
+			}
+		}
+		int name = pool.lookup(it->first);
+		if (name < 0) {
+			return false;
+		}
+		if (type == PROP_STRING) {
+			int value = pool.lookup(it->second);
+			if (value < 0) {
+				return false;
+			}
+			entries.push_back(PropEntry::make(name, value));
+		} else {
+			entries.push_back(PropEntry::make(name, PropValue::parse(type, it->second)));
+		}
+	}
+	std::sort(entries.begin(), entries.end());
+	entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+	if (entries.size() != properties.size()) {
+		return false;
+	}
+	PropertyView::const_iterator it_prop = properties.begin();
+	for (size_t i = 0; i < entries.size(); i++, it_prop++) {
+		if (!(entries[i] == *it_prop)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Read a .tgdb file and compare it with the graph (the graph is not changed, the policy of the file is ignored)
+GraphDiff GraphDb :: diff (std::string fname)
+{
+	TGDB_TRACE_SCOPE("diff");
+	GraphDiff diff;
+	InputStream infile(fname);
+	if (!infile.good()) {
+		std::stringstream error_message;
+		error_message << "Cannot open file " << fname;
+		throw std::runtime_error(error_message.str());
+	}
+	
+	StringPool & pool = StringPool::instance();
+	std::unordered_set<const Node *> seen_nodes;
+	std::unordered_set<const Arc *> seen_arcs;
+	std::unordered_set<int> replaced;
+	seen_nodes.reserve(nbNode());
+	seen_arcs.reserve(nbArc());
+	
+	std::string line;
+	std::vector<std::string> fields;
+	GraphDiff::Properties properties;
+	bool in_nodes = false;
+	bool in_rel = false;
+	while (getline(infile, line)) {
+		rem_spaces(line);
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		if (line.compare("Nodes") == 0) {
+			in_nodes = true;
+			in_rel = false;
+			continue;
+		}
+		if (line.compare("Relations") == 0) {
+			in_rel = true;
+			in_nodes = false;
+			continue;
+		}
+		try {
+			if (in_nodes) {
+				readDiffLine(line, 2, fields, properties);
+				int node_id = atoi(fields[1].c_str());
+				Node * node = findNode(node_id);
+				if (node == NULL) {
+					GraphDiff::NodeLine added = {node_id, fields[0], properties};
+					diff.added_nodes.push_back(added);
+					continue;
+				}
+				// Seen first: an unreadable line keeps the node
+				seen_nodes.insert(node);
+				GraphDiff::NodeLine changed = {node_id, fields[0], properties};
+				if (pool.lookup(fields[0]) != node->typeId()) {
+					replaced.insert(node_id);
+					diff.replaced_nodes.push_back(changed);
+				} else if (!sameProperties(node->properties(), properties, _policy.propertyTypes(fields[0]))) {
+					diff.updated_nodes.push_back(changed);
+				} else {
+					diff.unchanged_nodes++;
+				}
+			} else if (in_rel) {
+				readDiffLine(line, 3, fields, properties);
+				int from_id = atoi(fields[0].c_str());
+				int to_id = atoi(fields[2].c_str());
+				GraphDiff::ArcLine arc_line = {from_id, fields[1], to_id, properties};
+				std::string unique_id = arcId(from_id, fields[1], to_id);
+				std::map<std::string, Arc>::iterator it = _arcs.find(unique_id);
+				if (it == _arcs.end() || replaced.count(from_id) > 0 || replaced.count(to_id) > 0) {
+					diff.added_arcs.push_back(arc_line);
+					continue;
+				}
+				seen_arcs.insert(&it->second);
+				if (!sameProperties(it->second.properties(), properties, _policy.propertyTypes(fields[1]))) {
+					diff.updated_arcs.push_back(arc_line);
+				} else {
+					diff.unchanged_arcs++;
+				}
+			}
+		} catch (std::exception & e) {
+			diff.errors++;
+			std::cerr << "Diff: " << e.what() << " -> ignore line\n";
+		}
+	}
+	
+	// Nodes and arcs missing from the file
+	for (size_t slot = 0; slot < _nodes.size(); slot++) {
+		if (_slot_used[slot] && seen_nodes.count(&_nodes[slot]) == 0) {
+			diff.erased_nodes.push_back(_nodes[slot].unique_id());
+		}
+	}
+	for (std::map<std::string, Arc>::iterator it = _arcs.begin(); it != _arcs.end(); it++) {
+		const Arc & arc = it->second;
+		if (seen_arcs.count(&arc) > 0) {
+			continue;
+		}
+		bool node_goes = seen_nodes.count(arc.fromNode()) == 0 || seen_nodes.count(arc.toNode()) == 0
+			|| replaced.count(arc.fromNode()->unique_id()) > 0 || replaced.count(arc.toNode()->unique_id()) > 0;
+		if (!node_goes) {
+			diff.erased_arcs.push_back(it->first);
+		}
+	}
+	return diff;
+}
+
+// Turn GraphDiff properties into (name, value) views
+static PropertyPairs propertyPairs (const GraphDiff::Properties & properties)
+{
+	PropertyPairs pairs;
+	pairs.reserve(properties.size());
+	for (GraphDiff::Properties::const_iterator it = properties.begin(); it != properties.end(); it++) {
+		pairs.push_back(std::make_pair(std::string_view(it->first), std::string_view(it->second)));
+	}
+	return pairs;
 }
 
+// Apply a diff: erase, then add and update (a rejected change is counted as an error and skipped)
+ReloadSummary GraphDb :: apply (const GraphDiff & diff)
+{
+	TGDB_TRACE_SCOPE("apply");
+	ReloadSummary summary;
+	summary.nodes_unchanged = diff.unchanged_nodes;
+	summary.arcs_unchanged = diff.unchanged_arcs;
+	summary.errors = diff.errors;
+	
+	// Erase arcs, then nodes (with their remaining arcs)
+	for (size_t i = 0; i < diff.erased_arcs.size(); i++) {
+		std::map<std::string, Arc>::iterator it = _arcs.find(diff.erased_arcs[i]);
+		if (it != _arcs.end()) {
+			removeArc(it);
+			summary.arcs_erased++;
+		}
+	}
+	for (size_t i = 0; i < diff.updated_arcs.size(); i++) {
+		const GraphDiff::ArcLine & arc = diff.updated_arcs[i];
+		std::map<std::string, Arc>::iterator it = _arcs.find(arcId(arc.from_id, arc.type, arc.to_id));
+		if (it != _arcs.end()) {
+			removeArc(it);
+		}
+	}
+	for (size_t i = 0; i < diff.erased_nodes.size(); i++) {
+		Node * node = findNode(diff.erased_nodes[i]);
+		if (node != NULL) {
+			removeNode(node);
+			summary.nodes_erased++;
+		}
+	}
+	for (size_t i = 0; i < diff.replaced_nodes.size(); i++) {
+		Node * node = findNode(diff.replaced_nodes[i].id);
+		if (node != NULL) {
+			removeNode(node);
+		}
+	}
+	
+	// Add nodes
+	const std::vector<GraphDiff::NodeLine> * added[2] = {&diff.replaced_nodes, &diff.added_nodes};
+	long long * added_counts[2] = {&summary.nodes_replaced, &summary.nodes_added};
+	for (int a = 0; a < 2; a++) {
+		for (size_t i = 0; i < added[a]->size(); i++) {
+			const GraphDiff::NodeLine & node = (*added[a])[i];
+			try {
+				newNodeWithId(node.id, node.type, propertyPairs(node.properties));
+				(*added_counts[a])++;
+			} catch (std::exception & e) {
+				summary.errors++;
+				std::cerr << "Apply node: " << e.what() << " -> ignore node\n";
+			}
+		}
+	}
+	
+	// Update the properties of the other nodes, one property name at a time
+	for (size_t i = 0; i < diff.updated_nodes.size(); i++) {
+		const GraphDiff::NodeLine & line = diff.updated_nodes[i];
+		Node * node = findNode(line.id);
+		if (node == NULL) {
+			continue;
+		}
+		try {
+			PropertyList properties(propertyPairs(line.properties), _policy.propertyTypes(node->type()));
+			std::set<int> names;
+			for (const PropEntry * it = properties.begin(); it != properties.end(); it++) {
+				names.insert(it->name);
+			}
+			PropertyView current = node->properties();
+			for (PropertyView::const_iterator it = current.begin(); it != current.end(); it++) {
+				names.insert(it->name);
+			}
+			for (std::set<int>::iterator it_name = names.begin(); it_name != names.end(); it_name++) {
+				PropertyValues old_values = current.values(*it_name);
+				PropertyValues new_values = properties.values(*it_name);
+				bool same = old_values.size() == new_values.size();
+				for (PropertyValues::const_iterator it_old = old_values.begin(), it_new = new_values.begin(); same && it_old != old_values.end(); it_old++, it_new++) {
+					same = it_old.entry() == it_new.entry();
+				}
+				if (same) {
+					continue;
+				}
+				eraseProperty(line.id, StringPool::instance().str(*it_name));
+				for (PropertyValues::const_iterator it = new_values.begin(); it != new_values.end(); it++) {
+					if (node->addProperty(it.entry())) {
+						indexProperty(*node, it.entry());
+					}
+				}
+			}
+			summary.nodes_updated++;
+		} catch (std::exception & e) {
+			summary.errors++;
+			std::cerr << "Apply node: " << e.what() << " -> ignore node\n";
+		}
+	}
+	
+	// Add arcs
+	const std::vector<GraphDiff::ArcLine> * arcs[2] = {&diff.updated_arcs, &diff.added_arcs};
+	long long * arc_counts[2] = {&summary.arcs_updated, &summary.arcs_added};
+	for (int a = 0; a < 2; a++) {
+		for (size_t i = 0; i < arcs[a]->size(); i++) {
+			const GraphDiff::ArcLine & arc = (*arcs[a])[i];
+			try {
+				addArc(arc.from_id, arc.type, arc.to_id, propertyPairs(arc.properties));
+				(*arc_counts[a])++;
+			} catch (std::exception & e) {
+				summary.errors++;
+				std::cerr << "Apply arc: " << e.what() << " -> ignore arc\n";
+			}
+		}
+	}
+	return summary;
+}
 
 // Save the GraphDb in the given file
 void GraphDb :: save (std::string fname)
 {
+	if (compressionOf(fname) != COMPRESSION_NONE) {
+		save(fname, 1);
+		return;
+	}
+	TGDB_OP_SCOPE(STAT_SAVE);
 	std::ofstream outfile;
 	outfile.open (fname.c_str());
 	
-	_policy.print(outfile);
-	outfile << "\nNodes\n\n";
-	for (std::map<int, Node>::iterator it = _nodes.begin(); it != _nodes.end(); it++) {
-		it->second.print(outfile);
+	{
+		TGDB_TRACE_SCOPE("save.policy");
+		_policy.print(outfile);
 	}
-	outfile << "\nRelations\n\n";
-	for (std::map<std::string, Arc>::iterator it = _arcs.begin(); it != _arcs.end(); it++) {
-		it->second.print(outfile);
+	{
+		TGDB_TRACE_SCOPE("save.nodes");
+		outfile << "\nNodes\n\n";
+		for (size_t slot = 0; slot < _nodes.size(); slot++) {
+			if (_slot_used[slot]) {
+				_nodes[slot].print(outfile);
+			}
+		}
 	}
+	{
+		TGDB_TRACE_SCOPE("save.relations");
+		outfile << "\nRelations\n\n";
+		for (std::map<std::string, Arc>::iterator it = _arcs.begin(); it != _arcs.end(); it++) {
+			it->second.print(outfile);
+		}
+	}
+}
+
+// Save the GraphDb in chunks of SAVE_CHUNK_SIZE nodes or arcs, formatted in parallel and written in order
+void GraphDb :: save (std::string fname, int nb_threads)
+{
+	TGDB_OP_SCOPE(STAT_SAVE);
+	const size_t SAVE_CHUNK_SIZE = 4096;
+	
+	// Chunk 0: policy, chunks of nodes (by slots), relations header, chunks of arcs
+	std::vector<size_t> node_bounds;
+	for (size_t slot = 0; slot < _nodes.size(); slot += SAVE_CHUNK_SIZE) {
+		node_bounds.push_back(slot);
+	}
+	node_bounds.push_back(_nodes.size());
+	std::vector<std::map<std::string, Arc>::iterator> arc_bounds;
+	size_t nb_arcs = 0;
+	for (std::map<std::string, Arc>::iterator it = _arcs.begin(); it != _arcs.end(); it++, nb_arcs++) {
+		if (nb_arcs % SAVE_CHUNK_SIZE == 0) {
+			arc_bounds.push_back(it);
+		}
+	}
+	arc_bounds.push_back(_arcs.end());
+	size_t nb_node_chunks = node_bounds.size() - 1;
+	size_t nb_arc_chunks = arc_bounds.size() - 1;
 	
+	writeChunks(fname, nb_node_chunks + nb_arc_chunks + 2, nb_threads, [&](size_t chunk, std::string & buffer) {
+		std::ostringstream out;
+		if (chunk == 0) {
+			_policy.print(out);
+			out << "\nNodes\n\n";
+		} else if (chunk <= nb_node_chunks) {
+			for (size_t slot = node_bounds[chunk - 1]; slot < node_bounds[chunk]; slot++) {
+				if (_slot_used[slot]) {
+					_nodes[slot].print(out);
+				}
+			}
+		} else if (chunk == nb_node_chunks + 1) {
+			out << "\nRelations\n\n";
+		} else {
+			size_t arc_chunk = chunk - nb_node_chunks - 2;
+			for (std::map<std::string, Arc>::iterator it = arc_bounds[arc_chunk]; it != arc_bounds[arc_chunk + 1]; it++) {
+				it->second.print(out);
+			}
+		}
+		buffer = out.str();
+	});
 }
 
 // Print the GraphDb on stdout
@@ -944,8 +3294,10 @@ void GraphDb :: print ()
 {
 	_policy.print();
 	std::cout << "\nNodes\n\n";
-	for (std::map<int, Node>::iterator it = _nodes.begin(); it != _nodes.end(); it++) {
-		it->second.print();
+	for (size_t slot = 0; slot < _nodes.size(); slot++) {
+		if (_slot_used[slot]) {
+			_nodes[slot].print();
+		}
 	}
 	std::cout << "\nRelations\n\n";
 	for (std::map<std::string, Arc>::iterator it = _arcs.begin(); it != _arcs.end(); it++) {
@@ -29,12 +29,25 @@
 #include <stdexcept>
 #include <iostream>
 #include <utility>
+#include <iterator>
 #include <sstream>
 #include <fstream>
 #include <vector>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
 #include <string>
+#include <string_view>
 #include <map>
 #include <set>
+#include <unordered_map>
+#include <tuple>
+
+#include "stats.h"
+#include "trace.h"
 
 void rem_spaces(std::string & str);
 void rem_tab(std::string & str);
@@ -47,67 +60,394 @@ namespace tinygraphdb
 	class GraphDb;
 	class Policy;
 	
+	// Set of strings searchable with a std::string_view (no temporary string)
+	typedef std::set<std::string, std::less<> > StringSet;
+	// Property (name, value) pairs given without building a map
+	typedef std::vector<std::pair<std::string_view, std::string_view> > PropertyPairs;
+	
+	
+	/*******************************************************************************
+	 * StringPool Class
+	 *
+	 * _chunks : Interned strings by chunks of CHUNK_SIZE, the id of a string is
+	 *           its index (a chunk never moves: str() reads without locking)
+	 * _size   : Number of ids given (freed ones included)
+	 * _ids    : String to id (views on the chunks)
+	 * _free   : Ids of the freed strings, given again to new strings
+	 * _mutex  : lookup shares it, adding or freeing a string takes it alone
+	 *
+	 * Property names and values, node types and arc types of every GraphDb are
+	 * interned in a shared pool, so that each distinct string is stored once and
+	 * compared as an int. The pool can be used by several threads, each changing
+	 * its own GraphDb. Names and types (intern) stay in the pool. Values are
+	 * counted (acquire, retain, release): a PropertyList holds a reference on
+	 * each of its string values, and a value no longer held is freed.
+	 *******************************************************************************/
+	class StringPool
+	{
+	public:
+		static const int CHUNK_BITS = 12;
+		static const int CHUNK_SIZE = 1 << CHUNK_BITS;
+		static const int MAX_CHUNKS = 1 << 16;
+		
+	private:
+		struct Entry
+		{
+			std::string str;
+			std::atomic<int> refs;
+			bool pinned;
+			bool live;
+		};
+		
+		std::unique_ptr<std::atomic<Entry *>[]> _chunks;
+		int _size;
+		std::unordered_map<std::string_view, int> _ids; // views on the chunks
+		std::vector<int> _free;
+		mutable std::shared_mutex _mutex;
+		
+		Entry & entry (int id) const {return _chunks[id >> CHUNK_BITS].load(std::memory_order_acquire)[id & (CHUNK_SIZE - 1)];};
+		int add (std::string_view str);
+		
+	public:
+		// Constructor //
+		StringPool (): _chunks(new std::atomic<Entry *>[MAX_CHUNKS]()), _size(0) {};
+		
+		// Adders //
+		int intern (std::string_view str);
+		int acquire (std::string_view str);
+		void retain (int id) {entry(id).refs.fetch_add(1, std::memory_order_relaxed);};
+		void release (int id);
+		
+		// Getters //
+		int lookup (std::string_view str) const;
+		const std::string & str (int id) const {return entry(id).str;};
+		int size () const;
+		size_t memoryUsage () const;
+		
+		static StringPool & instance ();
+	};
+	
+	
+	/*******************************************************************************
+	 * PropType enum
+	 *
+	 * Type of a property value. Strings are interned, other values are stored
+	 * natively. Types are declared per node/arc type in the policy (default is
+	 * PROP_STRING).
+	 *******************************************************************************/
+	enum PropType
+	{
+		PROP_STRING = 0,
+		PROP_INT    = 1,
+		PROP_DOUBLE = 2,
+		PROP_BOOL   = 3
+	};
+	
+	const char * propTypeName (PropType type);
+	PropType propTypeFromName (const std::string & name);
+	
+	// Declared property types of a node or arc type
+	typedef std::map<std::string, PropType, std::less<> > PropTypeMap;
+	
+	
+	/*******************************************************************************
+	 * PropValue Class
+	 *
+	 * A typed (non string) property value used by typed queries and adders
+	 *******************************************************************************/
+	class PropValue
+	{
+	private:
+		PropType _type;
+		union {
+			long long _int;
+			double _double;
+		};
+		
+	public:
+		// Constructors //
+		PropValue (int value): _type(PROP_INT), _int(value) {};
+		PropValue (long long value): _type(PROP_INT), _int(value) {};
+		PropValue (double value): _type(PROP_DOUBLE), _double(value) {};
+		explicit PropValue (bool value): _type(PROP_BOOL), _int(value ? 1 : 0) {};
+		
+		static PropValue parse (PropType type, std::string_view text);
+		
+		// Getters //
+		PropType type () const {return _type;};
+		long long asInt () const {return _type == PROP_DOUBLE ? (long long) _double : _int;};
+		double asDouble () const {return _type == PROP_DOUBLE ? _double : (double) _int;};
+		bool asBool () const {return _type == PROP_DOUBLE ? _double != 0 : _int != 0;};
+		std::string text () const;
+		
+		// Checkers //
+		bool isNumeric () const {return _type == PROP_INT || _type == PROP_DOUBLE;};
+		bool operator== (const PropValue & other) const;
+	};
+	
+	
+	/*******************************************************************************
+	 * PropEntry struct
+	 *
+	 * name  : Interned property name
+	 * type  : Type of the value (PropType)
+	 * value : Interned string id, integer, boolean (as integer) or double
+	 *******************************************************************************/
+	struct PropEntry
+	{
+		int name;
+		int type;
+		union {
+			int str;
+			long long integer;
+			double real;
+		} value;
+		
+		static PropEntry make (int name, int str);
+		static PropEntry make (int name, const PropValue & value);
+		
+		PropValue typed () const;
+		std::string text () const;
+		
+		bool operator< (const PropEntry & other) const;
+		bool operator== (const PropEntry & other) const;
+	};
+	
+	
+	/*******************************************************************************
+	 * PropertyValues Class
+	 *
+	 * Read-only view on the values of one property (a range of sorted entries).
+	 * Values are given as text, typed values are formatted on the fly.
+	 *******************************************************************************/
+	class PropertyValues
+	{
+	private:
+		const PropEntry * _begin;
+		const PropEntry * _end;
+		
+	public:
+		class const_iterator
+		{
+		private:
+			const PropEntry * _it;
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef std::string value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const std::string * pointer;
+			typedef std::string reference;
+			
+			explicit const_iterator (const PropEntry * it): _it(it) {};
+			std::string operator* () const {return _it->text();};
+			const PropEntry & entry () const {return *_it;};
+			const_iterator & operator++ () {_it++; return *this;};
+			const_iterator operator++ (int) {const_iterator tmp(*this); _it++; return tmp;};
+			bool operator== (const const_iterator & other) const {return _it == other._it;};
+			bool operator!= (const const_iterator & other) const {return _it != other._it;};
+		};
+		
+		PropertyValues (): _begin(NULL), _end(NULL) {};
+		PropertyValues (const PropEntry * begin, const PropEntry * end): _begin(begin), _end(end) {};
+		
+		const_iterator begin () const {return const_iterator(_begin);};
+		const_iterator end () const {return const_iterator(_end);};
+		size_t size () const {return _end - _begin;};
+		bool empty () const {return _begin == _end;};
+		size_t count (std::string_view value) const;
+		size_t count (const PropValue & value) const;
+		
+		// Typed getters (first value, throw an exception if it is not of the given type) //
+		PropType type () const;
+		long long asInt () const;
+		double asDouble () const;
+		bool asBool () const;
+		
+		operator std::set<std::string> () const {return std::set<std::string>(begin(), end());};
+	};
+	
+	
+	/*******************************************************************************
+	 * PropertyList Class
+	 *
+	 * Sorted (name, value) entries of a node or an arc. Up to INLINE_SIZE entries
+	 * are stored inside the object, larger lists are moved to the heap. The list
+	 * holds a reference on each of its string values in the StringPool: inserted
+	 * or copied values are retained, erased or destroyed ones released.
+	 *******************************************************************************/
+	class PropertyList
+	{
+	public:
+		static const unsigned INLINE_SIZE = 4;
+		
+	private:
+		PropEntry * _data;
+		unsigned _size;
+		unsigned _capacity;
+		PropEntry _inline[INLINE_SIZE];
+		
+		void reserve (unsigned capacity);
+		void dedupe ();
+		
+	public:
+		// Constructor & destructor //
+		PropertyList (): _data(_inline), _size(0), _capacity(INLINE_SIZE) {};
+		explicit PropertyList (const std::map<std::string, std::set<std::string> > & properties, const PropTypeMap * types = NULL);
+		explicit PropertyList (const PropertyPairs & properties, const PropTypeMap * types = NULL);
+		PropertyList (const PropertyList & other);
+		PropertyList (PropertyList && other);
+		PropertyList & operator= (const PropertyList & other);
+		PropertyList & operator= (PropertyList && other);
+		~PropertyList ();
+		
+		// Adders //
+		bool insert (const PropEntry & entry);
+		
+		// Erasers //
+		void erase (int name);
+		void erase (const PropEntry & entry);
+		
+		// Release the unused capacity (entries go back inline when they fit)
+		void shrink ();
+		
+		// Getters //
+		const PropEntry * begin () const {return _data;};
+		const PropEntry * end () const {return _data + _size;};
+		unsigned size () const {return _size;};
+		PropertyValues values (int name) const;
+		bool contains (int name) const;
+		bool contains (const PropEntry & entry) const;
+		
+		// Convert the entries which are not of the declared type of their property (as their text)
+		void conform (const PropTypeMap * types);
+		
+		size_t heapBytes () const {return _data == _inline ? 0 : _capacity * sizeof(PropEntry);};
+	};
+	
+	
+	/*******************************************************************************
+	 * PropertyView Class
+	 *
+	 * Read-only view on all the properties of a node or an arc. Iterating gives
+	 * one (name, value) pair at a time, sorted by name.
+	 *******************************************************************************/
+	class PropertyView
+	{
+	private:
+		const PropertyList * _list;
+		
+	public:
+		class const_iterator
+		{
+		private:
+			const PropEntry * _it;
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef PropEntry value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const PropEntry * pointer;
+			typedef const PropEntry & reference;
+			
+			explicit const_iterator (const PropEntry * it): _it(it) {};
+			const std::string & name () const {return StringPool::instance().str(_it->name);};
+			std::string value () const {return _it->text();};
+			PropType type () const {return (PropType) _it->type;};
+			const PropEntry & operator* () const {return *_it;};
+			const PropEntry * operator-> () const {return _it;};
+			const_iterator & operator++ () {_it++; return *this;};
+			const_iterator operator++ (int) {const_iterator tmp(*this); _it++; return tmp;};
+			bool operator== (const const_iterator & other) const {return _it == other._it;};
+			bool operator!= (const const_iterator & other) const {return _it != other._it;};
+		};
+		
+		explicit PropertyView (const PropertyList & list): _list(&list) {};
+		
+		const_iterator begin () const {return const_iterator(_list->begin());};
+		const_iterator end () const {return const_iterator(_list->end());};
+		size_t size () const {return _list->size();};
+		bool empty () const {return _list->size() == 0;};
+		PropertyValues find (std::string_view name) const;
+		PropertyValues values (int name) const {return _list->values(name);};
+		size_t count (std::string_view name) const {return find(name).empty() ? 0 : 1;};
+		size_t heapBytes () const {return _list->heapBytes();};
+		
+		operator std::map<std::string, std::set<std::string> > () const;
+	};
+	
 	
 	/*******************************************************************************
 	 * Node Class
 	 *
 	 * _unique_id  : A node is uniquely identified by its _unique_id
-	 * _type       : A node has a type which will be used to check policy
-	 * _properties : A node has properties (pairs of strings: name and value)
-	 *               Each property name is unique for a given node
+	 * _type       : A node has a type which will be used to check policy (interned)
+	 * _properties : A node has properties (pairs of interned strings: name and value)
+	 *               A property name can have several values
 	 * _arc_in(out): A node has a set of output arcs and a set of input arcs
 	 *******************************************************************************/
 	class Node
 	{
 	private:
 		int _unique_id;
-		std::string _type;
-		std::map<std::string, std::set<std::string> > _properties;
+		int _type;
+		PropertyList _properties;
 		std::set<Arc *> _arcs;
 
 	public:
 		// Constructor & destructor //
 		Node () {};
-		explicit Node (const int & unique_id, const std::string & type, const std::map<std::string, std::set<std::string> > & properties):_unique_id(unique_id), _type(type), _properties(properties) {};
+		explicit Node (const int & unique_id, const std::string & type, const std::map<std::string, std::set<std::string> > & properties, const PropTypeMap * prop_types = NULL):_unique_id(unique_id), _type(StringPool::instance().intern(type)), _properties(properties, prop_types) {};
+		explicit Node (int unique_id, int type, PropertyList && properties):_unique_id(unique_id), _type(type), _properties(std::move(properties)) {};
+		Node (const Node & other) = default;
+		Node (Node && other) = default;
+		Node & operator= (const Node & other) = default;
+		Node & operator= (Node && other) = default;
 		~Node () {};
 
 		// Adders //
 		void addArc (Arc * arc) {_arcs.insert(arc);};
-		void addProperty (const std::string & property, const std::string & value) {_properties[property].insert(value);};
+		void addProperty (const std::string & property, const std::string & value);
+		void addProperty (const std::string & property, const PropValue & value);
+		bool addProperty (const PropEntry & entry) {return _properties.insert(entry);};
 		
 		// Eraser //
 		void eraseArc (const std::string & arc_id);
-		void eraseProperty (const std::string & property) {_properties.erase(property);};
-		void eraseProperty (const std::string & property, const std::string & value) {_properties[property].erase(_properties[property].find(value));};
+		void eraseArc (Arc * arc) {_arcs.erase(arc);};
+		void eraseProperty (const std::string & property);
+		void eraseProperty (const std::string & property, const std::string & value);
+		void eraseProperty (const std::string & property, const PropValue & value);
+		
+		void shrink () {_properties.shrink();};
 		
 		// Getters //
 		const int & unique_id () const;
 		const std::string & type () const;
-		const std::set<std::string> & property (const std::string & property) const;
-		const std::map<std::string, std::set<std::string> >& properties () const;
+		int typeId () const {return _type;};
+		PropertyValues property (std::string_view property) const;
+		PropertyView properties () const;
 		const std::set<Arc *> & arcs () const {return _arcs;};
 		
-		std::set<Arc *> getArcOfType(const std::string & type);
-		std::set<Node *> getNodeFromArcOfType (std::string type);
+		std::set<Arc *> getArcOfType(std::string_view type);
+		std::set<Node *> getNodeFromArcOfType (std::string_view type);
 		
 		// Checkers //
-		bool hasArcOfType (std::string type);
-		bool hasArcOfTypeToNode (std::string type, Node * node);
-		bool hasProp (const std::string & prop_name, const std::string & prop_value);
-		bool hasProp (const std::string & prop_name);
+		bool hasArcOfType (std::string_view type);
+		bool hasArcOfTypeToNode (std::string_view type, Node * node);
+		bool hasProp (std::string_view prop_name, std::string_view prop_value) const;
+		bool hasProp (std::string_view prop_name) const;
 		
 		// Printers //
 		void print();
-		void print (std::ofstream & outfile);
+		void print (std::ostream & outfile);
 	};
 
 	
 	/*******************************************************************************
 	 * Arc Class
 	 *
-	 * _unique_id : An arc is uniquely identified by its _unique_id
-	 * _type      : An arc has a type which will be used to check policy
-	 * _properties: An arc has properties (pairs of strings)
+	 * _unique_id : An arc is uniquely identified by its _unique_id (the key of the
+	 *              arc in its GraphDb, referenced and not copied)
+	 * _type      : An arc has a type which will be used to check policy (interned)
+	 * _properties: An arc has properties (pairs of interned strings)
 	 * _from_node : An arc has an input node (only one)
 	 * _to_node   : An arc has an output node (only one)
 	 *
@@ -115,32 +455,41 @@ namespace tinygraphdb
 	class Arc
 	{
 	private:
-		std::string _unique_id;
-		std::string _type;
-		std::map<std::string, std::set<std::string> > _properties;
+		const std::string * _unique_id;
+		int _type;
+		PropertyList _properties;
 		Node * _from_node;
 		Node * _to_node;
 		
 	public:
 		// Constructor & destructor //
-		Arc () {};
-		explicit Arc (const std::string & unique_id, const std::string & type, const std::map<std::string, std::set<std::string> > & properties, Node * from, Node * to):_unique_id(unique_id), _type(type), _properties(properties), _from_node(from), _to_node(to) {};
+		Arc (): _unique_id(NULL), _type(-1), _from_node(NULL), _to_node(NULL) {};
+		explicit Arc (const std::string & unique_id, const std::string & type, const std::map<std::string, std::set<std::string> > & properties, Node * from, Node * to, const PropTypeMap * prop_types = NULL):_unique_id(&unique_id), _type(StringPool::instance().intern(type)), _properties(properties, prop_types), _from_node(from), _to_node(to) {};
+		explicit Arc (const std::string & unique_id, int type, PropertyList && properties, Node * from, Node * to):_unique_id(&unique_id), _type(type), _properties(std::move(properties)), _from_node(from), _to_node(to) {};
+		Arc (const Arc & other) = default;
+		Arc (Arc && other) = default;
+		Arc & operator= (const Arc & other) = default;
+		Arc & operator= (Arc && other) = default;
 		~Arc () {};
 
 		// Adders //
-		void addProperty (const std::string & property, const std::string & value) {_properties[property].insert(value);};
+		void addProperty (const std::string & property, const std::string & value);
+		void addProperty (const std::string & property, const PropValue & value);
+		
+		void shrink () {_properties.shrink();};
 		
 		// Getters //
 		const std::string & unique_id () const;
 		const std::string & type () const;
-		const std::set<std::string> & property (const std::string & property) const;
-		const std::map<std::string, std::set<std::string> > & properties () const;
-		Node * fromNode ();
-		Node * toNode ();
+		int typeId () const {return _type;};
+		PropertyValues property (std::string_view property) const;
+		PropertyView properties () const;
+		Node * fromNode () const;
+		Node * toNode () const;
 		
 		// Printers //
 		void print();
-		void print (std::ofstream & outfile);
+		void print (std::ostream & outfile);
 	};
 
 	
@@ -154,43 +503,362 @@ namespace tinygraphdb
 	 *                                   from a node type to a node type through an
 	 *                                   arc_type
 	 *
+	 * _prop_types : A policy can declare the value type of properties per node or
+	 *               arc type (undeclared properties are strings)
+	 *
 	 *******************************************************************************/
 	class Policy
 	{
 	private:
-		std::set<std::string> _node_type;
-		std::set<std::string> _arc_type;
+		StringSet _node_type;
+		StringSet _arc_type;
 
 		std::vector<std::string> _from_type;
 		std::vector<std::string> _arc_link;
 		std::vector<std::string> _to_type;
+		
+		// from_type -> arc_link -> to_types, for quick validity checks
+		std::map<std::string, std::map<std::string, StringSet, std::less<> >, std::less<> > _valid;
+		
+		std::map<std::string, PropTypeMap, std::less<> > _prop_types;
 
 	public:
 		// Adders //
 		void addNodeType (std::string type);
 		void addArcType  (std::string type);
 		void addConstraint (std::string from_type, std::string arc_link, std::string to_type);
+		void addPropertyType (std::string type, std::string prop_name, PropType prop_type);
 		
 		// Getters //
-		const std::set<std::string> & getNodeType () const;
-		const std::set<std::string> & getArcType () const;
+		const StringSet & getNodeType () const;
+		const StringSet & getArcType () const;
 		const std::vector<std::string> & getFromType () const;
 		const std::vector<std::string> & getToType () const;
 		const std::vector<std::string> & getLinkType () const;
+		const PropTypeMap * propertyTypes (std::string_view type) const;
+		PropType propertyType (std::string_view type, std::string_view prop_name) const;
 		
 		// Checkers //
-		bool isNodeType (std::string type);
-		bool isArcType (std::string type);
-		bool isValid (std::string from_type, std::string arc_link, std::string to_type);
+		bool isNodeType (std::string_view type) const;
+		bool isArcType (std::string_view type) const;
+		bool isValid (std::string_view from_type, std::string_view arc_link, std::string_view to_type) const;
 		
 		// Printers //
 		void print ();
-		void print (std::ofstream & outfile);
+		void print (std::ostream & outfile);
 		
 		// Readers //
 		void read (std::string fname);
 	};
 	
+	/*******************************************************************************
+	 * PropertyStats struct
+	 *
+	 * Aggregate of the numeric values of a property over a set of nodes
+	 *******************************************************************************/
+	struct PropertyStats
+	{
+		int count;
+		double sum;
+		double min;
+		double max;
+		
+		PropertyStats (): count(0), sum(0), min(0), max(0) {};
+		double mean () const {return count == 0 ? 0 : sum / count;};
+	};
+	
+	
+	/*******************************************************************************
+	 * MemoryUsage struct
+	 *
+	 * Estimated heap footprint of a structure (or of the nodes/arcs of a type):
+	 * number of entries and bytes, allocator overhead excluded
+	 *******************************************************************************/
+	struct MemoryUsage
+	{
+		std::string name;
+		size_t entries;
+		size_t bytes;
+		
+		MemoryUsage (const std::string & name = "", size_t entries = 0, size_t bytes = 0): name(name), entries(entries), bytes(bytes) {};
+	};
+	
+	struct MemoryReport
+	{
+		std::vector<MemoryUsage> structures;
+		std::vector<MemoryUsage> node_types;
+		std::vector<MemoryUsage> arc_types;
+		
+		size_t total () const;
+		std::string toText () const;
+		std::string toJson () const;
+	};
+	
+	
+	/*******************************************************************************
+	 * AggregateView Class
+	 *
+	 * A view registered in a GraphDb (GraphDb::addView) is told about every change
+	 * of the graph and keeps its aggregate up to date, so that reading it does
+	 * not scan the graph. A node is added before its properties and erased after
+	 * them, its arcs are erased before it (while still attached to both nodes).
+	 *
+	 * build() computes the view from scratch when it is registered (by default,
+	 * it replays the addition of every node, property and arc).
+	 *******************************************************************************/
+	class AggregateView
+	{
+	public:
+		virtual ~AggregateView () {};
+		
+		virtual void clear () = 0;
+		virtual void build (GraphDb & db);
+		
+		// Events //
+		virtual void nodeAdded (const Node &) {};
+		virtual void nodeErased (const Node &) {};
+		virtual void arcAdded (const Arc &) {};
+		virtual void arcErased (const Arc &) {};
+		virtual void propertyAdded (const Node &, const PropEntry &) {};
+		virtual void propertyErased (const Node &, const PropEntry &) {};
+	};
+	
+	
+	/*******************************************************************************
+	 * CountView Class
+	 *
+	 * Number of nodes and arcs (every GraphDb has one for nbNode and nbArc)
+	 *******************************************************************************/
+	class CountView : public AggregateView
+	{
+	private:
+		long long _nodes;
+		long long _arcs;
+		
+	public:
+		CountView (): _nodes(0), _arcs(0) {};
+		
+		void clear () {_nodes = 0; _arcs = 0;};
+		void nodeAdded (const Node &) {_nodes++;};
+		void nodeErased (const Node &) {_nodes--;};
+		void arcAdded (const Arc &) {_arcs++;};
+		void arcErased (const Arc &) {_arcs--;};
+		
+		long long nodes () const {return _nodes;};
+		long long arcs () const {return _arcs;};
+	};
+	
+	
+	/*******************************************************************************
+	 * NodeTypeCountView Class
+	 *
+	 * Number of nodes of each type
+	 *******************************************************************************/
+	class NodeTypeCountView : public AggregateView
+	{
+	private:
+		std::unordered_map<int, long long> _counts; // interned type -> nodes
+		
+	public:
+		void clear () {_counts.clear();};
+		void nodeAdded (const Node & node) {_counts[node.typeId()]++;};
+		void nodeErased (const Node & node) {_counts[node.typeId()]--;};
+		
+		long long count (std::string_view type) const;
+		std::map<std::string, long long> counts () const;
+	};
+	
+	
+	/*******************************************************************************
+	 * TripleCountView Class
+	 *
+	 * Number of arcs of each (from_type, arc_type, to_type) triple of the policy
+	 *******************************************************************************/
+	class TripleCountView : public AggregateView
+	{
+	private:
+		typedef std::tuple<int, int, int> Triple; // interned types
+		std::map<Triple, long long> _counts;
+		
+	public:
+		void clear () {_counts.clear();};
+		void arcAdded (const Arc & arc);
+		void arcErased (const Arc & arc);
+		
+		long long count (std::string_view from_type, std::string_view arc_type, std::string_view to_type) const;
+	};
+	
+	
+	/*******************************************************************************
+	 * DegreeHistogramView Class
+	 *
+	 * Number of nodes of each degree (number of input and output arcs)
+	 *******************************************************************************/
+	class DegreeHistogramView : public AggregateView
+	{
+	private:
+		std::vector<long long> _histogram;
+		
+		void move (int from_degree, int to_degree);
+		
+	public:
+		void clear () {_histogram.clear();};
+		void build (GraphDb & db);
+		void nodeAdded (const Node & node) {move(-1, (int) node.arcs().size());};
+		void nodeErased (const Node & node) {move((int) node.arcs().size(), -1);};
+		void arcAdded (const Arc & arc);
+		void arcErased (const Arc & arc);
+		
+		long long count (int degree) const {return degree >= 0 && degree < (int) _histogram.size() ? _histogram[degree] : 0;};
+		const std::vector<long long> & histogram () const {return _histogram;};
+	};
+	
+	
+	/*******************************************************************************
+	 * PropertyValueCountView Class
+	 *
+	 * Number of nodes having each value of a given property
+	 *******************************************************************************/
+	class PropertyValueCountView : public AggregateView
+	{
+	private:
+		int _name; // interned property name
+		std::map<std::pair<int, long long>, long long> _counts; // (type, value bits) -> nodes
+		
+		static std::pair<int, long long> key (const PropEntry & entry);
+		
+	public:
+		explicit PropertyValueCountView (std::string_view prop_name): _name(StringPool::instance().intern(prop_name)) {};
+		
+		void clear () {_counts.clear();};
+		void propertyAdded (const Node & node, const PropEntry & entry);
+		void propertyErased (const Node & node, const PropEntry & entry);
+		
+		long long count (std::string_view value) const;
+		long long count (const PropValue & value) const;
+		std::map<std::string, long long> counts () const;
+	};
+	
+	
+	/*******************************************************************************
+	 * QueryCache Class
+	 *
+	 * _capacity : Maximum number of results kept (0 disables the cache)
+	 * _entries  : Results, the most recently used first
+	 * _index    : Query key to entry
+	 *
+	 * Bounded LRU cache of query results. An entry keeps the version of the data
+	 * it was computed from and is only returned while this version is current.
+	 * Results are shared and immutable: a hit does not copy the set.
+	 *******************************************************************************/
+	typedef std::shared_ptr<const std::set<Node *> > NodeSetPtr;
+	
+	class QueryCache
+	{
+	private:
+		struct Entry
+		{
+			std::string key;
+			unsigned long long version;
+			NodeSetPtr result;
+		};
+		
+		std::atomic<size_t> _capacity;
+		std::list<Entry> _entries;
+		std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+		std::mutex _mutex;
+		
+	public:
+		QueryCache (): _capacity(0) {};
+		
+		void setCapacity (size_t capacity);
+		size_t capacity () const {return _capacity.load(std::memory_order_relaxed);};
+		size_t size ();
+		void clear ();
+		
+		NodeSetPtr find (const std::string & key, unsigned long long version);
+		void insert (const std::string & key, unsigned long long version, const NodeSetPtr & result);
+	};
+	
+	
+	/*******************************************************************************
+	 * GraphDiff struct
+	 *
+	 * Changes that turn a GraphDb into the graph of a .tgdb file (computed by
+	 * GraphDb::diff, applied by GraphDb::apply). Nodes are matched by id and arcs
+	 * by (from, type, to); only the changes are kept.
+	 *
+	 * added_nodes     : Nodes of the file missing from the graph
+	 * updated_nodes   : Nodes whose properties changed (with their new properties)
+	 * replaced_nodes  : Nodes whose type changed (erased and added again)
+	 * erased_nodes    : Ids of the nodes missing from the file
+	 * added_arcs      : Arcs missing from the graph, or attached to a replaced node
+	 * updated_arcs    : Arcs whose properties changed (erased and added again)
+	 * erased_arcs     : Ids of the arcs missing from the file (the arcs of erased
+	 *                   and replaced nodes go with them)
+	 * unchanged_nodes : Number of identical nodes
+	 * unchanged_arcs  : Number of identical arcs
+	 * errors          : Number of lines of the file that could not be read
+	 *******************************************************************************/
+	struct GraphDiff
+	{
+		typedef std::vector<std::pair<std::string, std::string> > Properties;
+		
+		struct NodeLine
+		{
+			int id;
+			std::string type;
+			Properties properties;
+		};
+		
+		struct ArcLine
+		{
+			int from_id;
+			std::string type;
+			int to_id;
+			Properties properties;
+		};
+		
+		std::vector<NodeLine> added_nodes;
+		std::vector<NodeLine> updated_nodes;
+		std::vector<NodeLine> replaced_nodes;
+		std::vector<int> erased_nodes;
+		std::vector<ArcLine> added_arcs;
+		std::vector<ArcLine> updated_arcs;
+		std::vector<std::string> erased_arcs;
+		long long unchanged_nodes;
+		long long unchanged_arcs;
+		long long errors;
+		
+		GraphDiff (): unchanged_nodes(0), unchanged_arcs(0), errors(0) {};
+		bool empty () const;
+	};
+	
+	
+	/*******************************************************************************
+	 * ReloadSummary struct
+	 *
+	 * Number of nodes and arcs changed by GraphDb::apply (or reload), and of
+	 * the lines of the file or changes that were rejected
+	 *******************************************************************************/
+	struct ReloadSummary
+	{
+		long long nodes_added;
+		long long nodes_updated;
+		long long nodes_replaced;
+		long long nodes_erased;
+		long long nodes_unchanged;
+		long long arcs_added;
+		long long arcs_updated;
+		long long arcs_erased;
+		long long arcs_unchanged;
+		long long errors;
+		
+		ReloadSummary (): nodes_added(0), nodes_updated(0), nodes_replaced(0), nodes_erased(0), nodes_unchanged(0), arcs_added(0), arcs_updated(0), arcs_erased(0), arcs_unchanged(0), errors(0) {};
+		std::string toText () const;
+	};
+	
+	
 	/*******************************************************************************
 	 * Interface to the graph database (not used yet)
 	 *******************************************************************************/
@@ -205,7 +873,7 @@ namespace tinygraphdb
 		virtual void addArc  (const int & from_id, const std::string & type, const int & to_id, const std::map<std::string, std::set<std::string> >& properties) = 0;
 		
 		virtual Node * getNode (int node_id) = 0;
-		virtual std::set<Node *> getNodesOfType (std::string type) = 0;
+		virtual std::set<Node *> getNodesOfType (std::string_view type) = 0;
 		
 		virtual int nbNode() = 0;
 		
@@ -218,33 +886,134 @@ namespace tinygraphdb
 	 * GraphDb Class
 	 *
 	 * _policy : A graphdb defines a policy to check type consistency
-	 * _nodes  : A graphdb has a set of nodes
+	 * _check_policy : false to insert nodes and arcs without checking their types
+	 *                 (the policy still gives the property types)
+	 * _nodes  : A graphdb has a set of nodes stored in slots (addresses are stable)
 	 * _arcs   : A graphdb has a set of arcs
 	 *
+	 * Node storage:
+	 * _slot_used   : tells if a slot holds a live node (erased slots are reused)
+	 * _free_slots  : slots of erased nodes
+	 * _free_ids    : ids of erased nodes (reused by newNode)
+	 * _dense_slot  : id to slot for dense ids (direct index, -1 if no node)
+	 * _sparse_slot : id to slot for ids too far from the dense range
+	 * _next_id     : next never used id (greater than every id in the GraphDb)
+	 *
+	 * The policy checks are the virtual checkNodeType and checkArc: TypedGraphDb
+	 * overrides them, so that inserts through a GraphDb & are checked too.
+	 *
+	 * The batch getters resolve ids by groups of BATCH_GROUP, prefetching the
+	 * slots, then the nodes, then their properties, so that the cache misses
+	 * of a group overlap.
+	 *
 	 * For quick search, it also contains:
 	 * _types : types to set of id
+	 *
+	 * _stats : Operation counters and latency histograms (disabled by default)
+	 *
+	 * _counts : Number of nodes and arcs (the first of the aggregate views)
+	 * _views  : Aggregate views told about every change (registered by the caller)
+	 *
+	 * Query cache (disabled by default):
+	 * _cache         : LRU cache of the results of the cached* queries
+	 * _mutation_seq  : Sequence number of the last change of the indexes
+	 * _type_versions : node type -> sequence number of its last node insertion or erasure
+	 * _prop_versions : property name -> sequence number of its last index change
+	 * _value_version : sequence number of the last change of any property value
 	 *******************************************************************************/
 	class GraphDb : public GraphDbInterface
 	{
+	public:
+		// Ids resolved together by the batch getters
+		static const size_t BATCH_GROUP = 32;
+		
 	private:
 		Policy _policy;
+		bool _check_policy;
 		
-		std::map<int, Node> _nodes;
+		std::deque<Node> _nodes;
 		std::map<std::string, Arc>  _arcs;
 		
-		std::map<std::string, std::set<int> > _node_types;
-		std::map<std::string, std::map<std::string, std::set<int> > > _props;
-		std::map<std::string, std::set<int> > _rev_props; // prop_value, set of nodes having the property
+		std::vector<char> _slot_used;
+		std::vector<int> _free_slots;
+		std::vector<int> _free_ids;
+		std::vector<int> _dense_slot;
+		std::unordered_map<int, int> _sparse_slot;
+		int _next_id;
+		
+		// Indexes are searchable with a std::string_view (no temporary string)
+		typedef std::map<std::string, std::set<int>, std::less<> > IdIndex;
+		
+		IdIndex _node_types;
+		std::map<std::string, IdIndex, std::less<> > _props;
+		IdIndex _rev_props; // prop_value, set of nodes having the property
+		
+		Stats _stats;
+		
+		CountView _counts;
+		std::vector<AggregateView *> _views;
+		
+		QueryCache _cache;
+		unsigned long long _mutation_seq;
+		std::unordered_map<int, unsigned long long> _type_versions;
+		std::unordered_map<int, unsigned long long> _prop_versions;
+		unsigned long long _value_version;
+		
+		// Node storage
+		Node * findNode (int node_id);
+		void findNodes (const int * ids, size_t count, Node ** out);
+		Node * insertNode (int unique_id, std::string_view type, PropertyList && properties);
+		Node * insertNode (int unique_id, int type_id, PropertyList && properties);
+		int takeFreeId ();
+		
+		// Ends, id and position in _arcs of an arc to add
+		struct ArcPlace
+		{
+			Node * from;
+			Node * to;
+			std::string unique_id;
+			std::map<std::string, Arc>::iterator hint;
+		};
+		bool placeArc (Node * from, std::string_view type, Node * to, ArcPlace & place);
+		void insertArc (ArcPlace & place, int type_id, PropertyList && properties);
+		void releaseNode (int node_id);
+		void removeNode (Node * node);
+		void removeArc (std::map<std::string, Arc>::iterator it);
+		void trimSlots ();
+		void indexProperty (const Node & node, const PropEntry & entry);
+		void unindexProperty (const Node & node, const PropEntry & entry, bool whole_node = false);
+		std::set<Node *> nodesWithTypedValue (std::string_view type, std::string_view prop_name, const PropValue & prop_value);
+		
+		// Query cache
+		unsigned long long typeVersion (std::string_view type) const;
+		unsigned long long propVersion (std::string_view prop_name) const;
+		NodeSetPtr cacheFind (const std::string & key, unsigned long long version);
+		NodeSetPtr cacheInsert (const std::string & key, unsigned long long version, std::set<Node *> && nodes);
+		
+		// Diff of a file against the graph
+		bool sameProperties (const PropertyView & properties, const GraphDiff::Properties & pairs, const PropTypeMap * types) const;
 		
 		// Private readers
 		void readNode (std::string line);
 		void readArc (std::string line);
 		std::map<std::string, std::string> readProperties (std::string line);
 		
+	protected:
+		// Policy checks, called by every adder (a subclass can give its own policy)
+		virtual void checkNodeType (std::string_view type);
+		virtual void checkArc (const Node & from, std::string_view type, const Node & to);
+		
+		// Adders for a subclass which has checked the types itself: the type is an interned id
+		// and prop_types its declared property types (neither the policy nor the pool is read)
+		Node * arcEnd (int node_id);
+		int newCheckedNode (int type_id, const PropTypeMap * prop_types, const PropertyPairs & properties);
+		void newCheckedNodeWithId (int unique_id, int type_id, const PropTypeMap * prop_types, const PropertyPairs & properties);
+		void addCheckedArc (Node * from, int type_id, Node * to, const PropTypeMap * prop_types, const PropertyPairs & properties);
+		
 	public:
 		// Constructor & destructor //
-		explicit GraphDb (Policy policy): _policy(policy) {};
-		explicit GraphDb (std::string fname);
+		explicit GraphDb (Policy policy, bool check_policy = true): _policy(policy), _check_policy(check_policy), _next_id(0), _mutation_seq(0), _value_version(0) {_views.push_back(&_counts);};
+		explicit GraphDb (std::string fname, bool check_policy = true);
 		~GraphDb () {};
 		
 		// Adders //
@@ -252,28 +1021,88 @@ namespace tinygraphdb
 		void newNodeWithId (const int & unique_id, const std::string & type, const std::map<std::string, std::set<std::string> >& properties);
 		void addArc  (const int & from_id, const std::string & type, const int & to_id, const std::map<std::string, std::set<std::string> >& properties);
 		
+		// Adders from (name, value) pairs: nothing is copied but the interned strings //
+		int newNode (std::string_view type, const PropertyPairs & properties);
+		void newNodeWithId (int unique_id, std::string_view type, const PropertyPairs & properties);
+		void addArc (int from_id, std::string_view type, int to_id, const PropertyPairs & properties);
+		
+		// Adders moving a property list built by the caller, e.g. PropertyList(pairs, policy().propertyTypes(type))
+		// (values not of the declared type of their property are converted, or rejected) //
+		int newNode (std::string_view type, PropertyList && properties);
+		void newNodeWithId (int unique_id, std::string_view type, PropertyList && properties);
+		void addArc (int from_id, std::string_view type, int to_id, PropertyList && properties);
+		
+		// Properties of stored nodes (the indexes are kept up to date) //
+		void addProperty (int node_id, std::string_view prop_name, std::string_view prop_value);
+		void addProperty (int node_id, std::string_view prop_name, const PropValue & prop_value);
+		void eraseProperty (int node_id, std::string_view prop_name);
+		
 		// Getters //
 		std::set<Node *> allNodes ();
+		std::set<Arc *> allArcs ();
 		Node * getNode (int node_id);
 		Arc * getArc (const std::string & arc_id);
-		std::set<Node *> getNodesOfType (std::string type);
+		std::set<Node *> getNodesOfType (std::string_view type);
 		
-		std::set<Node *> getNodesWithProperty (std::string prop_name);
-		std::set<Node *> getNodesWithProperty (std::string prop_name, std::string prop_value);
+		// Batch getters: results in the order of the ids, in buffers of count entries given by the caller //
+		size_t getNodes (const int * ids, size_t count, Node ** out);
+		size_t getProperties (const int * ids, size_t count, std::string_view prop_name, PropertyValues * out);
 		
-		std::set<Node *> getNodesWithPropertyValue (std::string prop_value);
+		std::set<Node *> getNodesWithProperty (std::string_view prop_name);
+		std::set<Node *> getNodesWithProperty (std::string_view prop_name, std::string_view prop_value);
+		std::set<Node *> getNodesWithProperty (std::string_view prop_name, const PropValue & prop_value);
 		
-		std::set<Node *> getNodesOfTypeWithProperty (std::string type, std::string prop_name);
-		std::set<Node *> getNodesOfTypeWithProperty (std::string type, std::string prop_name, std::string prop_value);
+		std::set<Node *> getNodesWithPropertyValue (std::string_view prop_value);
+		
+		std::set<Node *> getNodesOfTypeWithProperty (std::string_view type, std::string_view prop_name);
+		std::set<Node *> getNodesOfTypeWithProperty (std::string_view type, std::string_view prop_name, std::string_view prop_value);
+		std::set<Node *> getNodesOfTypeWithProperty (std::string_view type, std::string_view prop_name, const PropValue & prop_value);
+		
+		PropertyStats aggregateProperty (std::string_view type, std::string_view prop_name);
+		
+		// Cached queries (shared results, computed again only when the data they depend on changes) //
+		void enableQueryCache (size_t capacity) {_cache.setCapacity(capacity);};
+		NodeSetPtr cachedNodesOfType (std::string_view type);
+		NodeSetPtr cachedNodesWithProperty (std::string_view prop_name);
+		NodeSetPtr cachedNodesWithProperty (std::string_view prop_name, std::string_view prop_value);
+		NodeSetPtr cachedNodesWithPropertyValue (std::string_view prop_value);
+		NodeSetPtr cachedNodesOfTypeWithProperty (std::string_view type, std::string_view prop_name);
+		NodeSetPtr cachedNodesOfTypeWithProperty (std::string_view type, std::string_view prop_name, std::string_view prop_value);
 		
 		void eraseNode (int node_id);
+		void eraseNodes (const std::vector<int> & node_ids);
+		template <class InputIterator> void eraseNodes (InputIterator first, InputIterator last) {eraseNodes(std::vector<int>(first, last));};
+		void eraseArc (const std::string & arc_id);
+		void eraseArc (int from_id, std::string_view type, int to_id);
 		
 		const Policy & policy () const;
+		bool checksPolicy () const {return _check_policy;};
 		int nbNode ();
 		int nbArc ();
 		
+		// Aggregate views (owned by the caller, built when added) //
+		void addView (AggregateView * view);
+		void removeView (AggregateView * view);
+		
+		// Memory //
+		MemoryReport memoryUsage () const;
+		size_t shrink ();
+		
+		// Statistics //
+		void enableStats (bool enabled) {_stats.enable(enabled);};
+		void resetStats () {_stats.reset();};
+		StatsSnapshot stats () const {return _stats.snapshot();};
+		
+		// Reload (diff only reads the graph, apply changes it). GraphDb takes no
+		// lock: QueryExecutor::reload serves the readers during the diff //
+		GraphDiff diff (std::string fname);
+		ReloadSummary apply (const GraphDiff & diff);
+		ReloadSummary reload (std::string fname) {return apply(diff(fname));};
+		
 		// Printers //
 		void save (std::string fname);
+		// Save in chunks formatted (and compressed for .gz and .zst files) by nb_threads threads
+		void save (std::string fname, int nb_threads);
 		void print();
 	};
 
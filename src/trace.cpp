@@ -0,0 +1,195 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace tinygraphdb;
+
+// Buffer of the current thread (owned by the tracer)
+static thread_local TraceBuffer * thread_buffer = NULL;
+
+/*******************************************************************************
+ * TraceBuffer methods
+ *******************************************************************************/
+
+TraceBuffer :: TraceBuffer (int tid): _tid(tid), _size(0), _dropped(0)
+{
+	for (size_t i = 0; i < MAX_CHUNKS; i++) {
+		_chunks[i].store(NULL, std::memory_order_relaxed);
+	}
+}
+
+TraceBuffer :: ~TraceBuffer ()
+{
+	for (size_t i = 0; i < MAX_CHUNKS; i++) {
+		delete [] _chunks[i].load(std::memory_order_relaxed);
+	}
+}
+
+// Append an event (called by the owning thread only)
+void TraceBuffer :: append (const char * name, char phase, long long start_ns, long long dur_ns, const std::string & message)
+{
+	size_t i = _size.load(std::memory_order_relaxed);
+	if (i >= CHUNK_SIZE * MAX_CHUNKS) {
+		_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	TraceEvent * chunk = _chunks[i / CHUNK_SIZE].load(std::memory_order_relaxed);
+	if (chunk == NULL) {
+		chunk = new TraceEvent[CHUNK_SIZE];
+		_chunks[i / CHUNK_SIZE].store(chunk, std::memory_order_release);
+	}
+	TraceEvent & event = chunk[i % CHUNK_SIZE];
+	event.name = name;
+	event.phase = phase;
+	event.start_ns = start_ns;
+	event.dur_ns = dur_ns;
+	event.message = message;
+	_size.store(i + 1, std::memory_order_release);
+}
+
+/*******************************************************************************
+ * Tracer methods
+ *******************************************************************************/
+
+Tracer :: Tracer (): _enabled(false), _epoch(std::chrono::steady_clock::now())
+{
+	const char * env = getenv("TGDB_TRACE");
+	if (env != NULL && strcmp(env, "1") == 0) {
+		_enabled.store(true, std::memory_order_relaxed);
+	}
+}
+
+Tracer :: ~Tracer ()
+{
+	for (size_t i = 0; i < _buffers.size(); i++) {
+		delete _buffers[i];
+	}
+}
+
+// Return the tracer shared by all the GraphDb
+Tracer & Tracer :: instance ()
+{
+	static Tracer tracer;
+	return tracer;
+}
+
+// Return the buffer of the current thread (registered the first time)
+TraceBuffer & Tracer :: buffer ()
+{
+	if (thread_buffer == NULL) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		thread_buffer = new TraceBuffer((int) _buffers.size() + 1);
+		_buffers.push_back(thread_buffer);
+	}
+	return *thread_buffer;
+}
+
+// Forget all the recorded events
+void Tracer :: clear ()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (size_t i = 0; i < _buffers.size(); i++) {
+		_buffers[i]->clear();
+	}
+}
+
+// Write a string as a JSON string
+static void writeJsonString (std::stringstream & out, const std::string & str)
+{
+	out << "\"";
+	for (size_t i = 0; i < str.size(); i++) {
+		char c = str[i];
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		} else if (c == '\n') {
+			out << "\\n";
+		} else if (c == '\t') {
+			out << "\\t";
+		} else if ((unsigned char) c < 0x20) {
+			out << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 15];
+		} else {
+			out << c;
+		}
+	}
+	out << "\"";
+}
+
+// Export the recorded events in the Chrome trace-event format (times in microseconds)
+std::string Tracer :: toJson ()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::stringstream out;
+	out.precision(3);
+	out << std::fixed;
+	int pid = (int) getpid();
+	out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+	bool first = true;
+	for (size_t b = 0; b < _buffers.size(); b++) {
+		TraceBuffer & buffer = *_buffers[b];
+		out << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid << ", \"tid\": " << buffer.tid();
+		out << ", \"args\": {\"name\": \"thread " << buffer.tid() << "\", \"dropped_events\": " << buffer.dropped() << "}}";
+		first = false;
+		size_t size = buffer.size();
+		for (size_t i = 0; i < size; i++) {
+			const TraceEvent & event = buffer.event(i);
+			out << ",\n{\"name\": ";
+			writeJsonString(out, event.name);
+			out << ", \"cat\": \"tinygraphdb\", \"ph\": \"" << event.phase << "\", \"ts\": " << event.start_ns / 1000.0;
+			if (event.phase == 'X') {
+				out << ", \"dur\": " << event.dur_ns / 1000.0;
+			} else {
+				out << ", \"s\": \"t\"";
+			}
+			out << ", \"pid\": " << pid << ", \"tid\": " << buffer.tid();
+			if (!event.message.empty()) {
+				out << ", \"args\": {\"message\": ";
+				writeJsonString(out, event.message);
+				out << "}";
+			}
+			out << "}";
+		}
+	}
+	out << "\n]}\n";
+	return out.str();
+}
+
+// Save the recorded events in the given file (Chrome trace-event format)
+void Tracer :: save (const std::string & fname)
+{
+	std::ofstream outfile(fname.c_str());
+	if (!outfile.good()) {
+		std::stringstream error_message;
+		error_message << "Cannot open file " << fname;
+		throw std::runtime_error(error_message.str());
+	}
+	outfile << toJson();
+}
@@ -0,0 +1,161 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__trace__
+#define __tinyGraphDb__trace__
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * Trace spans
+	 *
+	 * Load, save and query phases can be recorded as spans and dumped in the
+	 * Chrome trace-event format (chrome://tracing, Perfetto). Tracing is enabled
+	 * at run time with Tracer::instance().enable() or with the environment
+	 * variable TGDB_TRACE=1 (needed to trace the load of a file).
+	 * Compile with -DTGDB_NO_TRACE to remove it completely.
+	 *******************************************************************************/
+	struct TraceEvent
+	{
+		const char * name;    // static string
+		char phase;           // 'X' complete span, 'i' instant event
+		long long start_ns;   // since the start of the tracer
+		long long dur_ns;
+		std::string message;  // optional (exception messages)
+	};
+	
+	
+	/*******************************************************************************
+	 * TraceBuffer Class
+	 *
+	 * _tid     : Id of the thread owning the buffer
+	 * _chunks  : Events, in chunks allocated by the owning thread when needed
+	 * _size    : Number of published events
+	 * _dropped : Number of events lost because the buffer was full
+	 *
+	 * Only the owning thread appends events (no lock), the size is published with
+	 * a release store so that the events can be read from another thread.
+	 *******************************************************************************/
+	class TraceBuffer
+	{
+	public:
+		static const size_t CHUNK_SIZE = 4096;
+		static const size_t MAX_CHUNKS = 1024;
+		
+	private:
+		int _tid;
+		std::atomic<TraceEvent *> _chunks[MAX_CHUNKS];
+		std::atomic<size_t> _size;
+		std::atomic<unsigned long long> _dropped;
+		
+	public:
+		explicit TraceBuffer (int tid);
+		~TraceBuffer ();
+		
+		void append (const char * name, char phase, long long start_ns, long long dur_ns, const std::string & message);
+		void clear () {_size.store(0, std::memory_order_release);};
+		
+		int tid () const {return _tid;};
+		size_t size () const {return _size.load(std::memory_order_acquire);};
+		const TraceEvent & event (size_t i) const {return _chunks[i / CHUNK_SIZE].load(std::memory_order_acquire)[i % CHUNK_SIZE];};
+		unsigned long long dropped () const {return _dropped.load(std::memory_order_relaxed);};
+	};
+	
+	
+	/*******************************************************************************
+	 * Tracer Class
+	 *
+	 * _enabled : Events are recorded only when enabled
+	 * _epoch   : Time origin of the events
+	 * _buffers : One buffer per thread that recorded an event (kept after the
+	 *            thread exits, so that its events can still be dumped)
+	 *
+	 * The tracer is shared by all the GraphDb of the process. clear() must not be
+	 * called while traced operations are running.
+	 *******************************************************************************/
+	class Tracer
+	{
+	private:
+		std::atomic<bool> _enabled;
+		std::chrono::steady_clock::time_point _epoch;
+		std::mutex _mutex;
+		std::vector<TraceBuffer *> _buffers;
+		
+		Tracer ();
+		~Tracer ();
+		TraceBuffer & buffer ();
+		
+	public:
+		static Tracer & instance ();
+		
+		void enable (bool enabled) {_enabled.store(enabled, std::memory_order_relaxed);};
+		bool enabled () const {return _enabled.load(std::memory_order_relaxed);};
+		void clear ();
+		
+		// Recorders //
+		long long now () const {return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _epoch).count();};
+		void complete (const char * name, long long start_ns, long long end_ns) {buffer().append(name, 'X', start_ns, end_ns - start_ns, std::string());};
+		void instant (const char * name, const std::string & message) {buffer().append(name, 'i', now(), 0, message);};
+		
+		// Printers //
+		std::string toJson ();
+		void save (const std::string & fname);
+	};
+	
+	
+	/*******************************************************************************
+	 * TraceScope Class
+	 *
+	 * Record the enclosing scope as a span of the given name (a static string)
+	 * (does nothing but a flag check when tracing is disabled)
+	 *******************************************************************************/
+	class TraceScope
+	{
+	private:
+		const char * _name;
+		bool _active;
+		long long _start;
+		
+	public:
+		explicit TraceScope (const char * name): _name(name), _active(Tracer::instance().enabled()), _start(0) {if (_active) _start = Tracer::instance().now();};
+		~TraceScope () {if (_active) Tracer::instance().complete(_name, _start, Tracer::instance().now());};
+	};
+	
+} // namespace tinygraphdb
+
+#ifdef TGDB_NO_TRACE
+#define TGDB_TRACE_SCOPE(name)
+#define TGDB_TRACE_INSTANT(name, message)
+#else
+#define TGDB_TRACE_SCOPE(name) tinygraphdb::TraceScope tgdb_trace_scope_(name)
+#define TGDB_TRACE_INSTANT(name, message) if (tinygraphdb::Tracer::instance().enabled()) tinygraphdb::Tracer::instance().instant(name, message)
+#endif
+
+#endif
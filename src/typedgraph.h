@@ -0,0 +1,278 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __tinyGraphDb__typedgraph__
+#define __tinyGraphDb__typedgraph__
+
+#include <vector>
+
+#include "tinygraphdb.h"
+
+namespace tinygraphdb
+{
+	/*******************************************************************************
+	 * Policies of a TypedGraphDb
+	 *
+	 * Policy          : Read at run time (the default, same as GraphDb)
+	 * NoPolicy        : Any node type and any arc, nothing is checked
+	 * StaticPolicy<S> : Types and triples fixed at compile time by a schema S:
+	 *
+	 *   struct Schema
+	 *   {
+	 *       enum NodeType {COMPOUND, REACTION, NB_NODE_TYPES};
+	 *       enum ArcType {HAS_LEFT, HAS_RIGHT, NB_ARC_TYPES};
+	 *       static constexpr const char * node_types[NB_NODE_TYPES] = {"compound", "reaction"};
+	 *       static constexpr const char * arc_types[NB_ARC_TYPES] = {"has left", "has right"};
+	 *       static constexpr SchemaTriple<NodeType, ArcType> triples[] = {
+	 *           {REACTION, HAS_LEFT, COMPOUND}, {REACTION, HAS_RIGHT, COMPOUND}};
+	 *   };
+	 *
+	 * The allowed triples become a constexpr table: an arc is checked with one
+	 * array read, and StaticPolicy<S>::isValid can be used in static_assert.
+	 *******************************************************************************/
+	struct NoPolicy
+	{
+	};
+	
+	template <class NodeType, class ArcType>
+	struct SchemaTriple
+	{
+		NodeType from;
+		ArcType arc;
+		NodeType to;
+	};
+	
+	template <class S>
+	struct StaticPolicy
+	{
+		typedef typename S::NodeType NodeType;
+		typedef typename S::ArcType ArcType;
+		static const int NB_NODE_TYPES = S::NB_NODE_TYPES;
+		static const int NB_ARC_TYPES = S::NB_ARC_TYPES;
+		
+		struct Table
+		{
+			bool valid[NB_NODE_TYPES][NB_ARC_TYPES][NB_NODE_TYPES];
+		};
+		
+		static constexpr Table makeTable ()
+		{
+			Table table = {};
+			for (size_t i = 0; i < sizeof(S::triples) / sizeof(S::triples[0]); i++) {
+				table.valid[S::triples[i].from][S::triples[i].arc][S::triples[i].to] = true;
+			}
+			return table;
+		};
+		
+		static constexpr Table table = makeTable();
+		
+		static constexpr bool isValid (NodeType from, ArcType arc, NodeType to) {return table.valid[from][arc][to];};
+		static constexpr const char * nodeTypeName (NodeType type) {return S::node_types[type];};
+		static constexpr const char * arcTypeName (ArcType type) {return S::arc_types[type];};
+		
+		// Runtime policy with the same types (saved with the graph, gives the property types)
+		static Policy policy ()
+		{
+			Policy policy;
+			for (int t = 0; t < NB_NODE_TYPES; t++) policy.addNodeType(S::node_types[t]);
+			for (int t = 0; t < NB_ARC_TYPES; t++) policy.addArcType(S::arc_types[t]);
+			for (size_t i = 0; i < sizeof(S::triples) / sizeof(S::triples[0]); i++) {
+				policy.addConstraint(S::node_types[S::triples[i].from], S::arc_types[S::triples[i].arc], S::node_types[S::triples[i].to]);
+			}
+			return policy;
+		};
+	};
+	
+	
+	/*******************************************************************************
+	 * TypedGraphDb Class
+	 *
+	 * A GraphDb whose policy is a template parameter. TypedGraphDb<Policy> is a
+	 * plain GraphDb. The others replace the runtime policy checks of GraphDb:
+	 * see the specializations.
+	 *******************************************************************************/
+	template <class P = Policy>
+	class TypedGraphDb : public GraphDb
+	{
+	public:
+		explicit TypedGraphDb (Policy policy): GraphDb(policy) {};
+		explicit TypedGraphDb (std::string fname): GraphDb(fname) {};
+	};
+	
+	
+	/*******************************************************************************
+	 * TypedGraphDb<NoPolicy> Class
+	 *
+	 * Nodes and arcs of any type (a loaded file keeps its policy for the property
+	 * types, but it is not checked)
+	 *******************************************************************************/
+	template <>
+	class TypedGraphDb<NoPolicy> : public GraphDb
+	{
+	public:
+		TypedGraphDb (): GraphDb(Policy(), false) {};
+		explicit TypedGraphDb (std::string fname): GraphDb(fname, false) {};
+	};
+	
+	
+	/*******************************************************************************
+	 * TypedGraphDb<StaticPolicy<S> > Class
+	 *
+	 * _node_types      : Node type of each interned string id (-1 if it is not a node type)
+	 * _arc_types       : Arc type of each interned string id (-1 if it is not an arc type)
+	 * _node_type_ids   : Interned name of each node type
+	 * _arc_type_ids    : Interned name of each arc type
+	 * _node_prop_types : Declared property types of each node type
+	 * _arc_prop_types  : Declared property types of each arc type
+	 *
+	 * Nodes and arcs are added with the enum types of the schema, or with their
+	 * names. The enum adders insert with the interned ids and property types
+	 * kept at construction: an arc is checked with three array reads (the types
+	 * of its ends and the constexpr table) and no string is hashed. The adders
+	 * by name, also through a GraphDb & (server, executor, reload), look the name
+	 * up in the string pool, then go through the overridden policy checks.
+	 *******************************************************************************/
+	template <class S>
+	class TypedGraphDb<StaticPolicy<S> > : public GraphDb
+	{
+	public:
+		typedef StaticPolicy<S> P;
+		typedef typename P::NodeType NodeType;
+		typedef typename P::ArcType ArcType;
+		
+	private:
+		std::vector<int> _node_types;
+		std::vector<int> _arc_types;
+		int _node_type_ids[P::NB_NODE_TYPES];
+		int _arc_type_ids[P::NB_ARC_TYPES];
+		const PropTypeMap * _node_prop_types[P::NB_NODE_TYPES];
+		const PropTypeMap * _arc_prop_types[P::NB_ARC_TYPES];
+		
+		void initTypes (std::vector<int> & types, int * type_ids, const PropTypeMap ** prop_types, const char * const * names, int nb_types)
+		{
+			StringPool & pool = StringPool::instance();
+			for (int t = 0; t < nb_types; t++) {
+				int id = pool.intern(names[t]);
+				if ((int) types.size() <= id) {
+					types.resize(id + 1, -1);
+				}
+				types[id] = t;
+				type_ids[t] = id;
+				prop_types[t] = policy().propertyTypes(names[t]);
+			}
+		};
+		
+		// Return the type of an interned string id (-1 if it is not a type of the schema)
+		static int schemaType (const std::vector<int> & types, int id) {return id >= 0 && id < (int) types.size() ? types[id] : -1;};
+		
+		// Throw an exception if an enum value is not a type of the schema
+		static void checkEnum (int type, int nb_types, const char * kind)
+		{
+			if (type < 0 || type >= nb_types) {
+				std::stringstream error_message;
+				error_message << "Unknown " << kind << " type " << type;
+				throw std::runtime_error(error_message.str());
+			}
+		};
+		
+		static void checkSchemaArc (NodeType from_type, ArcType arc_type, NodeType to_type, std::string_view type)
+		{
+			if (!P::isValid(from_type, arc_type, to_type)) {
+				std::stringstream error_message;
+				error_message << "Arc not valid : " << P::nodeTypeName(from_type) << "->[" << type << "]->" << P::nodeTypeName(to_type);
+				throw std::runtime_error(error_message.str());
+			}
+		};
+		
+	protected:
+		void checkNodeType (std::string_view type) override
+		{
+			if (schemaType(_node_types, StringPool::instance().lookup(type)) < 0) {
+				std::stringstream error_message;
+				error_message << "Unknown node type \'" << type << "\'";
+				throw std::runtime_error(error_message.str());
+			}
+		};
+		
+		void checkArc (const Node & from, std::string_view type, const Node & to) override
+		{
+			int arc_type = schemaType(_arc_types, StringPool::instance().lookup(type));
+			if (arc_type < 0) {
+				std::stringstream error_message;
+				error_message << "Unknown arc type \'" << type << "\'";
+				throw std::runtime_error(error_message.str());
+			}
+			checkSchemaArc(nodeType(from), (ArcType) arc_type, nodeType(to), type);
+		};
+		
+	public:
+		TypedGraphDb (): GraphDb(P::policy(), false)
+		{
+			initTypes(_node_types, _node_type_ids, _node_prop_types, S::node_types, P::NB_NODE_TYPES);
+			initTypes(_arc_types, _arc_type_ids, _arc_prop_types, S::arc_types, P::NB_ARC_TYPES);
+		};
+		
+		// Type of a stored node (throw an exception if it is not a type of the schema)
+		NodeType nodeType (const Node & node) const
+		{
+			int type = schemaType(_node_types, node.typeId());
+			if (type < 0) {
+				std::stringstream error_message;
+				error_message << "Node type \'" << node.type() << "\' is not in the schema";
+				throw std::runtime_error(error_message.str());
+			}
+			return (NodeType) type;
+		};
+		
+		// Adders with type names (checked against the schema) //
+		using GraphDb::newNode;
+		using GraphDb::newNodeWithId;
+		using GraphDb::addArc;
+		
+		// Adders with the types of the schema //
+		int newNode (NodeType type, const PropertyPairs & properties)
+		{
+			checkEnum(type, P::NB_NODE_TYPES, "node");
+			return newCheckedNode(_node_type_ids[type], _node_prop_types[type], properties);
+		};
+		
+		void newNodeWithId (int unique_id, NodeType type, const PropertyPairs & properties)
+		{
+			checkEnum(type, P::NB_NODE_TYPES, "node");
+			newCheckedNodeWithId(unique_id, _node_type_ids[type], _node_prop_types[type], properties);
+		};
+		
+		void addArc (int from_id, ArcType type, int to_id, const PropertyPairs & properties)
+		{
+			checkEnum(type, P::NB_ARC_TYPES, "arc");
+			Node * from = arcEnd(from_id);
+			Node * to = arcEnd(to_id);
+			checkSchemaArc(nodeType(*from), type, nodeType(*to), P::arcTypeName(type));
+			addCheckedArc(from, _arc_type_ids[type], to, _arc_prop_types[type], properties);
+		};
+	};
+	
+} // namespace tinygraphdb
+
+#endif
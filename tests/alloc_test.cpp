@@ -0,0 +1,145 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tinygraphdb.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <new>
+
+using namespace tinygraphdb;
+
+// Every allocation of the program is counted
+static size_t nb_allocations = 0;
+
+void * operator new (size_t size)
+{
+	nb_allocations++;
+	void * p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete (void * p) noexcept
+{
+	free(p);
+}
+
+void operator delete (void * p, size_t) noexcept
+{
+	free(p);
+}
+
+static int failures = 0;
+
+static void check (bool ok, const char * what, double value, double limit)
+{
+	printf("%-40s %6.2f (limit %.2f) %s\n", what, value, limit, ok ? "ok" : "FAILED");
+	if (!ok) {
+		failures++;
+	}
+}
+
+// Steady state inserts of known types with interned values: only the index set nodes are allocated
+int main ()
+{
+	Policy policy;
+	policy.addNodeType("protein");
+	policy.addArcType("interacts with");
+	policy.addConstraint("protein", "interacts with", "protein");
+	GraphDb db(policy);
+	
+	PropertyPairs properties;
+	properties.push_back(std::make_pair("name", "P53"));
+	properties.push_back(std::make_pair("organism", "human"));
+	PropertyPairs no_properties;
+	
+	// Warm up: intern the strings, create the index entries and grow the slots
+	const int nb_nodes = 100000;
+	for (int i = 0; i < nb_nodes; i++) {
+		db.newNodeWithId(i, "protein", properties);
+	}
+	for (int i = 1; i < nb_nodes; i++) {
+		db.addArc(i - 1, "interacts with", i, no_properties);
+	}
+	
+	// New nodes: one set node in the type index, two per property (by name and value, by value),
+	// a deque block of nodes every 512 bytes (libstdc++) and the doubling of the deque map and of the id slots
+	const double nb_growths = 64;
+	size_t nodes_per_block = sizeof(Node) < 512 ? 512 / sizeof(Node) : 1;
+	double node_limit = (1 + 2 * properties.size()) + (double) ((nb_nodes + nodes_per_block - 1) / nodes_per_block + nb_growths) / nb_nodes;
+	size_t before = nb_allocations;
+	for (int i = nb_nodes; i < 2 * nb_nodes; i++) {
+		db.newNodeWithId(i, "protein", properties);
+	}
+	double per_node = (double) (nb_allocations - before) / nb_nodes;
+	check(per_node <= node_limit, "allocations per newNodeWithId", per_node, node_limit);
+	
+	// A moved PropertyList (inline entries) costs the same as the pairs
+	const PropTypeMap * protein_types = db.policy().propertyTypes("protein");
+	before = nb_allocations;
+	for (int i = 2 * nb_nodes; i < 3 * nb_nodes; i++) {
+		db.newNodeWithId(i, "protein", PropertyList(properties, protein_types));
+	}
+	per_node = (double) (nb_allocations - before) / nb_nodes;
+	check(per_node <= node_limit, "allocations per moved newNodeWithId", per_node, node_limit);
+	
+	// New arcs: the map node of the arc, its key when longer than the small string buffer
+	// (the Arc refers to the key) and one set node in each end node
+	size_t sso_capacity = std::string().capacity();
+	size_t nb_keys = 0;
+	for (int i = nb_nodes + 1; i < 2 * nb_nodes; i++) {
+		nb_keys += std::to_string(i - 1).size() + strlen("interacts with") + std::to_string(i).size() > sso_capacity;
+	}
+	double arc_limit = 3 + (double) nb_keys / (nb_nodes - 1);
+	before = nb_allocations;
+	for (int i = nb_nodes + 1; i < 2 * nb_nodes; i++) {
+		db.addArc(i - 1, "interacts with", i, no_properties);
+	}
+	double per_arc = (double) (nb_allocations - before) / (nb_nodes - 1);
+	check(per_arc <= arc_limit, "allocations per addArc", per_arc, arc_limit);
+	
+	// Same arcs with a moved empty PropertyList
+	before = nb_allocations;
+	for (int i = 2 * nb_nodes + 1; i < 3 * nb_nodes; i++) {
+		db.addArc(i - 1, "interacts with", i, PropertyList());
+	}
+	per_arc = (double) (nb_allocations - before) / (nb_nodes - 1);
+	check(per_arc <= arc_limit, "allocations per moved addArc", per_arc, arc_limit);
+	
+	// Lookups by string_view do not allocate
+	before = nb_allocations;
+	size_t found = 0;
+	for (int i = 0; i < 1000; i++) {
+		found += db.policy().isNodeType(std::string_view("protein"));
+		found += db.getNode(i) != NULL;
+	}
+	check(nb_allocations == before && found == 2000, "allocations per lookup", (double) (nb_allocations - before) / 1000, 0);
+	
+	return failures == 0 ? 0 : 1;
+}
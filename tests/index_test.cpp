@@ -0,0 +1,104 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tinygraphdb.h"
+
+#include <cstdio>
+
+using namespace tinygraphdb;
+
+static int failures = 0;
+
+static void check (bool ok, const char * what)
+{
+	printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) {
+		failures++;
+	}
+}
+
+static Policy personPolicy ()
+{
+	Policy policy;
+	policy.addNodeType("person");
+	return policy;
+}
+
+// The value index keeps a node while another of its properties has the value,
+// and typed values follow the declared property types
+int main ()
+{
+	PropertyPairs both;
+	both.push_back(std::make_pair("first", "alex"));
+	both.push_back(std::make_pair("nick", "alex"));
+	PropertyPairs first_only;
+	first_only.push_back(std::make_pair("first", "alex"));
+	
+	GraphDb db(personPolicy());
+	db.enableQueryCache(16);
+	db.newNodeWithId(1, "person", both);
+	check(db.getNodesWithPropertyValue("alex").size() == 1, "value indexed once for two properties");
+	check(db.cachedNodesWithPropertyValue("alex")->size() == 1, "cached value query");
+	db.eraseProperty(1, "nick");
+	check(db.getNodesWithPropertyValue("alex").size() == 1, "eraseProperty keeps the value of another property");
+	check(db.cachedNodesWithPropertyValue("alex")->size() == 1, "cached value query after eraseProperty");
+	check(db.getNodesWithProperty("nick", "alex").empty(), "erased property is unindexed");
+	db.eraseProperty(1, "first");
+	check(db.getNodesWithPropertyValue("alex").empty(), "last property with the value unindexes it");
+	
+	// reload updates changed properties through eraseProperty
+	const char * fname = "/tmp/tgdb_index_test.tgdb";
+	GraphDb target(personPolicy());
+	target.newNodeWithId(1, "person", first_only);
+	target.save(fname);
+	GraphDb reloaded(personPolicy());
+	reloaded.newNodeWithId(1, "person", both);
+	reloaded.reload(fname);
+	check(reloaded.getNodesWithPropertyValue("alex").size() == 1, "reload keeps the value of the unchanged property");
+	check(reloaded.getNodesWithProperty("nick").empty(), "reload erases the dropped property");
+	remove(fname);
+	
+	// Erasing the node removes it from the value index
+	reloaded.eraseNode(1);
+	check(reloaded.getNodesWithPropertyValue("alex").empty(), "eraseNode unindexes every value");
+	
+	// A typed value takes the declared type of its property, like its text would
+	Policy typed = personPolicy();
+	typed.addPropertyType("person", "age", PROP_INT);
+	GraphDb people(typed);
+	people.newNodeWithId(1, "person", PropertyPairs());
+	people.addProperty(1, "age", PropValue(42.0));
+	people.addProperty(1, "height", PropValue(180));
+	check(people.getNodesWithProperty("age", PropValue(42)).size() == 1, "typed value converted to the declared type");
+	check(people.getNodesWithProperty("height", "180").size() == 1, "typed value of an undeclared property stored as text");
+	bool rejected = false;
+	try {
+		people.addProperty(1, "age", PropValue(4.5));
+	} catch (std::runtime_error & e) {
+		rejected = true;
+	}
+	check(rejected, "typed value not of the declared type rejected");
+	
+	return failures == 0 ? 0 : 1;
+}
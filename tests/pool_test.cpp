@@ -0,0 +1,129 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "tinygraphdb.h"
+
+#include <cstdio>
+#include <thread>
+
+using namespace tinygraphdb;
+
+static int failures = 0;
+
+static void check (bool ok, const char * what)
+{
+	printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) {
+		failures++;
+	}
+}
+
+static Policy genePolicy ()
+{
+	Policy policy;
+	policy.addNodeType("gene");
+	policy.addArcType("regulates");
+	policy.addConstraint("gene", "regulates", "gene");
+	return policy;
+}
+
+// Fill a graph with values shared with the other thread and values of its own, read them back, then erase them
+static void fill (GraphDb * db, int seed, bool * ok)
+{
+	const int nb_nodes = 20000;
+	for (int round = 0; round < 3; round++) {
+		for (int i = 0; i < nb_nodes; i++) {
+			std::string shared = "shared_" + std::to_string((7 * i + seed) % 5000);
+			std::string own = "own_" + std::to_string(seed) + "_" + std::to_string(i);
+			PropertyPairs properties;
+			properties.push_back(std::make_pair(std::string_view("name"), std::string_view(shared)));
+			properties.push_back(std::make_pair(std::string_view("tag"), std::string_view(own)));
+			db->newNodeWithId(i, "gene", properties);
+			db->addProperty(i, "note", shared + "_note");
+			if (i > 0) {
+				db->addArc(i - 1, "regulates", i, PropertyPairs());
+			}
+			PropertyView view = db->getNode(i)->properties();
+			*ok = *ok && *view.find("tag").begin() == own && *view.find("name").begin() == shared;
+		}
+		for (int i = 0; i < nb_nodes; i++) {
+			db->eraseNode(i);
+		}
+	}
+}
+
+// Two threads fill their own GraphDb through the shared string pool, and the
+// values no longer held by a node are freed (erase, reload, destruction)
+int main ()
+{
+	StringPool & pool = StringPool::instance();
+	GraphDb names(genePolicy());
+	PropertyPairs properties;
+	properties.push_back(std::make_pair("name", "intern the names first"));
+	properties.push_back(std::make_pair("tag", ""));
+	properties.push_back(std::make_pair("note", ""));
+	names.newNodeWithId(0, "gene", properties);
+	names.newNodeWithId(1, "gene", properties);
+	names.addArc(0, "regulates", 1, PropertyPairs());
+	names.eraseNode(0);
+	names.eraseNode(1);
+	int base = pool.size();
+	
+	bool ok[2] = {true, true};
+	{
+		GraphDb first(genePolicy());
+		GraphDb second(genePolicy());
+		std::thread t1(fill, &first, 1, &ok[0]);
+		std::thread t2(fill, &second, 2, &ok[1]);
+		t1.join();
+		t2.join();
+	}
+	check(ok[0] && ok[1], "values read back in both threads");
+	check(pool.size() == base, "erased values freed");
+	
+	// reload replaces the values of the nodes
+	const char * fname = "/tmp/tgdb_pool_test.tgdb";
+	GraphDb target(genePolicy());
+	GraphDb reloaded(genePolicy());
+	for (int i = 0; i < 1000; i++) {
+		std::string old_value = "old_" + std::to_string(i);
+		std::string new_value = "new_" + std::to_string(i);
+		PropertyPairs old_name;
+		old_name.push_back(std::make_pair(std::string_view("name"), std::string_view(old_value)));
+		reloaded.newNodeWithId(i, "gene", old_name);
+		PropertyPairs new_name;
+		new_name.push_back(std::make_pair(std::string_view("name"), std::string_view(new_value)));
+		target.newNodeWithId(i, "gene", new_name);
+	}
+	target.save(fname);
+	reloaded.reload(fname);
+	remove(fname);
+	check(pool.lookup("old_1") < 0 && pool.size() == base + 1000, "values replaced by reload freed");
+	check(*reloaded.getNode(1)->properties().find("name").begin() == "new_1", "reloaded value");
+	
+	// Names and types stay
+	check(pool.lookup("gene") >= 0 && pool.lookup("name") >= 0, "names and types kept");
+	
+	return failures == 0 ? 0 : 1;
+}
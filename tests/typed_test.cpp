@@ -0,0 +1,101 @@
+/*
+ * Tinygraphdb version 1.3
+ *
+ * Copyright (c) 2012-2013 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "typedgraph.h"
+
+#include <cstdio>
+
+using namespace tinygraphdb;
+
+static int failures = 0;
+
+static void check (bool ok, const char * what)
+{
+	printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) {
+		failures++;
+	}
+}
+
+// Return true if the given insert throws
+template <class F>
+static bool rejects (F insert)
+{
+	try {
+		insert();
+	} catch (std::runtime_error &) {
+		return true;
+	}
+	return false;
+}
+
+struct Reactions
+{
+	enum NodeType {COMPOUND, REACTION, NB_NODE_TYPES};
+	enum ArcType {HAS_LEFT, HAS_RIGHT, NB_ARC_TYPES};
+	static constexpr const char * node_types[NB_NODE_TYPES] = {"compound", "reaction"};
+	static constexpr const char * arc_types[NB_ARC_TYPES] = {"has left", "has right"};
+	static constexpr SchemaTriple<NodeType, ArcType> triples[] = {
+		{REACTION, HAS_LEFT, COMPOUND}, {REACTION, HAS_RIGHT, COMPOUND}};
+};
+
+typedef StaticPolicy<Reactions> ReactionPolicy;
+
+static_assert(ReactionPolicy::isValid(Reactions::REACTION, Reactions::HAS_LEFT, Reactions::COMPOUND), "reaction has left compound");
+static_assert(!ReactionPolicy::isValid(Reactions::COMPOUND, Reactions::HAS_LEFT, Reactions::REACTION), "compound has no left");
+
+// The enum adders and the adders by name of a static schema insert the same nodes and arcs
+// and reject the same arcs, also through a GraphDb &
+int main ()
+{
+	PropertyPairs properties;
+	properties.push_back(std::make_pair("name", "glucose"));
+	PropertyPairs no_properties;
+	
+	TypedGraphDb<ReactionPolicy> db;
+	int compound = db.newNode(Reactions::COMPOUND, properties);
+	db.newNodeWithId(10, Reactions::REACTION, no_properties);
+	db.addArc(10, Reactions::HAS_LEFT, compound, no_properties);
+	db.addArc(10, Reactions::HAS_LEFT, compound, no_properties);
+	check(db.getNode(compound) != NULL && db.getNode(compound)->type() == "compound", "enum node stored with its type name");
+	check(db.nodeType(*db.getNode(10)) == Reactions::REACTION, "nodeType of an enum node");
+	check(db.getNodesWithProperty("name", "glucose").size() == 1, "enum node properties indexed");
+	check(db.nbArc() == 1, "enum arc stored once");
+	check(db.getNodesOfType("compound").size() == 1, "enum node in the type index");
+	
+	check(rejects([&] {db.addArc(compound, Reactions::HAS_LEFT, 10, no_properties);}), "enum arc not in the schema rejected");
+	check(rejects([&] {db.addArc(10, Reactions::HAS_RIGHT, 99, no_properties);}), "enum arc to a missing node rejected");
+	check(rejects([&] {db.newNode((Reactions::NodeType) 7, no_properties);}), "enum node type out of the schema rejected");
+	check(rejects([&] {db.addArc(10, Reactions::NB_ARC_TYPES, compound, no_properties);}), "enum arc type out of the schema rejected");
+	
+	// The adders by name go through the overridden checks
+	GraphDb & graph = db;
+	int other = graph.newNode(std::string_view("compound"), no_properties);
+	graph.addArc(10, std::string_view("has right"), other, no_properties);
+	check(db.nbArc() == 2, "arc by name through a GraphDb &");
+	check(rejects([&] {graph.newNode(std::string_view("enzyme"), no_properties);}), "unknown node type rejected through a GraphDb &");
+	check(rejects([&] {graph.addArc(other, std::string_view("has left"), 10, no_properties);}), "arc not in the schema rejected through a GraphDb &");
+	
+	return failures == 0 ? 0 : 1;
+}